@@ -27,6 +27,7 @@
 #include <dirent.h>
 #include <dlfcn.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -40,6 +41,10 @@
 #define FNDELAY O_NDELAY
 #endif
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
 #ifdef __APPLE__
 #include <mach/clock.h>
 #include <mach/mach.h>
@@ -662,6 +667,173 @@ Sys_Realpath(const char *in, char *out, size_t size)
 	return true;
 }
 
+/*
+ * Copies a file. May be called from
+ * threads, so it doesn't print anything.
+ */
+qboolean
+Sys_CopyFile(const char *from, const char *to)
+{
+	char buffer[65536];
+	qboolean ok = true;
+	int in, out;
+	ssize_t l;
+
+	in = open(from, O_RDONLY);
+
+	if (in == -1)
+	{
+		return false;
+	}
+
+	out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+	if (out == -1)
+	{
+		close(in);
+		return false;
+	}
+
+#ifdef SYS_copy_file_range
+	/* Let the kernel do the copy, on some file
+	   systems it just shares the data blocks. */
+	do
+	{
+		l = syscall(SYS_copy_file_range, in, NULL, out, NULL,
+				(size_t)1 << 30, 0);
+	}
+	while (l > 0);
+
+	if (l == 0)
+	{
+		close(in);
+		close(out);
+		return true;
+	}
+
+	/* not supported, copy by hand from where it stopped */
+#endif
+
+	while ((l = read(in, buffer, sizeof(buffer))) > 0)
+	{
+		if (write(out, buffer, l) != l)
+		{
+			ok = false;
+			break;
+		}
+	}
+
+	if (l < 0)
+	{
+		ok = false;
+	}
+
+	close(in);
+
+	if (close(out) == -1)
+	{
+		ok = false;
+	}
+
+	return ok;
+}
+
+/* ================================================================ */
+
+typedef struct
+{
+	void (*func)(void *);
+	void *arg;
+} threadstart_t;
+
+static void *
+Sys_ThreadStart(void *data)
+{
+	threadstart_t start = *(threadstart_t *)data;
+
+	free(data);
+	start.func(start.arg);
+
+	return NULL;
+}
+
+/*
+ * Starts func(arg) in a new thread. Returns
+ * NULL if that's not possible, the caller
+ * must do the work by itself then.
+ */
+void *
+Sys_CreateThread(void (*func)(void *), void *arg)
+{
+	threadstart_t *start;
+	pthread_t *thread;
+
+	start = malloc(sizeof(*start));
+	thread = malloc(sizeof(*thread));
+
+	if (!start || !thread)
+	{
+		free(start);
+		free(thread);
+		return NULL;
+	}
+
+	start->func = func;
+	start->arg = arg;
+
+	if (pthread_create(thread, NULL, Sys_ThreadStart, start) != 0)
+	{
+		free(start);
+		free(thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+/*
+ * Waits for the thread to finish
+ * and frees the handle.
+ */
+void
+Sys_WaitThread(void *thread)
+{
+	pthread_join(*(pthread_t *)thread, NULL);
+	free(thread);
+}
+
+void *
+Sys_CreateMutex(void)
+{
+	pthread_mutex_t *mutex = malloc(sizeof(*mutex));
+
+	if (!mutex || (pthread_mutex_init(mutex, NULL) != 0))
+	{
+		Sys_Error("%s: couldn't create mutex", __func__);
+	}
+
+	return mutex;
+}
+
+void
+Sys_DestroyMutex(void *mutex)
+{
+	pthread_mutex_destroy(mutex);
+	free(mutex);
+}
+
+void
+Sys_LockMutex(void *mutex)
+{
+	pthread_mutex_lock(mutex);
+}
+
+void
+Sys_UnlockMutex(void *mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
 /* ================================================================ */
 
 void *
@@ -634,6 +634,118 @@ Sys_Realpath(const char *in, char *out, size_t size)
 	return true;
 }
 
+/*
+ * Copies a file. May be called from
+ * threads, so it doesn't print anything.
+ */
+qboolean
+Sys_CopyFile(const char *from, const char *to)
+{
+	WCHAR wfrom[MAX_OSPATH] = {0};
+	MultiByteToWideChar(CP_UTF8, 0, from, -1, wfrom, MAX_OSPATH);
+
+	WCHAR wto[MAX_OSPATH] = {0};
+	MultiByteToWideChar(CP_UTF8, 0, to, -1, wto, MAX_OSPATH);
+
+	return CopyFileW(wfrom, wto, FALSE) ? true : false;
+}
+
+/* ======================================================================= */
+
+typedef struct
+{
+	void (*func)(void *);
+	void *arg;
+} threadstart_t;
+
+static DWORD WINAPI
+Sys_ThreadStart(LPVOID data)
+{
+	threadstart_t start = *(threadstart_t *)data;
+
+	free(data);
+	start.func(start.arg);
+
+	return 0;
+}
+
+/*
+ * Starts func(arg) in a new thread. Returns
+ * NULL if that's not possible, the caller
+ * must do the work by itself then.
+ */
+void *
+Sys_CreateThread(void (*func)(void *), void *arg)
+{
+	threadstart_t *start;
+	HANDLE thread;
+
+	start = malloc(sizeof(*start));
+
+	if (!start)
+	{
+		return NULL;
+	}
+
+	start->func = func;
+	start->arg = arg;
+
+	thread = CreateThread(NULL, 0, Sys_ThreadStart, start, 0, NULL);
+
+	if (!thread)
+	{
+		free(start);
+		return NULL;
+	}
+
+	return thread;
+}
+
+/*
+ * Waits for the thread to finish
+ * and frees the handle.
+ */
+void
+Sys_WaitThread(void *thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+void *
+Sys_CreateMutex(void)
+{
+	CRITICAL_SECTION *mutex = malloc(sizeof(*mutex));
+
+	if (!mutex)
+	{
+		Sys_Error("%s: couldn't create mutex", __func__);
+	}
+
+	InitializeCriticalSection(mutex);
+
+	return mutex;
+}
+
+void
+Sys_DestroyMutex(void *mutex)
+{
+	DeleteCriticalSection(mutex);
+	free(mutex);
+}
+
+void
+Sys_LockMutex(void *mutex)
+{
+	EnterCriticalSection(mutex);
+}
+
+void
+Sys_UnlockMutex(void *mutex)
+{
+	LeaveCriticalSection(mutex);
+}
+
 /* ======================================================================= */
 
 void *
@@ -37,7 +37,6 @@ static vec3_t avelocities[NUMVERTEXNORMALS];
 extern struct model_s *cl_mod_smoke;
 extern struct model_s *cl_mod_flash;
 
-extern cparticle_t *active_particles, *free_particles;
 
 void
 CL_AddMuzzleFlash(void)
@@ -799,16 +798,11 @@ CL_TeleporterParticles(entity_state_t *ent)
 
 	for (i = 0; i < 8; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = 0xdb;
 
@@ -840,16 +834,11 @@ CL_LogoutEffect(vec3_t org, int type)
 
 	for (i = 0; i < 500; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 
 		if (type == MZ_LOGIN)
@@ -895,16 +884,11 @@ CL_ItemRespawnParticles(vec3_t org)
 
 	for (i = 0; i < 64; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = 0xd4 + (randk() & 3);
 		p->org[0] = org[0] + crandk() * 8;
@@ -935,16 +919,11 @@ CL_ExplosionParticles(vec3_t org)
 
 	for (i = 0; i < 256; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = 0xe0 + (randk() & 7);
 
@@ -975,16 +954,11 @@ CL_BigTeleportParticles(vec3_t org)
 
 	for (i = 0; i < 4096; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = colortable[randk() & 3];
 
@@ -1025,16 +999,11 @@ CL_BlasterParticles(vec3_t org, vec3_t dir)
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = 0xe0 + (randk() & 7);
 		d = randk() & 15;
@@ -1077,15 +1046,10 @@ CL_BlasterTrail(vec3_t start, vec3_t end)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -1129,15 +1093,10 @@ CL_QuadTrail(vec3_t start, vec3_t end)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -1181,15 +1140,10 @@ CL_FlagTrail(vec3_t start, vec3_t end, int color)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -1251,18 +1205,14 @@ CL_DiminishingTrail(vec3_t start, vec3_t end, centity_t *old, int flags)
 	{
 		len -= dec;
 
-		if (!free_particles)
-		{
-			return;
-		}
-
 		/* drop less particles as it flies */
 		if ((randk() & 1023) < old->trailcount)
 		{
-			p = free_particles;
-			free_particles = p->next;
-			p->next = active_particles;
-			active_particles = p;
+			if (!(p = CL_AllocParticle()))
+			{
+				return;
+			}
+
 			VectorClear(p->accel);
 
 			p->time = time;
@@ -1369,17 +1319,13 @@ CL_RocketTrail(vec3_t start, vec3_t end, centity_t *old)
 	{
 		len -= dec;
 
-		if (!free_particles)
-		{
-			return;
-		}
-
 		if ((randk() & 7) == 0)
 		{
-			p = free_particles;
-			free_particles = p->next;
-			p->next = active_particles;
-			active_particles = p;
+			if (!(p = CL_AllocParticle()))
+			{
+				return;
+			}
+
 
 			VectorClear(p->accel);
 			p->time = time;
@@ -1427,16 +1373,11 @@ CL_RailTrail(vec3_t start, vec3_t end)
 
 	for (i = 0; i < len; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		VectorClear(p->accel);
 
@@ -1468,16 +1409,11 @@ CL_RailTrail(vec3_t start, vec3_t end)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		VectorClear(p->accel);
 
@@ -1521,15 +1457,10 @@ CL_IonripperTrail(vec3_t start, vec3_t ent)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -1583,16 +1514,11 @@ CL_BubbleTrail(vec3_t start, vec3_t end)
 
 	for (i = 0; i < len; i += 32)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		VectorClear(p->accel);
 		p->time = time;
 
@@ -1656,16 +1582,11 @@ CL_FlyParticles(vec3_t origin, int count)
 		forward[1] = cp * sy;
 		forward[2] = -sp;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 
 		dist = (float)sin(ltime + i) * 64;
@@ -1765,16 +1686,11 @@ CL_BfgParticles(entity_t *ent)
 		forward[1] = cp * sy;
 		forward[2] = -sp;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 
 		dist = (float)sin(ltime + i) * 64;
@@ -1824,15 +1740,10 @@ CL_TrapParticles(entity_t *ent)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -1869,16 +1780,11 @@ CL_TrapParticles(entity_t *ent)
 			{
 				for (k = -2; k <= 4; k += 4)
 				{
-					if (!free_particles)
+					if (!(p = CL_AllocParticle()))
 					{
 						return;
 					}
 
-					p = free_particles;
-					free_particles = p->next;
-					p->next = active_particles;
-					active_particles = p;
-
 					p->time = time;
 					p->color = 0xe0 + (randk() & 3);
 					p->alpha = 1.0;
@@ -1915,16 +1821,11 @@ CL_BFGExplosionParticles(vec3_t org)
 
 	for (i = 0; i < 256; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = 0xd0 + (randk() & 7);
 
@@ -1959,16 +1860,11 @@ CL_TeleportParticles(vec3_t org)
 		{
 			for (k = -16; k <= 32; k += 4)
 			{
-				if (!free_particles)
+				if (!(p = CL_AllocParticle()))
 				{
 					return;
 				}
 
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
-
 				p->time = time;
 				p->color = 7 + (randk() & 7);
 				p->alpha = 1.0;
@@ -2099,16 +1995,11 @@ CL_DebugTrail(vec3_t start, vec3_t end)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = (float)cl.time;
 		VectorClear(p->accel);
 		VectorClear(p->vel);
@@ -2142,15 +2033,10 @@ CL_SmokeTrail(vec3_t start, vec3_t end, int colorStart,
 	{
 		len -= spacing;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -2193,17 +2079,13 @@ CL_ForceWall(vec3_t start, vec3_t end, int color8)
 	{
 		len -= 4;
 
-		if (!free_particles)
-		{
-			return;
-		}
-
 		if (frandk() > 0.3)
 		{
-			p = free_particles;
-			free_particles = p->next;
-			p->next = active_particles;
-			active_particles = p;
+			if (!(p = CL_AllocParticle()))
+			{
+				return;
+			}
+
 			VectorClear(p->accel);
 
 			p->time = time;
@@ -2251,16 +2133,11 @@ CL_BubbleTrail2(vec3_t start, vec3_t end, int dist)
 
 	for (i = 0; i < len; i += dist)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		VectorClear(p->accel);
 		p->time = time;
 
@@ -2331,16 +2208,11 @@ CL_Heatbeam(vec3_t start, vec3_t forward)
 
 		for (rot = 0; rot < M_PI * 2; rot += rstep)
 		{
-			if (!free_particles)
+			if (!(p = CL_AllocParticle()))
 			{
 				return;
 			}
 
-			p = free_particles;
-			free_particles = p->next;
-			p->next = active_particles;
-			active_particles = p;
-
 			p->time = time;
 			VectorClear(p->accel);
 			variance = 0.5;
@@ -2391,16 +2263,11 @@ CL_ParticleSteamEffect(vec3_t org, vec3_t dir, int color,
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = color + (randk() & 7);
 
@@ -2437,16 +2304,11 @@ CL_ParticleSteamEffect2(cl_sustain_t *self)
 
 	for (i = 0; i < self->count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = cl.time;
 		p->color = self->color + (randk() & 7);
 
@@ -2500,15 +2362,10 @@ CL_TrackerTrail(vec3_t start, vec3_t end, int particleColor)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -2543,15 +2400,10 @@ CL_Tracker_Shell(vec3_t origin)
 
 	for (i = 0; i < 300; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -2580,15 +2432,10 @@ CL_MonsterPlasma_Shell(vec3_t origin)
 
 	for (i = 0; i < 40; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -2620,15 +2467,10 @@ CL_Widowbeamout(cl_sustain_t *self)
 
 	for (i = 0; i < 300; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -2660,15 +2502,10 @@ CL_Nukeblast(cl_sustain_t *self)
 
 	for (i = 0; i < 700; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -2698,16 +2535,11 @@ CL_WidowSplash(vec3_t org)
 
 	for (i = 0; i < 256; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = colortable[randk() & 3];
 		dir[0] = crandk();
@@ -2736,15 +2568,10 @@ CL_Tracker_Explode(vec3_t origin)
 
 	for (i = 0; i < 300; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -2787,15 +2614,10 @@ CL_TagTrail(vec3_t start, vec3_t end, int color)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
@@ -2827,16 +2649,11 @@ CL_ColorExplosionParticles(vec3_t org, int color, int run)
 
 	for (i = 0; i < 128; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = color + (randk() % run);
 
@@ -2873,16 +2690,11 @@ CL_ParticleSmokeEffect(vec3_t org, vec3_t dir, int color,
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = color + (randk() & 7);
 
@@ -2922,16 +2734,11 @@ CL_BlasterParticles2(vec3_t org, vec3_t dir, unsigned int color)
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = color + (randk() & 7);
 		d = (float)(randk() & 15);
@@ -2977,15 +2784,10 @@ CL_BlasterTrail2(vec3_t start, vec3_t end)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
-
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 		VectorClear(p->accel);
 
 		p->time = time;
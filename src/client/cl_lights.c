@@ -108,49 +108,102 @@ CL_AddLightStyles(void)
 	}
 }
 
-cdlight_t cl_dlights[MAX_DLIGHTS];
+cdlight_t cl_dlights[MAX_CL_DLIGHTS];
+
+/* lights with a key are hashed by it, the
+   chains hold index + 1, 0 ends them */
+#define DLIGHT_HASH_SIZE 64
+#define DLIGHT_HASH(key) ((unsigned)(key) & (DLIGHT_HASH_SIZE - 1))
+
+static int cl_dlighthash[DLIGHT_HASH_SIZE];
+static int cl_dlightrover;
 
 void
 CL_ClearDlights(void)
 {
 	memset(cl_dlights, 0, sizeof(cl_dlights));
+	memset(cl_dlighthash, 0, sizeof(cl_dlighthash));
+	cl_dlightrover = 0;
+}
+
+static void
+CL_SetDlightKey(cdlight_t *dl, int key)
+{
+	int index = (dl - cl_dlights) + 1;
+	int *link;
+
+	if (dl->key == key)
+	{
+		return;
+	}
+
+	if (dl->key)
+	{
+		/* unlink from the old key's chain */
+		for (link = &cl_dlighthash[DLIGHT_HASH(dl->key)]; *link;
+			link = &cl_dlights[*link - 1].hashnext)
+		{
+			if (*link == index)
+			{
+				*link = dl->hashnext;
+				break;
+			}
+		}
+	}
+
+	dl->key = key;
+	dl->hashnext = 0;
+
+	if (key)
+	{
+		dl->hashnext = cl_dlighthash[DLIGHT_HASH(key)];
+		cl_dlighthash[DLIGHT_HASH(key)] = index;
+	}
 }
 
 cdlight_t *
 CL_AllocDlight(int key)
 {
-	int i;
-	cdlight_t *dl;
+	int i, j;
+	cdlight_t *dl, *oldest;
 
 	/* first look for an exact key match */
 	if (key)
 	{
-		dl = cl_dlights;
-
-		for (i = 0; i < MAX_DLIGHTS; i++, dl++)
+		for (i = cl_dlighthash[DLIGHT_HASH(key)]; i; i = cl_dlights[i - 1].hashnext)
 		{
-			if (dl->key == key)
+			if (cl_dlights[i - 1].key == key)
 			{
-				return dl;
+				return &cl_dlights[i - 1];
 			}
 		}
 	}
 
-	/* then look for anything else */
-	dl = cl_dlights;
+	/* then look for anything else, starting
+	   after the last light handed out */
+	oldest = &cl_dlights[cl_dlightrover];
 
-	for (i = 0; i < MAX_DLIGHTS; i++, dl++)
+	for (i = 0; i < MAX_CL_DLIGHTS; i++)
 	{
+		j = (cl_dlightrover + i) % MAX_CL_DLIGHTS;
+		dl = &cl_dlights[j];
+
 		if (dl->die < cl.time)
 		{
-			dl->key = key;
+			cl_dlightrover = (j + 1) % MAX_CL_DLIGHTS;
+			CL_SetDlightKey(dl, key);
 			return dl;
 		}
+
+		if (dl->die < oldest->die)
+		{
+			oldest = dl;
+		}
 	}
 
-	dl = &cl_dlights[0];
-	dl->key = key;
-	return dl;
+	/* all in use, take the one that's gone first */
+	CL_SetDlightKey(oldest, key);
+	return oldest;
 }
 
 void
@@ -174,7 +227,7 @@ CL_RunDLights(void)
 
 	dl = cl_dlights;
 
-	for (i = 0; i < MAX_DLIGHTS; i++, dl++)
+	for (i = 0; i < MAX_CL_DLIGHTS; i++, dl++)
 	{
 		if (!dl->radius)
 		{
@@ -210,7 +263,7 @@ CL_AddDLights(void)
 
 	dl = cl_dlights;
 
-	for (i = 0; i < MAX_DLIGHTS; i++, dl++)
+	for (i = 0; i < MAX_CL_DLIGHTS; i++, dl++)
 	{
 		if (!dl->radius)
 		{
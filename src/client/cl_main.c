@@ -48,6 +48,7 @@ cvar_t *cl_showfps;
 cvar_t *cl_showspeed;
 cvar_t *cl_gun;
 cvar_t *cl_add_particles;
+cvar_t *cl_maxparticles;
 cvar_t *cl_add_lights;
 cvar_t *cl_add_entities;
 cvar_t *cl_add_blend;
@@ -568,6 +569,7 @@ CL_InitLocal(void)
 	cl_add_blend = Cvar_Get("cl_blend", "1", 0);
 	cl_add_lights = Cvar_Get("cl_lights", "1", 0);
 	cl_add_particles = Cvar_Get("cl_particles", "1", 0);
+	cl_maxparticles = Cvar_Get("cl_maxparticles", "16384", CVAR_ARCHIVE);
 	cl_add_entities = Cvar_Get("cl_entities", "1", 0);
 	cl_kickangles = Cvar_Get("cl_kickangles", "1", 0);
 	cl_gun = Cvar_Get("cl_gun", "2", CVAR_ARCHIVE);
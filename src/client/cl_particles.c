@@ -26,27 +26,129 @@
 
 #include "header/client.h"
 
-cparticle_t *active_particles, *free_particles;
-cparticle_t particles[MAX_PARTICLES];
-int cl_numparticles = MAX_PARTICLES;
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define USE_SSE_PARTICLES
+#include <xmmintrin.h>
+#endif
+
+/* upper limit for cl_maxparticles */
+#define MAX_PARTICLE_BUDGET (1024 * 1024)
+
+/*
+ * The particles are kept as a structure of arrays, so aging and moving
+ * them are straight loops over floats that are done four at a time with
+ * SSE. Effects write new particles into cparticle_t records returned by
+ * CL_AllocParticle(), CL_AddParticles() appends them to the arrays once
+ * per frame.
+ */
+typedef struct
+{
+	int num;
+	int max;
+
+	float *time;
+	float *org[3];
+	float *vel[3];
+	float *accel[3];
+	float *color;
+	float *alpha;
+	float *alphavel;
+
+	/* results of the current frame */
+	float *age;
+	float *drawalpha;
+} clparticles_t;
+
+#define PARTICLE_FLOATS 15
+
+static clparticles_t cl_parts;
+static float *cl_partsdata;
+
+static cparticle_t *cl_newparts;
+static int cl_numnewparts;
 
 void
 CL_ClearParticles(void)
 {
-	if (cl_numparticles == 0)
+	int i, max, stride;
+	float *data;
+
+	cl_parts.num = 0;
+	cl_numnewparts = 0;
+
+	max = cl_maxparticles ? (int)cl_maxparticles->value : MAX_PARTICLES;
+	max = Q_min(Q_max(max, 0), MAX_PARTICLE_BUDGET);
+
+	if (cl_maxparticles)
+	{
+		cl_maxparticles->modified = false;
+	}
+
+	if (max == cl_parts.max)
+	{
+		return;
+	}
+
+	free(cl_partsdata);
+	free(cl_newparts);
+	cl_partsdata = NULL;
+	cl_newparts = NULL;
+	cl_parts.max = 0;
+
+	if (max == 0)
+	{
 		return;
-		
-	int i;
+	}
+
+	/* keep every array 16 byte aligned */
+	stride = (max + 3) & ~3;
+
+	cl_partsdata = malloc(stride * PARTICLE_FLOATS * sizeof(float));
+	cl_newparts = malloc(max * sizeof(cparticle_t));
+
+	if (!cl_partsdata || !cl_newparts)
+	{
+		Com_Error(ERR_FATAL, "%s: Couldn't allocate %i particles", __func__, max);
+	}
 
-	free_particles = &particles[0];
-	active_particles = NULL;
+	data = cl_partsdata;
 
-	for (i = 0; i < cl_numparticles; i++)
+	cl_parts.time = data; data += stride;
+
+	for (i = 0; i < 3; i++)
+	{
+		cl_parts.org[i] = data; data += stride;
+		cl_parts.vel[i] = data; data += stride;
+		cl_parts.accel[i] = data; data += stride;
+	}
+
+	cl_parts.color = data; data += stride;
+	cl_parts.alpha = data; data += stride;
+	cl_parts.alphavel = data; data += stride;
+	cl_parts.age = data; data += stride;
+	cl_parts.drawalpha = data;
+
+	cl_parts.max = max;
+}
+
+/*
+ * Returns a new particle for the effect code to fill in,
+ * or NULL if the particle budget is used up.
+ */
+cparticle_t *
+CL_AllocParticle(void)
+{
+	cparticle_t *p;
+
+	if (cl_parts.num + cl_numnewparts >= cl_parts.max)
 	{
-		particles[i].next = &particles[i + 1];
+		return NULL;
 	}
 
-	particles[cl_numparticles - 1].next = NULL;
+	p = &cl_newparts[cl_numnewparts++];
+	memset(p, 0, sizeof(*p));
+
+	return p;
 }
 
 void
@@ -58,16 +160,11 @@ CL_ParticleEffect(vec3_t org, vec3_t dir, int color, int count)
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = cl.time;
 		p->color = color + (randk() & 7);
 		d = randk() & 31;
@@ -98,16 +195,11 @@ CL_ParticleEffect2(vec3_t org, vec3_t dir, int color, int count)
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = color + (randk() & 7);
 
@@ -139,16 +231,11 @@ CL_ParticleEffect3(vec3_t org, vec3_t dir, int color, int count)
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = color;
 
@@ -168,77 +255,192 @@ CL_ParticleEffect3(vec3_t org, vec3_t dir, int color, int count)
 	}
 }
 
-void
-CL_AddParticles(void)
+/*
+ * Moves the particles spawned since the last frame into the arrays
+ */
+static void
+CL_FlushNewParticles(void)
 {
-	cparticle_t *p, *next;
-	float alpha;
-	float time, time2;
-	vec3_t org;
-	int color;
-	cparticle_t *active, *tail;
-
-	active = NULL;
-	tail = NULL;
+	clparticles_t *ps = &cl_parts;
+	int i, j;
 
-	for (p = active_particles; p; p = next)
+	for (i = 0; i < cl_numnewparts; i++)
 	{
-		next = p->next;
+		const cparticle_t *p = &cl_newparts[i];
+		int n = ps->num + i;
+
+		ps->time[n] = p->time;
 
-		if (p->alphavel != INSTANT_PARTICLE)
+		for (j = 0; j < 3; j++)
 		{
-			time = (cl.time - p->time) * 0.001;
-			alpha = p->alpha + time * p->alphavel;
-
-			if (alpha <= 0)
-			{
-				/* faded out */
-				p->next = free_particles;
-				free_particles = p;
-				continue;
-			}
+			ps->org[j][n] = p->org[j];
+			ps->vel[j][n] = p->vel[j];
+			ps->accel[j][n] = p->accel[j];
 		}
-		else
+
+		ps->color[n] = p->color;
+		ps->alpha[n] = p->alpha;
+		ps->alphavel[n] = p->alphavel;
+	}
+
+	ps->num += cl_numnewparts;
+	cl_numnewparts = 0;
+}
+
+/*
+ * Calculates the age in seconds and the alpha of all particles.
+ * Instant particles don't age, they're shown once as they are.
+ */
+static void
+CL_AgeParticles(float now)
+{
+	clparticles_t *ps = &cl_parts;
+	int i = 0;
+
+#ifdef USE_SSE_PARTICLES
+	const __m128 vnow = _mm_set1_ps(now);
+	const __m128 vscale = _mm_set1_ps(0.001f);
+	const __m128 vone = _mm_set1_ps(1.0f);
+	const __m128 vinstant = _mm_set1_ps(INSTANT_PARTICLE);
+
+	for ( ; i + 4 <= ps->num; i += 4)
+	{
+		__m128 alphavel = _mm_loadu_ps(ps->alphavel + i);
+		__m128 age = _mm_mul_ps(_mm_sub_ps(vnow, _mm_loadu_ps(ps->time + i)), vscale);
+		__m128 alpha;
+
+		age = _mm_and_ps(age, _mm_cmpneq_ps(alphavel, vinstant));
+		alpha = _mm_add_ps(_mm_loadu_ps(ps->alpha + i), _mm_mul_ps(age, alphavel));
+
+		_mm_storeu_ps(ps->age + i, age);
+		_mm_storeu_ps(ps->drawalpha + i, _mm_min_ps(alpha, vone));
+	}
+#endif
+
+	for ( ; i < ps->num; i++)
+	{
+		float age = 0.0f;
+		float alpha;
+
+		if (ps->alphavel[i] != INSTANT_PARTICLE)
 		{
-			time = 0.0f;
-			alpha = p->alpha;
+			age = (now - ps->time[i]) * 0.001f;
 		}
 
-		p->next = NULL;
+		alpha = ps->alpha[i] + age * ps->alphavel[i];
 
-		if (!tail)
+		ps->age[i] = age;
+		ps->drawalpha[i] = Q_min(alpha, 1.0f);
+	}
+}
+
+/*
+ * Throws out the faded particles. Every particle is copied to the
+ * write position and the position only advances for those that are
+ * kept, so there's no unpredictable branch per particle.
+ */
+static void
+CL_CompactParticles(void)
+{
+	clparticles_t *ps = &cl_parts;
+	int i, j, k;
+
+	for (i = 0, j = 0; i < ps->num; i++)
+	{
+		qboolean instant = (ps->alphavel[i] == INSTANT_PARTICLE);
+
+		ps->time[j] = ps->time[i];
+
+		for (k = 0; k < 3; k++)
 		{
-			active = tail = p;
+			ps->org[k][j] = ps->org[k][i];
+			ps->vel[k][j] = ps->vel[k][i];
+			ps->accel[k][j] = ps->accel[k][i];
 		}
 
-		else
+		ps->color[j] = ps->color[i];
+		ps->alpha[j] = instant ? 0.0f : ps->alpha[i];
+		ps->alphavel[j] = instant ? 0.0f : ps->alphavel[i];
+		ps->age[j] = ps->age[i];
+		ps->drawalpha[j] = ps->drawalpha[i];
+
+		/* instant particles are drawn now and fade out next frame */
+		j += (instant || ps->drawalpha[i] > 0);
+	}
+
+	ps->num = j;
+}
+
+/*
+ * Writes the particles into the refresh's particle list,
+ * as org + vel * t + accel * t^2.
+ */
+static void
+CL_EmitParticles(particle_t *out, int num)
+{
+	clparticles_t *ps = &cl_parts;
+	int i = 0, j;
+
+#ifdef USE_SSE_PARTICLES
+	for ( ; i + 4 <= num; i += 4)
+	{
+		__m128 t = _mm_loadu_ps(ps->age + i);
+		__m128 t2 = _mm_mul_ps(t, t);
+		float org[3][4];
+
+		for (j = 0; j < 3; j++)
 		{
-			tail->next = p;
-			tail = p;
+			__m128 o = _mm_add_ps(_mm_loadu_ps(ps->org[j] + i),
+					_mm_mul_ps(_mm_loadu_ps(ps->vel[j] + i), t));
+
+			o = _mm_add_ps(o, _mm_mul_ps(_mm_loadu_ps(ps->accel[j] + i), t2));
+			_mm_storeu_ps(org[j], o);
 		}
 
-		if (alpha > 1.0f)
+		for (j = 0; j < 4; j++, out++)
 		{
-			alpha = 1;
+			out->origin[0] = org[0][j];
+			out->origin[1] = org[1][j];
+			out->origin[2] = org[2][j];
+			out->color = (int)ps->color[i + j];
+			out->alpha = ps->drawalpha[i + j];
 		}
+	}
+#endif
 
-		color = p->color;
-		time2 = time * time;
-
-		org[0] = p->org[0] + p->vel[0] * time + p->accel[0] * time2;
-		org[1] = p->org[1] + p->vel[1] * time + p->accel[1] * time2;
-		org[2] = p->org[2] + p->vel[2] * time + p->accel[2] * time2;
-
-		V_AddParticle(org, color, alpha);
+	for ( ; i < num; i++, out++)
+	{
+		float t = ps->age[i];
+		float t2 = t * t;
 
-		if (p->alphavel == INSTANT_PARTICLE)
+		for (j = 0; j < 3; j++)
 		{
-			p->alphavel = 0.0;
-			p->alpha = 0.0;
+			out->origin[j] = ps->org[j][i] + ps->vel[j][i] * t + ps->accel[j][i] * t2;
 		}
+
+		out->color = (int)ps->color[i];
+		out->alpha = ps->drawalpha[i];
+	}
+}
+
+void
+CL_AddParticles(void)
+{
+	if (cl_maxparticles->modified)
+	{
+		/* the budget changed, start over with the new one */
+		CL_ClearParticles();
+		return;
 	}
 
-	active_particles = active;
+	CL_FlushNewParticles();
+	CL_AgeParticles((float)cl.time);
+	CL_CompactParticles();
+
+	if (cl_parts.num > 0)
+	{
+		CL_EmitParticles(V_AllocParticles(cl_parts.num), cl_parts.num);
+	}
 }
 
 void
@@ -254,16 +456,11 @@ CL_GenericParticleEffect(vec3_t org, vec3_t dir, int color,
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 
 		if (numcolors > 1)
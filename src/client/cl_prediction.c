@@ -77,23 +77,61 @@ CL_CheckPredictionError(void)
 	}
 }
 
-void
-CL_ClipMoveToEntities(vec3_t start, vec3_t mins, vec3_t maxs,
-		vec3_t end, trace_t *tr)
+/*
+ * The solid entities of the current frame, gathered once per
+ * frame instead of for every trace and sorted by their lowest
+ * x coordinate, so traces only look at entities near them.
+ */
+typedef struct
 {
-	int i, x, zd, zu;
-	trace_t trace;
-	int headnode;
+	entity_state_t *ent;
+	int headnode; /* bmodels only */
 	float *angles;
+	vec3_t bmins, bmaxs; /* boxes only */
+	vec3_t absmin, absmax;
+} clsolid_t;
+
+static clsolid_t cl_solids[MAX_PARSE_ENTITIES];
+static int cl_numsolids;
+static int cl_solidsframe = -1, cl_solidsparse = -1, cl_solidsservercount = -1;
+
+static int
+CL_SolidCompare(const void *a, const void *b)
+{
+	const clsolid_t *sa = (const clsolid_t *)a;
+	const clsolid_t *sb = (const clsolid_t *)b;
+
+	if (sa->absmin[0] < sb->absmin[0])
+	{
+		return -1;
+	}
+
+	return sa->absmin[0] > sb->absmin[0];
+}
+
+static void
+CL_BuildSolidList(void)
+{
+	int i, j, x, zd, zu;
 	entity_state_t *ent;
-	int num;
+	clsolid_t *solid;
 	cmodel_t *cmodel;
-	vec3_t bmins, bmaxs;
+
+	if ((cl_solidsframe == cl.frame.serverframe) &&
+		(cl_solidsparse == cl.frame.parse_entities) &&
+		(cl_solidsservercount == cl.servercount))
+	{
+		return;
+	}
+
+	cl_solidsframe = cl.frame.serverframe;
+	cl_solidsparse = cl.frame.parse_entities;
+	cl_solidsservercount = cl.servercount;
+	cl_numsolids = 0;
 
 	for (i = 0; i < cl.frame.num_entities; i++)
 	{
-		num = (cl.frame.parse_entities + i) & (MAX_PARSE_ENTITIES - 1);
-		ent = &cl_parse_entities[num];
+		ent = &cl_parse_entities[(cl.frame.parse_entities + i) & (MAX_PARSE_ENTITIES - 1)];
 
 		if (!ent->solid)
 		{
@@ -105,6 +143,9 @@ CL_ClipMoveToEntities(vec3_t start, vec3_t mins, vec3_t maxs,
 			continue;
 		}
 
+		solid = &cl_solids[cl_numsolids];
+		solid->ent = ent;
+
 		if (ent->solid == 31)
 		{
 			/* special value for bmodel */
@@ -115,8 +156,34 @@ CL_ClipMoveToEntities(vec3_t start, vec3_t mins, vec3_t maxs,
 				continue;
 			}
 
-			headnode = cmodel->headnode;
-			angles = ent->angles;
+			solid->headnode = cmodel->headnode;
+			solid->angles = ent->angles;
+
+			if (ent->angles[0] || ent->angles[1] || ent->angles[2])
+			{
+				/* rotated, use the bounding sphere */
+				float radius = 0;
+
+				for (j = 0; j < 3; j++)
+				{
+					float v = Q_max(fabs(cmodel->mins[j]), fabs(cmodel->maxs[j]));
+
+					radius += v * v;
+				}
+
+				radius = sqrt(radius);
+
+				for (j = 0; j < 3; j++)
+				{
+					solid->absmin[j] = ent->origin[j] - radius;
+					solid->absmax[j] = ent->origin[j] + radius;
+				}
+			}
+			else
+			{
+				VectorAdd(ent->origin, cmodel->mins, solid->absmin);
+				VectorAdd(ent->origin, cmodel->maxs, solid->absmax);
+			}
 		}
 		else
 		{
@@ -125,13 +192,65 @@ CL_ClipMoveToEntities(vec3_t start, vec3_t mins, vec3_t maxs,
 			zd = 8 * ((ent->solid >> 5) & 31);
 			zu = 8 * ((ent->solid >> 10) & 63) - 32;
 
-			bmins[0] = bmins[1] = -(float)x;
-			bmaxs[0] = bmaxs[1] = (float)x;
-			bmins[2] = -(float)zd;
-			bmaxs[2] = (float)zu;
+			solid->bmins[0] = solid->bmins[1] = -(float)x;
+			solid->bmaxs[0] = solid->bmaxs[1] = (float)x;
+			solid->bmins[2] = -(float)zd;
+			solid->bmaxs[2] = (float)zu;
+
+			solid->headnode = 0;
+			solid->angles = vec3_origin; /* boxes don't rotate */
+
+			VectorAdd(ent->origin, solid->bmins, solid->absmin);
+			VectorAdd(ent->origin, solid->bmaxs, solid->absmax);
+		}
+
+		cl_numsolids++;
+	}
+
+	qsort(cl_solids, cl_numsolids, sizeof(clsolid_t), CL_SolidCompare);
+}
 
-			headnode = CM_HeadnodeForBox(bmins, bmaxs);
-			angles = vec3_origin; /* boxes don't rotate */
+void
+CL_ClipMoveToEntities(vec3_t start, vec3_t mins, vec3_t maxs,
+		vec3_t end, trace_t *tr)
+{
+	int i, j;
+	trace_t trace;
+	int headnode;
+	clsolid_t *solid;
+	vec3_t tmins, tmaxs;
+
+	CL_BuildSolidList();
+
+	/* bounds of the whole move */
+	for (j = 0; j < 3; j++)
+	{
+		tmins[j] = Q_min(start[j], end[j]) + mins[j] - 1;
+		tmaxs[j] = Q_max(start[j], end[j]) + maxs[j] + 1;
+	}
+
+	for (i = 0, solid = cl_solids; i < cl_numsolids; i++, solid++)
+	{
+		if (solid->absmin[0] > tmaxs[0])
+		{
+			/* sorted, so all others are further away */
+			break;
+		}
+
+		if ((solid->absmax[0] < tmins[0]) ||
+			(solid->absmin[1] > tmaxs[1]) || (solid->absmax[1] < tmins[1]) ||
+			(solid->absmin[2] > tmaxs[2]) || (solid->absmax[2] < tmins[2]))
+		{
+			continue;
+		}
+
+		if (solid->ent->solid == 31)
+		{
+			headnode = solid->headnode;
+		}
+		else
+		{
+			headnode = CM_HeadnodeForBox(solid->bmins, solid->bmaxs);
 		}
 
 		if (tr->allsolid)
@@ -141,12 +260,12 @@ CL_ClipMoveToEntities(vec3_t start, vec3_t mins, vec3_t maxs,
 
 		trace = CM_TransformedBoxTrace(start, end,
 				mins, maxs, headnode, MASK_PLAYERSOLID,
-				ent->origin, angles);
+				solid->ent->origin, solid->angles);
 
 		if (trace.allsolid || trace.startsolid ||
 			(trace.fraction < tr->fraction))
 		{
-			trace.ent = (struct edict_s *)ent;
+			trace.ent = (struct edict_s *)solid->ent;
 
 			if (tr->startsolid)
 			{
@@ -184,44 +303,103 @@ int
 CL_PMpointcontents(const vec3_t point)
 {
 	int i;
-	entity_state_t *ent;
-	int num;
-	cmodel_t *cmodel;
+	clsolid_t *solid;
 	int contents;
 
 	contents = CM_PointContents(point, 0);
 
-	for (i = 0; i < cl.frame.num_entities; i++)
+	CL_BuildSolidList();
+
+	for (i = 0, solid = cl_solids; i < cl_numsolids; i++, solid++)
 	{
-		num = (cl.frame.parse_entities + i) & (MAX_PARSE_ENTITIES - 1);
-		ent = &cl_parse_entities[num];
+		if (solid->absmin[0] > point[0])
+		{
+			break;
+		}
 
-		if (ent->solid != 31) /* special value for bmodel */
+		if (solid->ent->solid != 31) /* special value for bmodel */
 		{
 			continue;
 		}
 
-		cmodel = cl.model_clip[ent->modelindex];
-
-		if (!cmodel)
+		if ((solid->absmax[0] < point[0]) ||
+			(solid->absmin[1] > point[1]) || (solid->absmax[1] < point[1]) ||
+			(solid->absmin[2] > point[2]) || (solid->absmax[2] < point[2]))
 		{
 			continue;
 		}
 
-		contents |= CM_TransformedPointContents(point, cmodel->headnode,
-				ent->origin, ent->angles);
+		contents |= CM_TransformedPointContents(point, solid->headnode,
+				solid->ent->origin, solid->angles);
 	}
 
 	return contents;
 }
 
+static qboolean
+CL_PmoveStateEqual(const pmove_state_t *a, const pmove_state_t *b)
+{
+	int i;
+
+	if ((a->pm_type != b->pm_type) || (a->pm_flags != b->pm_flags) ||
+		(a->pm_time != b->pm_time) || (a->gravity != b->gravity))
+	{
+		return false;
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		if ((a->origin[i] != b->origin[i]) ||
+			(a->velocity[i] != b->velocity[i]) ||
+			(a->delta_angles[i] != b->delta_angles[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * The results of cmds up to cl.predicted_last were calculated
+ * on top of an earlier server frame. If the server's state for
+ * the acknowledged cmd matches what was predicted for it, they're
+ * still valid and only newer cmds must be run. Otherwise (server
+ * correction, teleport, being pushed, ...) the cache starts over
+ * at the server's state.
+ */
+static void
+CL_ValidatePrediction(int ack)
+{
+	int frame = ack & (CMD_BACKUP - 1);
+
+	if (cl.predicted_serverframe == cl.frame.serverframe)
+	{
+		return;
+	}
+
+	cl.predicted_serverframe = cl.frame.serverframe;
+
+	if ((ack >= cl.predicted_base) && (ack <= cl.predicted_last) &&
+		(cl.predicted_last - ack < CMD_BACKUP) &&
+		CL_PmoveStateEqual(&cl.predicted_states[frame], &cl.frame.playerstate.pmove))
+	{
+		cl.predicted_base = ack;
+		return;
+	}
+
+	cl.predicted_base = cl.predicted_last = ack;
+	cl.predicted_states[frame] = cl.frame.playerstate.pmove;
+	VectorCopy(cl.frame.playerstate.viewangles, cl.predicted_viewangles[frame]);
+}
+
 /*
  * Sets cl.predicted_origin and cl.predicted_angles
  */
 void
 CL_PredictMovement(void)
 {
-	int ack, current;
+	int ack, current, seq;
 	int frame;
 	usercmd_t *cmd;
 	pmove_t pm;
@@ -266,25 +444,46 @@ CL_PredictMovement(void)
 		return;
 	}
 
-	/* copy current state to pmove */
+	CL_ValidatePrediction(ack);
+
+	/* continue after the last cached result */
+	frame = cl.predicted_last & (CMD_BACKUP - 1);
+
 	memset (&pm, 0, sizeof(pm));
 	pm.trace = CL_PMTrace;
 	pm.pointcontents = CL_PMpointcontents;
 	pm_airaccelerate = atof(cl.configstrings[CS_AIRACCEL]);
-	pm.s = cl.frame.playerstate.pmove;
+	pm.s = cl.predicted_states[frame];
+	VectorCopy(cl.predicted_viewangles[frame], pm.viewangles);
 
-	/* run frames */
-	while (++ack <= current)
+	/* run the cmds that were sent since, their results are cached */
+	for (seq = cl.predicted_last + 1; seq < current; seq++)
 	{
-		frame = ack & (CMD_BACKUP - 1);
+		frame = seq & (CMD_BACKUP - 1);
 		cmd = &cl.cmds[frame];
 
 		// Ignore null entries
-		if (!cmd->msec)
+		if (cmd->msec)
 		{
-			continue;
+			pm.cmd = *cmd;
+			Pmove(&pm);
+
+			/* save for debug checking */
+			VectorCopy(pm.s.origin, cl.predicted_origins[frame]);
 		}
 
+		cl.predicted_states[frame] = pm.s;
+		VectorCopy(pm.viewangles, cl.predicted_viewangles[frame]);
+		cl.predicted_last = seq;
+	}
+
+	/* the cmd being built changes until it's sent,
+	   so it's run every frame and not cached */
+	frame = current & (CMD_BACKUP - 1);
+	cmd = &cl.cmds[frame];
+
+	if (cmd->msec)
+	{
 		pm.cmd = *cmd;
 		Pmove(&pm);
 
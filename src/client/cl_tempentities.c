@@ -44,11 +44,31 @@ typedef struct
 	int baseframe;
 } explosion_t;
 
-#define MAX_EXPLOSIONS 64
-#define MAX_BEAMS 64
-#define MAX_LASERS 64
+#define MAX_EXPLOSIONS 256
+#define MAX_BEAMS 128
+#define MAX_LASERS 128
+#define MAX_TENT_POOL 256 /* largest of the above */
+
+/*
+ * Slot bookkeeping for the temp entity arrays. Unused
+ * slots are on a free stack and used ones in a packed
+ * active list, so allocating and freeing is O(1) and
+ * the per-frame passes only walk what's actually alive.
+ * Freeing swaps the last active slot into the hole, so
+ * loops that free while walking must walk backwards.
+ */
+typedef struct
+{
+	int size;
+	int numactive;
+	int numfree;
+	short active[MAX_TENT_POOL];
+	short free[MAX_TENT_POOL];
+	short where[MAX_TENT_POOL]; /* position in active[] */
+} tentpool_t;
 
 static explosion_t cl_explosions[MAX_EXPLOSIONS];
+static tentpool_t cl_explosionpool;
 
 typedef struct
 {
@@ -62,6 +82,8 @@ typedef struct
 
 static beam_t cl_beams[MAX_BEAMS];
 static beam_t cl_heatbeams[MAX_BEAMS];
+static tentpool_t cl_beampool;
+static tentpool_t cl_heatbeampool;
 
 typedef struct
 {
@@ -70,8 +92,10 @@ typedef struct
 } laser_t;
 
 static laser_t cl_lasers[MAX_LASERS];
+static tentpool_t cl_laserpool;
 
 static cl_sustain_t cl_sustains[MAX_SUSTAINS];
+static tentpool_t cl_sustainpool;
 
 extern void CL_TeleportParticles(vec3_t org);
 void CL_BlasterParticles(vec3_t org, vec3_t dir);
@@ -123,31 +147,86 @@ static struct model_s *cl_mod_explo4_big;
 /*
  * Utility functions
  */
+static void
+CL_PoolClear(tentpool_t *pool, int size)
+{
+	int i;
+
+	pool->size = size;
+	pool->numactive = 0;
+	pool->numfree = size;
+
+	/* hand out low slots first */
+	for (i = 0; i < size; i++)
+	{
+		pool->free[i] = size - 1 - i;
+	}
+}
+
+/*
+ * Returns the index of a
+ * fresh slot or -1 if full.
+ */
+static int
+CL_PoolAlloc(tentpool_t *pool)
+{
+	int i;
+
+	if (!pool->numfree)
+	{
+		return -1;
+	}
+
+	i = pool->free[--pool->numfree];
+
+	pool->where[i] = pool->numactive;
+	pool->active[pool->numactive++] = i;
+
+	return i;
+}
+
+static void
+CL_PoolFree(tentpool_t *pool, int i)
+{
+	int pos, last;
+
+	pos = pool->where[i];
+	last = pool->active[--pool->numactive];
+
+	pool->active[pos] = last;
+	pool->where[last] = pos;
+
+	pool->free[pool->numfree++] = i;
+}
+
 static beam_t *
-CL_Beams_NextFree(const beam_t *list)
+CL_Beams_NextFree(beam_t *list, tentpool_t *pool)
 {
-	const beam_t *b;
+	int i;
 
-	for (b = list; b < &list[MAX_BEAMS]; b++)
+	i = CL_PoolAlloc(pool);
+
+	if (i < 0)
 	{
-		if (!b->model || (b->endtime < cl.time))
-			return (beam_t *)b;
+		return NULL;
 	}
 
-	return NULL;
+	return &list[i];
 }
 
 static beam_t *
-CL_Beams_SameEnt(const beam_t *list, int src, int dest)
+CL_Beams_SameEnt(beam_t *list, const tentpool_t *pool, int src, int dest)
 {
-	const beam_t *b;
+	int i;
 
-	for (b = list; b < &list[MAX_BEAMS]; b++)
+	for (i = 0; i < pool->numactive; i++)
 	{
+		beam_t *b = &list[pool->active[i]];
+
 		if ((src < 0 || b->entity == src) &&
 			(dest < 0 || b->dest_entity == dest))
 		{
-			return (beam_t *)b;
+			return b;
 		}
 	}
 
@@ -182,50 +261,46 @@ CL_Beams_Set(beam_t *b,
 static cl_sustain_t *
 CL_NextFreeSustain(void)
 {
-	cl_sustain_t *s;
+	int i;
+
+	i = CL_PoolAlloc(&cl_sustainpool);
 
-	for (s = cl_sustains; s < &cl_sustains[MAX_SUSTAINS]; s++)
+	if (i < 0)
 	{
-		if (s->id == 0)
-		{
-			return s;
-		}
+		return NULL;
 	}
 
-	return NULL;
+	return &cl_sustains[i];
 }
 
 static explosion_t *
 CL_AllocExplosion(void)
 {
-	int i;
+	int i, j;
 	float time;
-	int index;
-
-	for (i = 0; i < MAX_EXPLOSIONS; i++)
-	{
-		if (cl_explosions[i].type == ex_free)
-		{
-			memset(&cl_explosions[i], 0, sizeof(cl_explosions[i]));
-			return &cl_explosions[i];
-		}
-	}
 
-	/* find the oldest explosion */
-	time = (float)cl.time;
-	index = 0;
+	i = CL_PoolAlloc(&cl_explosionpool);
 
-	for (i = 0; i < MAX_EXPLOSIONS; i++)
+	if (i < 0)
 	{
-		if (cl_explosions[i].start < time)
+		/* full, reuse the oldest explosion */
+		time = (float)cl.time;
+		i = cl_explosionpool.active[0];
+
+		for (j = 0; j < cl_explosionpool.numactive; j++)
 		{
-			time = cl_explosions[i].start;
-			index = i;
+			int k = cl_explosionpool.active[j];
+
+			if (cl_explosions[k].start < time)
+			{
+				time = cl_explosions[k].start;
+				i = k;
+			}
 		}
 	}
 
-	memset(&cl_explosions[index], 0, sizeof(cl_explosions[index]));
-	return &cl_explosions[index];
+	memset(&cl_explosions[i], 0, sizeof(cl_explosions[i]));
+	return &cl_explosions[i];
 }
 
 /*
@@ -353,6 +428,12 @@ CL_ClearTEnts(void)
 	memset(cl_heatbeams, 0, sizeof(cl_heatbeams));
 	memset(cl_sustains, 0, sizeof(cl_sustains));
 
+	CL_PoolClear(&cl_beampool, MAX_BEAMS);
+	CL_PoolClear(&cl_explosionpool, MAX_EXPLOSIONS);
+	CL_PoolClear(&cl_laserpool, MAX_LASERS);
+	CL_PoolClear(&cl_heatbeampool, MAX_BEAMS);
+	CL_PoolClear(&cl_sustainpool, MAX_SUSTAINS);
+
 	CL_ClearTEntModelVars();
 	CL_ClearTEntSoundVars();
 }
@@ -365,6 +446,10 @@ CL_ClearTEntModels(void)
 	memset(cl_beams, 0, sizeof(cl_beams));
 	memset(cl_heatbeams, 0, sizeof(cl_heatbeams));
 
+	CL_PoolClear(&cl_explosionpool, MAX_EXPLOSIONS);
+	CL_PoolClear(&cl_beampool, MAX_BEAMS);
+	CL_PoolClear(&cl_heatbeampool, MAX_BEAMS);
+
 	CL_ClearTEntModelVars();
 }
 
@@ -436,11 +521,11 @@ CL_ParseBeam(struct model_s *model, qboolean with_offset)
 	}
 
 	/* override any beam with the same entity */
-	b = CL_Beams_SameEnt(cl_beams, ent, -1);
+	b = CL_Beams_SameEnt(cl_beams, &cl_beampool, ent, -1);
 
 	if (!b)
 	{
-		b = CL_Beams_NextFree(cl_beams);
+		b = CL_Beams_NextFree(cl_beams, &cl_beampool);
 
 		if (!b)
 		{
@@ -484,11 +569,11 @@ CL_ParseHeatBeam(qboolean is_monster)
 	/* Override any beam with the same entity
 	   For player beams, we only want one per
 	   player (entity) so... */
-	b = CL_Beams_SameEnt(cl_heatbeams, ent, -1);
+	b = CL_Beams_SameEnt(cl_heatbeams, &cl_heatbeampool, ent, -1);
 
 	if (!b)
 	{
-		b = CL_Beams_NextFree(cl_heatbeams);
+		b = CL_Beams_NextFree(cl_heatbeams, &cl_heatbeampool);
 
 		if (!b)
 		{
@@ -537,11 +622,11 @@ CL_ParseLightning(struct model_s *model)
 
 	/* override any beam with the same
 	   source AND destination entities */
-	b = CL_Beams_SameEnt(cl_beams, srcEnt, destEnt);
+	b = CL_Beams_SameEnt(cl_beams, &cl_beampool, srcEnt, destEnt);
 
 	if (!b)
 	{
-		b = CL_Beams_NextFree(cl_beams);
+		b = CL_Beams_NextFree(cl_beams, &cl_beampool);
 
 		if (!b)
 		{
@@ -562,36 +647,39 @@ CL_ParseLaser(int colors)
 	vec3_t start;
 	vec3_t end;
 	laser_t *l;
+	float alpha;
 	int i;
 
 	MSG_ReadPos(&net_message, start);
 	MSG_ReadPos(&net_message, end);
 
-	for (i = 0, l = cl_lasers; i < MAX_LASERS; i++, l++)
+	i = CL_PoolAlloc(&cl_laserpool);
+
+	if (i < 0)
 	{
-		if (l->endtime < cl.time)
-		{
-			float alpha = cl_laseralpha->value;
-			if (alpha < 0.0f)
-			{
-				alpha = 0.0f;
-			}
-			else if (alpha > 1.0f)
-			{
-				alpha = 1.0f;
-			}
+		return;
+	}
 
-			l->ent.flags = RF_TRANSLUCENT | RF_BEAM;
-			VectorCopy(start, l->ent.origin);
-			VectorCopy(end, l->ent.oldorigin);
-			l->ent.alpha = alpha;
-			l->ent.skinnum = (colors >> ((randk() % 4) * 8)) & 0xff;
-			l->ent.model = NULL;
-			l->ent.frame = 4;
-			l->endtime = cl.time + 100;
-			return;
-		}
+	l = &cl_lasers[i];
+
+	alpha = cl_laseralpha->value;
+	if (alpha < 0.0f)
+	{
+		alpha = 0.0f;
 	}
+	else if (alpha > 1.0f)
+	{
+		alpha = 1.0f;
+	}
+
+	l->ent.flags = RF_TRANSLUCENT | RF_BEAM;
+	VectorCopy(start, l->ent.origin);
+	VectorCopy(end, l->ent.oldorigin);
+	l->ent.alpha = alpha;
+	l->ent.skinnum = (colors >> ((randk() % 4) * 8)) & 0xff;
+	l->ent.model = NULL;
+	l->ent.frame = 4;
+	l->endtime = cl.time + 100;
 }
 
 static void
@@ -1359,11 +1447,15 @@ CL_AddBeams(void)
 	float yaw, pitch;
 	float len, steps;
 	float model_length;
+	int i;
 
-	for (b = cl_beams; b < &cl_beams[MAX_BEAMS]; b++)
+	for (i = cl_beampool.numactive - 1; i >= 0; i--)
 	{
+		b = &cl_beams[cl_beampool.active[i]];
+
 		if (!b->model || (b->endtime < cl.time))
 		{
+			CL_PoolFree(&cl_beampool, cl_beampool.active[i]);
 			continue;
 		}
 
@@ -1522,13 +1614,17 @@ CL_AddHeatBeams(void)
 	float model_length;
 	int by_us;
 	float hand_mul;
+	int i;
 
 	hand_mul = HandMul();
 
-	for (b = cl_heatbeams; b < &cl_heatbeams[MAX_BEAMS]; b++)
+	for (i = cl_heatbeampool.numactive - 1; i >= 0; i--)
 	{
+		b = &cl_heatbeams[cl_heatbeampool.active[i]];
+
 		if (!b->model || (b->endtime < cl.time))
 		{
+			CL_PoolFree(&cl_heatbeampool, cl_heatbeampool.active[i]);
 			continue;
 		}
 
@@ -1631,12 +1727,13 @@ CL_AddExplosions(void)
 	float frac;
 	int f;
 
-	memset(&ent, 0, sizeof(ent));
-
-	for (i = 0, ex = cl_explosions; i < MAX_EXPLOSIONS; i++, ex++)
+	for (i = cl_explosionpool.numactive - 1; i >= 0; i--)
 	{
+		ex = &cl_explosions[cl_explosionpool.active[i]];
+
 		if (ex->type == ex_free)
 		{
+			CL_PoolFree(&cl_explosionpool, cl_explosionpool.active[i]);
 			continue;
 		}
 
@@ -1728,6 +1825,7 @@ CL_AddExplosions(void)
 
 		if (ex->type == ex_free)
 		{
+			CL_PoolFree(&cl_explosionpool, cl_explosionpool.active[i]);
 			continue;
 		}
 
@@ -1758,12 +1856,17 @@ CL_AddLasers(void)
 	laser_t *l;
 	int i;
 
-	for (i = 0, l = cl_lasers; i < MAX_LASERS; i++, l++)
+	for (i = cl_laserpool.numactive - 1; i >= 0; i--)
 	{
-		if (l->endtime >= cl.time)
+		l = &cl_lasers[cl_laserpool.active[i]];
+
+		if (l->endtime < cl.time)
 		{
-			V_AddEntity(&l->ent);
+			CL_PoolFree(&cl_laserpool, cl_laserpool.active[i]);
+			continue;
 		}
+
+		V_AddEntity(&l->ent);
 	}
 }
 
@@ -1773,18 +1876,18 @@ CL_ProcessSustain()
 	cl_sustain_t *s;
 	int i;
 
-	for (i = 0, s = cl_sustains; i < MAX_SUSTAINS; i++, s++)
+	for (i = cl_sustainpool.numactive - 1; i >= 0; i--)
 	{
-		if (s->id)
+		s = &cl_sustains[cl_sustainpool.active[i]];
+
+		if (s->endtime < cl.time)
 		{
-			if ((s->endtime >= cl.time) && (cl.time >= s->nextthink))
-			{
-				s->think(s);
-			}
-			else if (s->endtime < cl.time)
-			{
-				s->id = 0;
-			}
+			s->id = 0;
+			CL_PoolFree(&cl_sustainpool, cl_sustainpool.active[i]);
+		}
+		else if (cl.time >= s->nextthink)
+		{
+			s->think(s);
 		}
 	}
 }
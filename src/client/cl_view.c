@@ -49,16 +49,26 @@ cvar_t *crosshair_3d_glow_b;
 
 cvar_t *cl_stats;
 
-static int r_numdlights;
-static dlight_t r_dlights[MAX_DLIGHTS];
+/*
+ * The scene the client builds each frame, V_RenderView()
+ * points the refdef_t at these arrays. The refresh is
+ * called synchronously, so a single one is enough.
+ */
+typedef struct
+{
+	int numdlights;
+	dlight_t dlights[MAX_CL_DLIGHTS];
+
+	int numentities;
+	entity_t entities[MAX_ENTITIES];
 
-static int r_numentities;
-static entity_t r_entities[MAX_ENTITIES];
+	int numparticles, maxparticles;
+	particle_t *particles;
 
-static int r_numparticles;
-static particle_t r_particles[MAX_PARTICLES];
+	lightstyle_t lightstyles[MAX_LIGHTSTYLES];
+} clscene_t;
 
-static lightstyle_t r_lightstyles[MAX_LIGHTSTYLES];
+static clscene_t r_scene;
 
 char cl_weaponmodels[MAX_CLIENTWEAPONMODELS][MAX_QPATH];
 int num_cl_weaponmodels;
@@ -69,36 +79,69 @@ int num_cl_weaponmodels;
 void
 V_ClearScene(void)
 {
-	r_numdlights = 0;
-	r_numentities = 0;
-	r_numparticles = 0;
+	r_scene.numdlights = 0;
+	r_scene.numentities = 0;
+	r_scene.numparticles = 0;
 }
 
 void
 V_AddEntity(entity_t *ent)
 {
-	if (r_numentities >= MAX_ENTITIES)
+	if (r_scene.numentities >= MAX_ENTITIES)
 	{
 		return;
 	}
 
-	r_entities[r_numentities++] = *ent;
+	r_scene.entities[r_scene.numentities++] = *ent;
 }
 
-void
-V_AddParticle(vec3_t org, unsigned int color, float alpha)
+/*
+ * Makes sure there's room for count particles, the list only grows
+ */
+static void
+V_GrowParticles(int count)
 {
 	particle_t *p;
+	int max;
 
-	if (r_numparticles >= MAX_PARTICLES)
+	if (count <= r_scene.maxparticles)
 	{
 		return;
 	}
 
-	p = &r_particles[r_numparticles++];
-	VectorCopy(org, p->origin);
-	p->color = color;
-	p->alpha = alpha;
+	max = r_scene.maxparticles ? r_scene.maxparticles : MAX_PARTICLES;
+
+	while (max < count)
+	{
+		max *= 2;
+	}
+
+	p = realloc(r_scene.particles, max * sizeof(particle_t));
+
+	if (!p)
+	{
+		Com_Error(ERR_FATAL, "%s: Couldn't allocate %i particles", __func__, max);
+	}
+
+	r_scene.particles = p;
+	r_scene.maxparticles = max;
+}
+
+/*
+ * Appends count particles to the list and returns the first one,
+ * the caller fills them in directly.
+ */
+particle_t *
+V_AllocParticles(int count)
+{
+	particle_t *p;
+
+	V_GrowParticles(r_scene.numparticles + count);
+
+	p = &r_scene.particles[r_scene.numparticles];
+	r_scene.numparticles += count;
+
+	return p;
 }
 
 void
@@ -106,12 +149,12 @@ V_AddLight(vec3_t org, float intensity, float r, float g, float b)
 {
 	dlight_t *dl;
 
-	if (r_numdlights >= MAX_DLIGHTS)
+	if (r_scene.numdlights >= MAX_CL_DLIGHTS)
 	{
 		return;
 	}
 
-	dl = &r_dlights[r_numdlights++];
+	dl = &r_scene.dlights[r_scene.numdlights++];
 	VectorCopy(org, dl->origin);
 	dl->intensity = intensity;
 	dl->color[0] = r;
@@ -129,7 +172,7 @@ V_AddLightStyle(int style, float r, float g, float b)
 		Com_Error(ERR_DROP, "Bad light style %i", style);
 	}
 
-	ls = &r_lightstyles[style];
+	ls = &r_scene.lightstyles[style];
 
 	ls->white = r + g + b;
 	ls->rgb[0] = r;
@@ -147,14 +190,15 @@ V_TestParticles(void)
 	int i, j;
 	float d, r, u;
 
-	r_numparticles = MAX_PARTICLES;
+	V_GrowParticles(MAX_PARTICLES);
+	r_scene.numparticles = MAX_PARTICLES;
 
-	for (i = 0; i < r_numparticles; i++)
+	for (i = 0; i < r_scene.numparticles; i++)
 	{
 		d = i * 0.25f;
 		r = 4 * ((i & 7) - 3.5f);
 		u = 4 * (((i >> 3) & 7) - 3.5f);
-		p = &r_particles[i];
+		p = &r_scene.particles[i];
 
 		for (j = 0; j < 3; j++)
 		{
@@ -177,12 +221,12 @@ V_TestEntities(void)
 	float f, r;
 	entity_t *ent;
 
-	r_numentities = 32;
-	memset(r_entities, 0, sizeof(r_entities));
+	r_scene.numentities = 32;
+	memset(r_scene.entities, 0, sizeof(r_scene.entities));
 
-	for (i = 0; i < r_numentities; i++)
+	for (i = 0; i < r_scene.numentities; i++)
 	{
-		ent = &r_entities[i];
+		ent = &r_scene.entities[i];
 
 		r = 64.0f * ((float)(i % 4) - 1.5f);
 		f = (float)(64 * (i / 4) + 128);
@@ -206,16 +250,16 @@ V_TestLights(void)
 {
 	int i;
 
-	r_numdlights = 32;
-	memset(r_dlights, 0, sizeof(r_dlights));
+	r_scene.numdlights = 32;
+	memset(r_scene.dlights, 0, sizeof(r_scene.dlights));
 
-	for (i = 0; i < r_numdlights; i++)
+	for (i = 0; i < r_scene.numdlights; i++)
 	{
 		dlight_t *dl;
 		float f, r;
 		int j;
 
-		dl = &r_dlights[i];
+		dl = &r_scene.dlights[i];
 
 		r = 64 * ((i % 4) - 1.5f);
 		f = 64 * (i / 4.0f) + 128;
@@ -401,19 +445,236 @@ V_Gun_Model_f(void)
 	gun_model = R_RegisterModel(name);
 }
 
+/*
+ * Sorts lights by how much they matter to the view
+ */
 static int
-entitycmpfnc(const entity_t *a, const entity_t *b)
+V_DlightCompare(const void *a, const void *b)
 {
-	/* all other models are sorted by model then skin */
-	if (a->model == b->model)
+	const dlight_t *la = (const dlight_t *)a;
+	const dlight_t *lb = (const dlight_t *)b;
+	vec3_t d;
+	float sa, sb;
+
+	VectorSubtract(la->origin, cl.refdef.vieworg, d);
+	sa = la->intensity * la->intensity / (DotProduct(d, d) + 1);
+	VectorSubtract(lb->origin, cl.refdef.vieworg, d);
+	sb = lb->intensity * lb->intensity / (DotProduct(d, d) + 1);
+
+	if (sa > sb)
 	{
-		return (a->skin == b->skin) ? 0 :
-			(a->skin > b->skin) ? 1 : -1;
+		return -1;
 	}
-	else
+
+	return sa < sb;
+}
+
+/*
+ * Drops the lights of the scene that can't light anything
+ * visible: outside of the view frustum or only touching
+ * clusters not in the view's PVS. If more than the refresh
+ * can handle are left, the strongest and nearest are kept.
+ */
+static void
+V_CullDlights(float fov_x, float fov_y)
+{
+	vec3_t forward, right, up;
+	vec3_t planes[4];
+	float sx, cx, sy, cy;
+	const byte *pvs = NULL;
+	int i, j, num, max;
+
+	AngleVectors(cl.refdef.viewangles, forward, right, up);
+
+	/* inward normals of the four side planes */
+	sx = sinf(fov_x * (float)M_PI / 360.0f);
+	cx = cosf(fov_x * (float)M_PI / 360.0f);
+	sy = sinf(fov_y * (float)M_PI / 360.0f);
+	cy = cosf(fov_y * (float)M_PI / 360.0f);
+
+	for (j = 0; j < 3; j++)
+	{
+		planes[0][j] = forward[j] * sx - right[j] * cx;
+		planes[1][j] = forward[j] * sx + right[j] * cx;
+		planes[2][j] = forward[j] * sy - up[j] * cy;
+		planes[3][j] = forward[j] * sy + up[j] * cy;
+	}
+
+	if (!(cl.frame.playerstate.rdflags & RDF_NOWORLDMODEL))
 	{
-		return (a->model > b->model) ? 1 : -1;
+		int cluster = CM_LeafCluster(CM_PointLeafnum(cl.refdef.vieworg));
+
+		if (cluster >= 0)
+		{
+			pvs = CM_ClusterPVS(cluster);
+		}
 	}
+
+	for (i = 0, num = 0; i < r_scene.numdlights; i++)
+	{
+		const dlight_t *dl = &r_scene.dlights[i];
+		vec3_t delta;
+
+		VectorSubtract(dl->origin, cl.refdef.vieworg, delta);
+
+		for (j = 0; j < 4; j++)
+		{
+			if (DotProduct(delta, planes[j]) < -dl->intensity)
+			{
+				break;
+			}
+		}
+
+		if (j < 4)
+		{
+			continue;
+		}
+
+		if (pvs)
+		{
+			int leafs[64];
+			int count, cluster;
+			vec3_t mins, maxs;
+
+			for (j = 0; j < 3; j++)
+			{
+				mins[j] = dl->origin[j] - dl->intensity;
+				maxs[j] = dl->origin[j] + dl->intensity;
+			}
+
+			count = CM_BoxLeafnums(mins, maxs, leafs, 64, NULL);
+
+			/* a full list may miss leafs, keep the light then */
+			for (j = 0; j < count && count < 64; j++)
+			{
+				cluster = CM_LeafCluster(leafs[j]);
+
+				if ((cluster >= 0) && (pvs[cluster >> 3] & (1 << (cluster & 7))))
+				{
+					break;
+				}
+			}
+
+			if ((count < 64) && (j == count))
+			{
+				continue;
+			}
+		}
+
+		r_scene.dlights[num++] = *dl;
+	}
+
+	/* gl1 and soft keep the lights of a surface
+	   in a 32 bit mask, gl3 takes more */
+	max = (re.max_dlights > 0) ? re.max_dlights : MAX_DLIGHTS;
+
+	if (num > max)
+	{
+		qsort(r_scene.dlights, num, sizeof(dlight_t), V_DlightCompare);
+		num = max;
+	}
+
+	r_scene.numdlights = num;
+}
+
+/*
+ * Small per-frame ids for model and skin pointers,
+ * in order of first appearance.
+ */
+static unsigned
+V_EntityKeyId(const void **ids, int *numids, const void *ptr)
+{
+	int i;
+
+	for (i = 0; i < *numids; i++)
+	{
+		if (ids[i] == ptr)
+		{
+			return i;
+		}
+	}
+
+	ids[(*numids)++] = ptr;
+
+	return i;
+}
+
+/*
+ * Sorts the entities so that the refresh draws the ones sharing
+ * state back to back: opaque before translucent ones, then by
+ * shell, model, skin and skin number. Model and skin pointers are
+ * replaced by per-frame ids, that way the whole key fits into 32
+ * bits and is sorted with a four pass radix sort.
+ */
+static void
+V_SortEntities(entity_t *entities, int num)
+{
+	static entity_t sorted[MAX_ENTITIES];
+	const void *models[MAX_ENTITIES], *skins[MAX_ENTITIES];
+	unsigned keys[2][MAX_ENTITIES];
+	byte index[2][MAX_ENTITIES];
+	int nummodels = 0, numskins = 0;
+	int i, pass, cur;
+
+	/* entity indices and model and skin ids are 8 bits */
+	YQ2_STATIC_ASSERT(MAX_ENTITIES <= 256, "entity ids don't fit into a byte");
+
+	if (num < 2)
+	{
+		return;
+	}
+
+	for (i = 0; i < num; i++)
+	{
+		const entity_t *e = &entities[i];
+		unsigned shell;
+
+		shell = ((e->flags & (RF_SHELL_RED | RF_SHELL_GREEN | RF_SHELL_BLUE)) >> 10) |
+			((e->flags & (RF_SHELL_DOUBLE | RF_SHELL_HALF_DAM)) >> 13);
+
+		keys[0][i] = ((e->flags & RF_TRANSLUCENT) ? (1u << 31) : 0) |
+			(shell << 26) |
+			(V_EntityKeyId(models, &nummodels, e->model) << 18) |
+			(V_EntityKeyId(skins, &numskins, e->skin) << 10) |
+			(e->skinnum & 0x3ff);
+		index[0][i] = i;
+	}
+
+	/* least significant byte first, every pass is stable */
+	for (pass = 0, cur = 0; pass < 4; pass++, cur ^= 1)
+	{
+		int count[256] = {0};
+		int shift = pass * 8;
+		int sum = 0;
+
+		for (i = 0; i < num; i++)
+		{
+			count[(keys[cur][i] >> shift) & 255]++;
+		}
+
+		for (i = 0; i < 256; i++)
+		{
+			int c = count[i];
+
+			count[i] = sum;
+			sum += c;
+		}
+
+		for (i = 0; i < num; i++)
+		{
+			int dst = count[(keys[cur][i] >> shift) & 255]++;
+
+			keys[cur ^ 1][dst] = keys[cur][i];
+			index[cur ^ 1][dst] = index[cur][i];
+		}
+	}
+
+	for (i = 0; i < num; i++)
+	{
+		sorted[i] = entities[index[cur][i]];
+	}
+
+	memcpy(entities, sorted, num * sizeof(entity_t));
 }
 
 static void
@@ -550,17 +811,22 @@ V_RenderView(float stereo_separation)
 
 		if (!cl_add_entities->value)
 		{
-			r_numentities = 0;
+			r_scene.numentities = 0;
 		}
 
 		if (!cl_add_particles->value)
 		{
-			r_numparticles = 0;
+			r_scene.numparticles = 0;
 		}
 
 		if (!cl_add_lights->value)
 		{
-			r_numdlights = 0;
+			r_scene.numdlights = 0;
+		}
+		else
+		{
+			V_CullDlights(cl.refdef.fov_x, CalcFov(cl.refdef.fov_x,
+				(float)scr_vrect.width, (float)scr_vrect.height));
 		}
 
 		if (!cl_add_blend->value)
@@ -568,20 +834,18 @@ V_RenderView(float stereo_separation)
 			VectorClear(cl.refdef.blend);
 		}
 
-		cl.refdef.num_entities = r_numentities;
-		cl.refdef.entities = r_entities;
-		cl.refdef.num_particles = r_numparticles;
-		cl.refdef.particles = r_particles;
-		cl.refdef.num_dlights = r_numdlights;
-		cl.refdef.dlights = r_dlights;
-		cl.refdef.lightstyles = r_lightstyles;
+		cl.refdef.num_entities = r_scene.numentities;
+		cl.refdef.entities = r_scene.entities;
+		cl.refdef.num_particles = r_scene.numparticles;
+		cl.refdef.particles = r_scene.particles;
+		cl.refdef.num_dlights = r_scene.numdlights;
+		cl.refdef.dlights = r_scene.dlights;
+		cl.refdef.lightstyles = r_scene.lightstyles;
 
 		cl.refdef.rdflags = cl.frame.playerstate.rdflags;
 
-		/* sort entities for better cache locality */
-		qsort(cl.refdef.entities, cl.refdef.num_entities,
-				sizeof(cl.refdef.entities[0]), (int (*)(const void *, const void *))
-				entitycmpfnc);
+		/* sort entities for less state changes in the refresh */
+		V_SortEntities(cl.refdef.entities, cl.refdef.num_entities);
 	} else if (cl.frame.valid && cl_paused->value && gl1_stereo->value) {
 		// We need to adjust the refdef in stereo mode when paused.
 		vec3_t tmp;
@@ -607,14 +871,14 @@ V_RenderView(float stereo_separation)
 
 	if (cl_stats->value)
 	{
-		Com_Printf("ent:%i  lt:%i  part:%i\n", r_numentities,
-				r_numdlights, r_numparticles);
+		Com_Printf("ent:%i  lt:%i  part:%i\n", cl.refdef.num_entities,
+				cl.refdef.num_dlights, cl.refdef.num_particles);
 	}
 
 	if (log_stats->value && (log_stats_file != 0))
 	{
-		fprintf(log_stats_file, "%i,%i,%i,", r_numentities,
-				r_numdlights, r_numparticles);
+		fprintf(log_stats_file, "%i,%i,%i,", cl.refdef.num_entities,
+				cl.refdef.num_dlights, cl.refdef.num_particles);
 	}
 
 	SCR_AddDirtyPoint(scr_vrect.x, scr_vrect.y);
@@ -35,7 +35,7 @@
    it can be un-deltad from the original */
 #define	MAX_PARSE_ENTITIES	1024
 
-#define MAX_SUSTAINS		32
+#define MAX_SUSTAINS		64
 #define	PARTICLE_GRAVITY 40
 #define INSTANT_PARTICLE -10000.0
 
@@ -127,6 +127,13 @@ typedef struct
 	int			cmd_time[CMD_BACKUP]; /* time sent, for calculating pings */
 	short		predicted_origins[CMD_BACKUP][3]; /* for debug comparing against server */
 
+	/* pmove results of already predicted cmds, see CL_PredictMovement() */
+	pmove_state_t	predicted_states[CMD_BACKUP];
+	vec3_t		predicted_viewangles[CMD_BACKUP];
+	int			predicted_base; /* cmd the server state is at */
+	int			predicted_last; /* last cmd with a cached result */
+	int			predicted_serverframe;
+
 	float		predicted_step; /* for stair up smoothing */
 	unsigned	predicted_step_time;
 
@@ -283,6 +290,7 @@ extern	cvar_t	*cl_gun;
 extern	cvar_t	*cl_add_blend;
 extern	cvar_t	*cl_add_lights;
 extern	cvar_t	*cl_add_particles;
+extern	cvar_t	*cl_maxparticles;
 extern	cvar_t	*cl_add_entities;
 extern	cvar_t	*cl_predict;
 extern	cvar_t	*cl_footsteps;
@@ -331,9 +339,14 @@ typedef struct
 	float	die; /* stop lighting after this time */
 	float	decay; /* drop this each second */
 	float	minlight; /* don't add when contributing less */
+	int		hashnext; /* index + 1 of the next light in the key's hash chain */
 } cdlight_t;
 
-extern	cdlight_t	cl_dlights[MAX_DLIGHTS];
+/* the refresh gets the re.max_dlights most relevant
+   visible ones, see V_CullDlights() */
+#define	MAX_CL_DLIGHTS	128
+
+extern	cdlight_t	cl_dlights[MAX_CL_DLIGHTS];
 
 extern	centity_t	*cl_entities;
 extern	int			cl_numentities;
@@ -381,11 +394,9 @@ void CL_ParticleEffect2 (vec3_t org, vec3_t dir, int color, int count);
 void CL_ParticleEffect3 (vec3_t org, vec3_t dir, int color, int count);
 
 
+/* a new particle, as filled in by the effects */
 typedef struct particle_s
 {
-
-	struct particle_s	*next;
-
 	float		time;
 
 	vec3_t		org;
@@ -397,6 +408,7 @@ typedef struct particle_s
 	float		alphavel;
 } cparticle_t;
 
+cparticle_t *CL_AllocParticle (void);
 void CL_ClearEffects (void);
 void CL_ClearTEnts (void);
 void CL_ClearTEntModels (void);
@@ -511,7 +523,7 @@ extern	struct model_s	*gun_model;
 void V_Init (void);
 void V_RenderView( float stereo_separation );
 void V_AddEntity (entity_t *ent);
-void V_AddParticle (vec3_t org, unsigned int color, float alpha);
+particle_t *V_AllocParticles (int count);
 void V_AddLight (vec3_t org, float intensity, float r, float g, float b);
 void V_AddLightStyle (int style, float r, float g, float b);
 
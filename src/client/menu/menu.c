@@ -3737,6 +3737,9 @@ ExecDeleteSaveFunc(menuframework_s *m, int menu_key)
 			Com_sprintf(name, sizeof(name), "%s/save/save%d/", FS_Gamedir(),
 						item->localdata[0]);
 		}
+
+		/* the slot may still be written */
+		SV_FlushSaveFiles();
 		Sys_RemoveDir(name);
 		return true;
 	}
@@ -3750,6 +3753,9 @@ Create_Savestrings(void)
 	int i;
 	fileHandle_t f;
 
+	// Saves may still be written in the background.
+	SV_FlushSaveFiles();
+
 	// The quicksave slot...
 	FS_FOpenFile("save/quick/server.ssv", &f, true);
 
@@ -516,71 +516,79 @@ R_DrawParticles2(int num_particles, const particle_t particles[],
 	YQ2_VLAFREE(clr);
 }
 
-void
-R_DrawParticles(void)
+static void
+R_DrawParticlePoints(int num_particles, const particle_t particles[])
 {
-	qboolean stereo_split_tb = ((gl_state.stereo_mode == STEREO_SPLIT_VERTICAL) && gl_state.camera_separation);
-	qboolean stereo_split_lr = ((gl_state.stereo_mode == STEREO_SPLIT_HORIZONTAL) && gl_state.camera_separation);
+	int i;
+	YQ2_ALIGNAS_TYPE(unsigned) byte color[4];
+	const particle_t *p;
 
-	if (r_newrefdef.num_particles <= 0) /* avoiding VLA with no size and vertexes built on it */
-	{
-		return;
-	}
+	YQ2_VLA(GLfloat, vtx, 3 * num_particles);
+	YQ2_VLA(GLubyte, clr, 4 * num_particles);
 
-	if (gl_config.pointparameters && !(stereo_split_tb || stereo_split_lr))
-	{
-		int i;
-		YQ2_ALIGNAS_TYPE(unsigned) byte color[4];
-		const particle_t *p;
+	unsigned int index_vtx = 0;
+	unsigned int index_clr = 0;
 
-		YQ2_VLA(GLfloat, vtx, 3 * r_newrefdef.num_particles);
-		YQ2_VLA(GLubyte, clr, 4 * r_newrefdef.num_particles);
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glDisable(GL_TEXTURE_2D);
 
-		unsigned int index_vtx = 0;
-		unsigned int index_clr = 0;
+	// assume the particle size looks good with window height 480px and scale according to real resolution
+	glPointSize(gl1_particle_size->value * (float)r_newrefdef.height/480.0f);
 
-		glDepthMask(GL_FALSE);
-		glEnable(GL_BLEND);
-		glDisable(GL_TEXTURE_2D);
+	for ( i = 0, p = particles; i < num_particles; i++, p++ )
+	{
+		*(int *) color = d_8to24table [ p->color & 0xFF ];
+		clr[index_clr++] = gammatable[color[0]];
+		clr[index_clr++] = gammatable[color[1]];
+		clr[index_clr++] = gammatable[color[2]];
+		clr[index_clr++] = p->alpha * 255;
 
-		// assume the particle size looks good with window height 480px and scale according to real resolution
-		glPointSize(gl1_particle_size->value * (float)r_newrefdef.height/480.0f);
+		vtx[index_vtx++] = p->origin[0];
+		vtx[index_vtx++] = p->origin[1];
+		vtx[index_vtx++] = p->origin[2];
+	}
 
-		for ( i = 0, p = r_newrefdef.particles; i < r_newrefdef.num_particles; i++, p++ )
-		{
-			*(int *) color = d_8to24table [ p->color & 0xFF ];
-			clr[index_clr++] = gammatable[color[0]];
-			clr[index_clr++] = gammatable[color[1]];
-			clr[index_clr++] = gammatable[color[2]];
-			clr[index_clr++] = p->alpha * 255;
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_COLOR_ARRAY );
 
-			vtx[index_vtx++] = p->origin[0];
-			vtx[index_vtx++] = p->origin[1];
-			vtx[index_vtx++] = p->origin[2];
-		}
+	glVertexPointer( 3, GL_FLOAT, 0, vtx );
+	glColorPointer( 4, GL_UNSIGNED_BYTE, 0, clr );
+	glDrawArrays( GL_POINTS, 0, num_particles );
 
-		glEnableClientState( GL_VERTEX_ARRAY );
-		glEnableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	glDisableClientState( GL_COLOR_ARRAY );
 
-		glVertexPointer( 3, GL_FLOAT, 0, vtx );
-		glColorPointer( 4, GL_UNSIGNED_BYTE, 0, clr );
-		glDrawArrays( GL_POINTS, 0, r_newrefdef.num_particles );
+	glDisable(GL_BLEND);
+	glColor4f( 1, 1, 1, 1 );
+	glDepthMask(GL_TRUE);
+	glEnable(GL_TEXTURE_2D);
 
-		glDisableClientState( GL_VERTEX_ARRAY );
-		glDisableClientState( GL_COLOR_ARRAY );
+	YQ2_VLAFREE(vtx);
+	YQ2_VLAFREE(clr);
+}
 
-		glDisable(GL_BLEND);
-		glColor4f( 1, 1, 1, 1 );
-		glDepthMask(GL_TRUE);
-		glEnable(GL_TEXTURE_2D);
+void
+R_DrawParticles(void)
+{
+	qboolean stereo_split_tb = ((gl_state.stereo_mode == STEREO_SPLIT_VERTICAL) && gl_state.camera_separation);
+	qboolean stereo_split_lr = ((gl_state.stereo_mode == STEREO_SPLIT_HORIZONTAL) && gl_state.camera_separation);
+	int first, num;
 
-		YQ2_VLAFREE(vtx);
-		YQ2_VLAFREE(clr);
-	}
-	else
+	/* the client may send a lot of particles, so they're drawn in
+	   batches of MAX_PARTICLES to keep the VLAs on the stack small */
+	for (first = 0; first < r_newrefdef.num_particles; first += num)
 	{
-		R_DrawParticles2(r_newrefdef.num_particles,
-				r_newrefdef.particles, d_8to24table);
+		num = Q_min(r_newrefdef.num_particles - first, MAX_PARTICLES);
+
+		if (gl_config.pointparameters && !(stereo_split_tb || stereo_split_lr))
+		{
+			R_DrawParticlePoints(num, r_newrefdef.particles + first);
+		}
+		else
+		{
+			R_DrawParticles2(num, r_newrefdef.particles + first, d_8to24table);
+		}
 	}
 }
 
@@ -2127,6 +2135,7 @@ GetRefAPI(refimport_t imp)
 
 	re.api_version = API_VERSION;
 	re.framework_version = RI_GetSDLVersion();
+	re.max_dlights = MAX_DLIGHTS;
 
 	re.Init = RI_Init;
 	re.Shutdown = RI_Shutdown;
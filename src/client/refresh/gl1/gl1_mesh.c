@@ -39,12 +39,90 @@ float r_avertexnormal_dots[SHADEDOT_QUANT][256] = {
 };
 
 typedef float vec4_t[4];
-static vec4_t s_lerped[MAX_VERTS];
+static vec4_t *s_lerped;
 vec3_t shadevector;
 float shadelight[3];
 float *shadedots = r_avertexnormal_dots[0];
 extern vec3_t lightspot;
 
+/*
+ * GL1 can't interpolate the frames on the GPU, so the interpolated
+ * vertices are cached instead. Entities that don't animate (corpses,
+ * items, idle monsters) and entities of the same model that share an
+ * animation frame hit the cache and skip R_LerpVerts() completely.
+ */
+#define LERPCACHE_SIZE 16
+
+typedef struct
+{
+	const dmdl_t *hdr;
+	int frame, oldframe;
+	qboolean shell;
+	vec3_t move, frontv, backv;
+	int lastused;
+	vec4_t verts[MAX_VERTS];
+} lerpcache_t;
+
+static lerpcache_t s_lerpcache[LERPCACHE_SIZE];
+static int s_lerpcache_time;
+
+void
+R_ResetLerpCache(void)
+{
+	int i;
+
+	for (i = 0; i < LERPCACHE_SIZE; i++)
+	{
+		s_lerpcache[i].hdr = NULL;
+		s_lerpcache[i].lastused = 0;
+	}
+}
+
+/*
+ * Returns the cache entry for the given interpolation or NULL if
+ * it isn't cached. The least recently used entry is returned in
+ * *replace and should be used to cache the new result.
+ */
+static lerpcache_t *
+R_FindLerpCache(const dmdl_t *hdr, int frame, int oldframe, qboolean shell,
+		const vec3_t move, const vec3_t frontv, const vec3_t backv,
+		lerpcache_t **replace)
+{
+	lerpcache_t *c, *oldest = s_lerpcache;
+	int i;
+
+	s_lerpcache_time++;
+
+	for (i = 0, c = s_lerpcache; i < LERPCACHE_SIZE; i++, c++)
+	{
+		if ((c->hdr == hdr) && (c->frame == frame) &&
+			(c->oldframe == oldframe) && (c->shell == shell) &&
+			VectorCompare(c->move, move) && VectorCompare(c->frontv, frontv) &&
+			VectorCompare(c->backv, backv))
+		{
+			c->lastused = s_lerpcache_time;
+			return c;
+		}
+
+		if (c->lastused < oldest->lastused)
+		{
+			oldest = c;
+		}
+	}
+
+	oldest->hdr = hdr;
+	oldest->frame = frame;
+	oldest->oldframe = oldframe;
+	oldest->shell = shell;
+	VectorCopy(move, oldest->move);
+	VectorCopy(frontv, oldest->frontv);
+	VectorCopy(backv, oldest->backv);
+	oldest->lastused = s_lerpcache_time;
+
+	*replace = oldest;
+	return NULL;
+}
+
 static void
 R_LerpVerts(entity_t *currententity, int nverts, dtrivertx_t *v, dtrivertx_t *ov,
 		dtrivertx_t *verts, float *lerp, float move[3],
@@ -93,7 +171,8 @@ R_DrawAliasFrameLerp(entity_t *currententity, dmdl_t *paliashdr, float backlerp)
 	float tex[2], frontlerp, l, alpha;
 	vec3_t move, delta, vectors[3];
 	vec3_t frontv, backv;
-	float *lerp;
+	lerpcache_t *cached, *replace = NULL;
+	qboolean shell;
 
 	frame = (daliasframe_t *)((byte *)paliashdr + paliashdr->ofs_frames
 							  + currententity->frame * paliashdr->framesize);
@@ -137,9 +216,25 @@ R_DrawAliasFrameLerp(entity_t *currententity, dmdl_t *paliashdr, float backlerp)
 		backv[i] = backlerp * oldframe->scale[i];
 	}
 
-	lerp = s_lerped[0];
+	shell = (currententity->flags &
+		(RF_SHELL_RED | RF_SHELL_GREEN |
+		 RF_SHELL_BLUE | RF_SHELL_DOUBLE |
+		 RF_SHELL_HALF_DAM)) != 0;
+
+	cached = R_FindLerpCache(paliashdr, currententity->frame,
+			currententity->oldframe, shell, move, frontv, backv, &replace);
+
+	if (cached)
+	{
+		s_lerped = cached->verts;
+	}
+	else
+	{
+		s_lerped = replace->verts;
 
-	R_LerpVerts(currententity, paliashdr->num_xyz, v, ov, verts, lerp, move, frontv, backv);
+		R_LerpVerts(currententity, paliashdr->num_xyz, v, ov, verts,
+				s_lerped[0], move, frontv, backv);
+	}
 
 	while (1)
 	{
@@ -721,6 +721,9 @@ Mod_LoadBrushModel(model_t *mod, void *buffer, int modfilelen)
 void
 Mod_Free(model_t *mod)
 {
+	/* the lerp cache is keyed by the model data */
+	R_ResetLerpCache();
+
 	Hunk_Free(mod->extradata);
 	memset(mod, 0, sizeof(*mod));
 }
@@ -267,6 +267,7 @@ extern int registration_sequence;
 
 void R_ScreenShot(void);
 void R_DrawAliasModel(entity_t *currententity, const model_t *currentmodel);
+void R_ResetLerpCache(void);
 void R_DrawBrushModel(entity_t *currententity, const model_t *currentmodel);
 void R_DrawSpriteModel(entity_t *currententity, const model_t *currentmodel);
 void R_DrawBeam(entity_t *e);
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ * Copyright (C) 2016-2017 Daniel Gibson
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * Ring buffers for streaming vertex and index data to the GPU.
+ *
+ * With GL_ARB_buffer_storage the whole buffer is mapped once (persistent
+ * and coherent) and data is just memcpy()d into it. The buffer is split
+ * into GL3_STREAM_SEGMENTS segments, whenever writing leaves a segment a
+ * fence is inserted and before a segment is written to again we make
+ * sure the GPU is done with it (which it usually is, because there are
+ * several segments in between).
+ *
+ * Without that extension (GLES3, old drivers) the buffer is orphaned with
+ * glBufferData(NULL) whenever it wraps around and the data is written with
+ * unsynchronized glMapBufferRange(), which is safe because nothing in the
+ * current buffer storage is ever overwritten.
+ *
+ * All buffer management happens on GL_COPY_WRITE_BUFFER, so the
+ * GL_ELEMENT_ARRAY_BUFFER binding of whatever VAO is currently bound
+ * isn't touched. The caller of GL3_StreamData() must have the right VAO
+ * bound, as the buffer is bound to its target at the end.
+ *
+ * =======================================================================
+ */
+
+#include "header/local.h"
+
+int gl3_numStreamedBytes = 0, gl3_numStreamStalls = 0;
+
+static void
+AllocStreamStorage(gl3streambuf_t *sb)
+{
+	int i;
+
+	glGenBuffers(1, &sb->buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, sb->buffer);
+
+	sb->mapped = NULL;
+	sb->offset = 0;
+	sb->segment = 0;
+
+	for (i = 0; i < GL3_STREAM_SEGMENTS; i++)
+	{
+		sb->fences[i] = NULL;
+	}
+
+#ifndef YQ2_GL3_GLES
+	if (gl3config.buffer_storage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glBufferStorage(GL_COPY_WRITE_BUFFER, sb->size, NULL, flags);
+		sb->mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, sb->size, flags);
+
+		if (sb->mapped != NULL)
+		{
+			return;
+		}
+
+		// buffer storage is immutable, so get a fresh one for the fallback
+		R_Printf(PRINT_ALL, "%s: Mapping stream buffer failed, using glBufferData() instead\n", __func__);
+		glDeleteBuffers(1, &sb->buffer);
+		glGenBuffers(1, &sb->buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, sb->buffer);
+	}
+#endif
+
+	glBufferData(GL_COPY_WRITE_BUFFER, sb->size, NULL, GL_STREAM_DRAW);
+}
+
+static void
+FreeStreamStorage(gl3streambuf_t *sb)
+{
+	int i;
+
+	for (i = 0; i < GL3_STREAM_SEGMENTS; i++)
+	{
+		if (sb->fences[i] != NULL)
+		{
+			glDeleteSync(sb->fences[i]);
+			sb->fences[i] = NULL;
+		}
+	}
+
+	if (sb->buffer == 0)
+	{
+		return;
+	}
+
+	if (sb->mapped != NULL)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, sb->buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		sb->mapped = NULL;
+	}
+
+	// deleting a bound buffer unbinds it, so the binding cache must forget it
+	if (sb->target == GL_ARRAY_BUFFER && gl3state.currentVBO == sb->buffer)
+	{
+		gl3state.currentVBO = 0;
+	}
+	else if (sb->target == GL_ELEMENT_ARRAY_BUFFER && gl3state.currentEBO == sb->buffer)
+	{
+		gl3state.currentEBO = 0;
+	}
+
+	glDeleteBuffers(1, &sb->buffer);
+	sb->buffer = 0;
+}
+
+void
+GL3_InitStreamBuffer(gl3streambuf_t *sb, GLenum target, GLsizeiptr size)
+{
+	memset(sb, 0, sizeof(*sb));
+
+	sb->target = target;
+	sb->size = size;
+
+	AllocStreamStorage(sb);
+}
+
+void
+GL3_ShutdownStreamBuffer(gl3streambuf_t *sb)
+{
+	FreeStreamStorage(sb);
+	sb->size = 0;
+}
+
+/*
+ * Fences the current segment and moves on to the next one,
+ * waiting for the GPU to be done with it if necessary.
+ */
+static void
+NextSegment(gl3streambuf_t *sb)
+{
+	GLsync fence;
+
+	sb->fences[sb->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	sb->segment = (sb->segment + 1) % GL3_STREAM_SEGMENTS;
+
+	fence = sb->fences[sb->segment];
+
+	if (fence == NULL)
+	{
+		return;
+	}
+
+	if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+	{
+		++gl3_numStreamStalls;
+
+		// one second at most, if it takes longer something is broken anyway
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+	}
+
+	glDeleteSync(fence);
+	sb->fences[sb->segment] = NULL;
+}
+
+/*
+ * Copies size bytes from data into the stream buffer, binds it to its
+ * target and returns the offset in the buffer the data starts at
+ * (to be used for glVertexAttribPointer() or glDrawElements()).
+ */
+GLintptr
+GL3_StreamData(gl3streambuf_t *sb, const void *data, GLsizeiptr size)
+{
+	GLsizeiptr segSize = sb->size / GL3_STREAM_SEGMENTS;
+	GLintptr start;
+
+	if (size > segSize)
+	{
+		// doesn't fit into a segment - make the buffer big enough for it.
+		// the old buffer is kept alive by the driver until the GPU is done with it
+		while (sb->size / GL3_STREAM_SEGMENTS < size)
+		{
+			sb->size *= 2;
+		}
+
+		R_Printf(PRINT_DEVELOPER, "%s: Growing stream buffer to %d KB\n",
+				__func__, (int)(sb->size / 1024));
+
+		FreeStreamStorage(sb);
+		AllocStreamStorage(sb);
+		segSize = sb->size / GL3_STREAM_SEGMENTS;
+	}
+
+	start = (sb->offset + GL3_STREAM_ALIGN - 1) & ~(GLintptr)(GL3_STREAM_ALIGN - 1);
+
+	if (start + size > sb->size)
+	{
+		start = 0;
+
+		if (sb->mapped == NULL)
+		{
+			// orphan the old storage, the driver hands us a fresh one
+			glBindBuffer(GL_COPY_WRITE_BUFFER, sb->buffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, sb->size, NULL, GL_STREAM_DRAW);
+		}
+	}
+
+	if (sb->mapped != NULL)
+	{
+		int lastSegment = (start + size - 1) / segSize;
+
+		// for a wraparound this walks through the remaining segments,
+		// which is fine, they're fenced and waited for all the same
+		while (sb->segment != lastSegment)
+		{
+			NextSegment(sb);
+		}
+
+		memcpy(sb->mapped + start, data, size);
+	}
+	else
+	{
+		void *dst;
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, sb->buffer);
+		dst = glMapBufferRange(GL_COPY_WRITE_BUFFER, start, size,
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+		if (dst != NULL)
+		{
+			memcpy(dst, data, size);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+		else
+		{
+			glBufferSubData(GL_COPY_WRITE_BUFFER, start, size, data);
+		}
+	}
+
+	sb->offset = start + size;
+	gl3_numStreamedBytes += size;
+
+	if (sb->target == GL_ELEMENT_ARRAY_BUFFER)
+	{
+		GL3_BindEBO(sb->buffer);
+	}
+	else
+	{
+		GL3_BindVBO(sb->buffer);
+	}
+
+	return start;
+}
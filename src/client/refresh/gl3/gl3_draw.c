@@ -33,7 +33,8 @@ unsigned d_8to24table[256];
 
 gl3image_t *draw_chars;
 
-static GLuint vbo2D = 0, ebo2D = 0, vao2D = 0, vao2Dcolor = 0; // vao2D is for textured rendering, vao2Dcolor for color-only
+static GLuint vao2D = 0, vao2Dcolor = 0; // vao2D is for textured rendering, vao2Dcolor for color-only
+static gl3streambuf_t vbo2D, ebo2D; // both VAOs share the same VBO
 
 int gl3_num3Ddraws = 0, gl3_num2Ddraws = 0, gl3_numBufferVtxData = 0, gl3_numBufferUniforms = 0;
 
@@ -48,6 +49,22 @@ static Vtx2DArray_t vtxBuf = {0};
 static UShortArray_t idxBuf = {0};
 static GLuint lastBatchTexture = 0;
 
+// Note: the glVertexAttribPointer() configuration is stored in the VAO, not the shader or sth
+//       (that's why I use one VAO per 2D shader). It must be set again whenever the data
+//       was streamed to a different offset of the VBO (which is basically always).
+static void
+VertexAttribs2D(GLintptr base)
+{
+	qglVertexAttribPointer(GL3_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), base);
+	qglVertexAttribPointer(GL3_ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), base + 2*sizeof(float));
+}
+
+static void
+VertexAttribs2Dcolor(GLintptr base)
+{
+	qglVertexAttribPointer(GL3_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), base);
+}
+
 void
 GL3_Draw_InitLocal(void)
 {
@@ -61,33 +78,29 @@ GL3_Draw_InitLocal(void)
 
 	// set up attribute layout for 2D textured rendering
 	glGenVertexArrays(1, &vao2D);
-	glBindVertexArray(vao2D);
+	GL3_BindVAO(vao2D);
 
-	glGenBuffers(1, &vbo2D);
-	GL3_BindVBO(vbo2D);
-	glGenBuffers(1, &ebo2D);
+	GL3_InitStreamBuffer(&vbo2D, GL_ARRAY_BUFFER, 1024*1024);
+	GL3_BindVBO(vbo2D.buffer);
+	GL3_InitStreamBuffer(&ebo2D, GL_ELEMENT_ARRAY_BUFFER, 256*1024);
 
 	GL3_UseProgram(gl3state.si2D.shaderProgram);
 
 	glEnableVertexAttribArray(GL3_ATTRIB_POSITION);
-	// Note: the glVertexAttribPointer() configuration is stored in the VAO, not the shader or sth
-	//       (that's why I use one VAO per 2D shader)
-	qglVertexAttribPointer(GL3_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), 0);
-
 	glEnableVertexAttribArray(GL3_ATTRIB_TEXCOORD);
-	qglVertexAttribPointer(GL3_ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), 2*sizeof(float));
+	VertexAttribs2D(0);
 
 	// set up attribute layout for 2D flat color rendering
 
 	glGenVertexArrays(1, &vao2Dcolor);
-	glBindVertexArray(vao2Dcolor);
+	GL3_BindVAO(vao2Dcolor);
 
-	GL3_BindVBO(vbo2D); // yes, both VAOs share the same VBO
+	GL3_BindVBO(vbo2D.buffer); // yes, both VAOs share the same VBO
 
 	GL3_UseProgram(gl3state.si2Dcolor.shaderProgram);
 
 	glEnableVertexAttribArray(GL3_ATTRIB_POSITION);
-	qglVertexAttribPointer(GL3_ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), 0);
+	VertexAttribs2Dcolor(0);
 
 	GL3_BindVAO(0);
 }
@@ -95,10 +108,8 @@ GL3_Draw_InitLocal(void)
 void
 GL3_Draw_ShutdownLocal(void)
 {
-	glDeleteBuffers(1, &ebo2D);
-	ebo2D = 0;
-	glDeleteBuffers(1, &vbo2D);
-	vbo2D = 0;
+	GL3_ShutdownStreamBuffer(&ebo2D);
+	GL3_ShutdownStreamBuffer(&vbo2D);
 	glDeleteVertexArrays(1, &vao2D);
 	vao2D = 0;
 	glDeleteVertexArrays(1, &vao2Dcolor);
@@ -123,14 +134,9 @@ GL3_DrawCurrent2Dbatch()
 
 	GL3_BindVAO(vao2D);
 
-	// Note: while vao2D "remembers" its vbo for drawing, binding the vao does *not*
-	//       implicitly bind the vbo, so I need to explicitly bind it before glBufferData()
-	GL3_BindVBO(vbo2D);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(gl3_drawVert2D)*numVtx, vtxBuf.p, GL_STREAM_DRAW);
-
-	GL3_BindEBO(ebo2D);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, da_count(idxBuf)*sizeof(GLushort), idxBuf.p, GL_STREAM_DRAW);
-	glDrawElements(GL_TRIANGLES, da_count(idxBuf), GL_UNSIGNED_SHORT, NULL);
+	VertexAttribs2D(GL3_StreamData(&vbo2D, vtxBuf.p, sizeof(gl3_drawVert2D)*numVtx));
+	GLintptr idxOffset = GL3_StreamData(&ebo2D, idxBuf.p, da_count(idxBuf)*sizeof(GLushort));
+	glDrawElements(GL_TRIANGLES, da_count(idxBuf), GL_UNSIGNED_SHORT, (void*)idxOffset);
 
 	++gl3_numBufferVtxData;
 	++gl3_num2Ddraws;
@@ -209,10 +215,7 @@ drawTexturedRectangleNow(float x, float y, float w, float h,
 
 	GL3_BindVAO(vao2D);
 
-	// Note: while vao2D "remembers" its vbo for drawing, binding the vao does *not*
-	//       implicitly bind the vbo, so I need to explicitly bind it before glBufferData()
-	GL3_BindVBO(vbo2D);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vBuf), vBuf, GL_STREAM_DRAW);
+	VertexAttribs2D(GL3_StreamData(&vbo2D, vBuf, sizeof(vBuf)));
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 	++gl3_numBufferVtxData;
 	++gl3_num2Ddraws;
@@ -431,8 +434,7 @@ GL3_Draw_Fill(int x, int y, int w, int h, int c)
 	GL3_UseProgram(gl3state.si2Dcolor.shaderProgram);
 	GL3_BindVAO(vao2Dcolor);
 
-	GL3_BindVBO(vbo2D);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vBuf), vBuf, GL_STREAM_DRAW);
+	VertexAttribs2Dcolor(GL3_StreamData(&vbo2D, vBuf, sizeof(vBuf)));
 
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
@@ -474,8 +476,7 @@ GL3_Draw_Flash(const float color[4], float x, float y, float w, float h)
 
 	GL3_BindVAO(vao2Dcolor);
 
-	GL3_BindVBO(vbo2D);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vBuf), vBuf, GL_STREAM_DRAW);
+	VertexAttribs2Dcolor(GL3_StreamData(&vbo2D, vBuf, sizeof(vBuf)));
 
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
@@ -571,17 +572,21 @@ void GL3_EndFrame(void)
 	int num2D = gl3_num2Ddraws;
 	int numBufVtx = gl3_numBufferVtxData;
 	int numBufUni = gl3_numBufferUniforms;
+	int numStreamed = gl3_numStreamedBytes;
+	int numStalls = gl3_numStreamStalls;
 	gl3_num3Ddraws = 0;
 	gl3_num2Ddraws = 0;
 	gl3_numBufferVtxData = 0;
 	gl3_numBufferUniforms = 0;
+	gl3_numStreamedBytes = 0;
+	gl3_numStreamStalls = 0;
 
 	if(gl3_show_draw_stats->value)
 	{
 		float factor = 2.0f; // TODO: like SCR_GetConsoleScale()
-		char stbuf[128] = {0};
-		snprintf(stbuf, sizeof(stbuf), "3D drawcalls: %d - 2D drawcalls: %d - buffer vtx data: %d - buffer uniforms: %d",
-		         num3D, num2D, numBufVtx, numBufUni);
+		char stbuf[192] = {0};
+		snprintf(stbuf, sizeof(stbuf), "3D drawcalls: %d - 2D drawcalls: %d - buffer vtx data: %d - buffer uniforms: %d - streamed: %d KB - stalls: %d",
+		         num3D, num2D, numBufVtx, numBufUni, numStreamed / 1024, numStalls);
 
 		GL3_DrawStringScaled(10, 5, stbuf, factor);
 		GL3_DrawCurrent2Dbatch();
@@ -77,33 +77,300 @@ GL3_MarkSurfaceLights(dlight_t *light, int bit, mnode_t *node, int r_dlightframe
 void
 GL3_PushDlights(void)
 {
-	int i;
+	int i, numDlights;
 	dlight_t *l;
 
 	/* because the count hasn't advanced yet for this frame */
 	r_dlightframecount = gl3_framecount + 1;
 
+	gl3state.clusteredLights = (gl3_clusteredlights->value != 0.0f) && (gl3state.clusterGridTex != 0);
+
 	l = r_newrefdef.dlights;
+	numDlights = r_newrefdef.num_dlights;
+
+	if (!gl3state.clusteredLights && numDlights > 32)
+	{
+		/* lightFlags is a 32bit mask */
+		numDlights = 32;
+	}
+	else if (numDlights > GL3_MAX_DLIGHTS)
+	{
+		numDlights = GL3_MAX_DLIGHTS;
+	}
 
-	gl3state.uniLightsData.numDynLights = r_newrefdef.num_dlights;
+	gl3state.uniLightsData.numDynLights = numDlights;
 
-	for (i = 0; i < r_newrefdef.num_dlights; i++, l++)
+	for (i = 0; i < numDlights; i++, l++)
 	{
 		gl3UniDynLight* udl = &gl3state.uniLightsData.dynLights[i];
-		R_MarkLights(l, 1 << i, gl3_worldmodel->nodes, r_dlightframecount, GL3_MarkSurfaceLights);
+
+		/* with clustered lights the shader finds the lights itself */
+		if (!gl3state.clusteredLights)
+		{
+			R_MarkLights(l, 1 << i, gl3_worldmodel->nodes, r_dlightframecount, GL3_MarkSurfaceLights);
+		}
 
 		VectorCopy(l->origin, udl->origin);
 		VectorCopy(l->color, udl->color);
 		udl->intensity = l->intensity;
 	}
 
-	assert(MAX_DLIGHTS == 32 && "If MAX_DLIGHTS changes, remember to adjust the uniform buffer definition in the shader!");
+	/* the shaders never read beyond numDynLights, so the rest isn't cleared.
+	   the UBO is uploaded in GL3_BuildLightClusters(), once the view is set up */
+}
+
+/*
+ * Clustered forward lighting (gl3_clusteredlights): the view frustum is
+ * split into GL3_CLUSTER_X * GL3_CLUSTER_Y screen tiles and GL3_CLUSTER_Z
+ * exponentially distributed depth slices ("froxels"). Each frame every
+ * dynamic light is assigned to the clusters its sphere of influence
+ * overlaps, and the shaders only evaluate the lights listed for the
+ * cluster a fragment is in, instead of all lights marked for the surface.
+ * The per-surface GL3_MarkSurfaceLights() recursion is skipped entirely.
+ */
+
+typedef struct
+{
+	byte mins[3];
+	byte maxs[3]; /* inclusive */
+} gl3lightcluster_t;
+
+static GLuint clusterGrid[GL3_NUM_CLUSTERS][2]; /* offset into clusterIndices, number of lights */
+static unsigned short clusterIndices[GL3_MAX_CLUSTER_INDICES];
+static gl3lightcluster_t lightClusters[GL3_MAX_DLIGHTS];
+
+void
+GL3_InitLightClusters(void)
+{
+	glGenTextures(1, &gl3state.clusterGridTex);
+	glGenTextures(1, &gl3state.clusterIndexTex);
+
+	GL3_SelectTMU(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_2D, gl3state.clusterGridTex);
+	/* integer textures must not be filtered */
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, GL3_CLUSTER_X, GL3_CLUSTER_Y * GL3_CLUSTER_Z,
+			0, GL_RG_INTEGER, GL_UNSIGNED_INT, NULL);
+
+	GL3_SelectTMU(GL_TEXTURE6);
+	glBindTexture(GL_TEXTURE_2D, gl3state.clusterIndexTex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, GL3_CLUSTER_INDEX_WIDTH, GL3_CLUSTER_INDEX_HEIGHT,
+			0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, NULL);
+
+	GL3_SelectTMU(GL_TEXTURE0);
+}
+
+void
+GL3_ShutdownLightClusters(void)
+{
+	if (gl3state.clusterGridTex != 0)
+	{
+		glDeleteTextures(1, &gl3state.clusterGridTex);
+	}
 
-	if(i < MAX_DLIGHTS)
+	if (gl3state.clusterIndexTex != 0)
 	{
-		memset(&gl3state.uniLightsData.dynLights[i], 0, (MAX_DLIGHTS-i)*sizeof(gl3state.uniLightsData.dynLights[0]));
+		glDeleteTextures(1, &gl3state.clusterIndexTex);
 	}
 
+	gl3state.clusterGridTex = gl3state.clusterIndexTex = 0;
+	gl3state.clusteredLights = false;
+}
+
+static int
+ClusterSlice(float depth, float zNear, float zScale)
+{
+	int slice = (int)(logf(depth / zNear) * zScale);
+
+	return Q_max(0, Q_min(slice, GL3_CLUSTER_Z - 1));
+}
+
+static int
+ClusterTile(float ndc, int numTiles)
+{
+	int tile = (int)((0.5f * ndc + 0.5f) * numTiles);
+
+	return Q_max(0, Q_min(tile, numTiles - 1));
+}
+
+/*
+ * Finds the clusters touched by the light's sphere of influence,
+ * returns false if it's outside of the view frustum.
+ */
+static qboolean
+LightClusterBounds(const gl3UniDynLight *light, float zNear, float zFar,
+		float zScale, gl3lightcluster_t *out)
+{
+	const hmm_mat4 *view = &gl3state.viewMat3D;
+	const hmm_mat4 *proj = &gl3state.projMat3D;
+	float eye[3], depth, minDepth, maxDepth, radius;
+	float ndcMins[2], ndcMaxs[2];
+	int i;
+
+	/* GL3_LightPoint() and the surface shaders use the intensity as radius */
+	radius = light->intensity;
+
+	for (i = 0; i < 3; i++)
+	{
+		eye[i] = view->Elements[0][i] * light->origin[0] + view->Elements[1][i] * light->origin[1]
+		       + view->Elements[2][i] * light->origin[2] + view->Elements[3][i];
+	}
+
+	/* the camera looks down the negative Z axis */
+	depth = -eye[2];
+
+	if ((depth + radius < zNear) || (depth - radius > zFar))
+	{
+		return false;
+	}
+
+	minDepth = Q_max(depth - radius, zNear);
+	maxDepth = Q_min(depth + radius, zFar);
+
+	/* project the light's bounding box, conservatively for the whole depth range */
+	for (i = 0; i < 2; i++)
+	{
+		float lo = eye[i] - radius;
+		float hi = eye[i] + radius;
+		float scale = proj->Elements[i][i];
+
+		ndcMins[i] = scale * Q_min(lo / minDepth, lo / maxDepth);
+		ndcMaxs[i] = scale * Q_max(hi / minDepth, hi / maxDepth);
+
+		if ((ndcMaxs[i] < -1.0f) || (ndcMins[i] > 1.0f))
+		{
+			return false;
+		}
+	}
+
+	out->mins[0] = ClusterTile(ndcMins[0], GL3_CLUSTER_X);
+	out->maxs[0] = ClusterTile(ndcMaxs[0], GL3_CLUSTER_X);
+	out->mins[1] = ClusterTile(ndcMins[1], GL3_CLUSTER_Y);
+	out->maxs[1] = ClusterTile(ndcMaxs[1], GL3_CLUSTER_Y);
+	out->mins[2] = ClusterSlice(minDepth, zNear, zScale);
+	out->maxs[2] = ClusterSlice(maxDepth, zNear, zScale);
+
+	return true;
+}
+
+static int
+LightClusterVolume(const gl3lightcluster_t *lc)
+{
+	return (lc->maxs[0] - lc->mins[0] + 1) * (lc->maxs[1] - lc->mins[1] + 1)
+	     * (lc->maxs[2] - lc->mins[2] + 1);
+}
+
+void
+GL3_BuildLightClusters(void)
+{
+	gl3UniLights_t *uni = &gl3state.uniLightsData;
+	int i, x, y, z, numIndices, numLights;
+	float zNear, zFar, zScale;
+
+	if (!gl3state.clusteredLights)
+	{
+		uni->clusterDims[0] = uni->clusterDims[1] = uni->clusterDims[2] = 0;
+		GL3_UpdateUBOLights();
+
+		return;
+	}
+
+	/* get near and far plane back from the glFrustum()-style projection matrix */
+	zNear = gl3state.projMat3D.Elements[3][2] / (gl3state.projMat3D.Elements[2][2] - 1.0f);
+	zFar = gl3state.projMat3D.Elements[3][2] / (gl3state.projMat3D.Elements[2][2] + 1.0f);
+	zScale = GL3_CLUSTER_Z / logf(zFar / zNear);
+
+	uni->clusterDims[0] = GL3_CLUSTER_X;
+	uni->clusterDims[1] = GL3_CLUSTER_Y;
+	uni->clusterDims[2] = GL3_CLUSTER_Z;
+	uni->clusterProjView = HMM_MultiplyMat4(gl3state.projMat3D, gl3state.viewMat3D);
+	uni->clusterZNear = zNear;
+	uni->clusterZScale = zScale;
+	uni->clusterIndexWidth = GL3_CLUSTER_INDEX_WIDTH;
+	uni->modulate = r_modulate->value;
+
+	memset(clusterGrid, 0, sizeof(clusterGrid));
+
+	/* first count the lights per cluster.. */
+	numIndices = 0;
+	numLights = uni->numDynLights;
+
+	for (i = 0; i < numLights; i++)
+	{
+		gl3lightcluster_t *lc = &lightClusters[i];
+
+		if (!LightClusterBounds(&uni->dynLights[i], zNear, zFar, zScale, lc) ||
+			(numIndices + LightClusterVolume(lc) > GL3_MAX_CLUSTER_INDICES))
+		{
+			/* empty range, so it's skipped below */
+			lc->mins[0] = 1;
+			lc->maxs[0] = 0;
+			continue;
+		}
+
+		numIndices += LightClusterVolume(lc);
+
+		for (z = lc->mins[2]; z <= lc->maxs[2]; z++)
+		{
+			for (y = lc->mins[1]; y <= lc->maxs[1]; y++)
+			{
+				for (x = lc->mins[0]; x <= lc->maxs[0]; x++)
+				{
+					clusterGrid[(z * GL3_CLUSTER_Y + y) * GL3_CLUSTER_X + x][1]++;
+				}
+			}
+		}
+	}
+
+	/* .. then turn the counts into offsets.. */
+	numIndices = 0;
+
+	for (i = 0; i < GL3_NUM_CLUSTERS; i++)
+	{
+		clusterGrid[i][0] = numIndices;
+		numIndices += clusterGrid[i][1];
+		clusterGrid[i][1] = 0;
+	}
+
+	/* .. and fill in the light indices, in light order */
+	for (i = 0; i < numLights; i++)
+	{
+		const gl3lightcluster_t *lc = &lightClusters[i];
+
+		for (z = lc->mins[2]; z <= lc->maxs[2]; z++)
+		{
+			for (y = lc->mins[1]; y <= lc->maxs[1]; y++)
+			{
+				for (x = lc->mins[0]; x <= lc->maxs[0]; x++)
+				{
+					GLuint *cluster = clusterGrid[(z * GL3_CLUSTER_Y + y) * GL3_CLUSTER_X + x];
+					clusterIndices[cluster[0] + cluster[1]] = i;
+					cluster[1]++;
+				}
+			}
+		}
+	}
+
+	GL3_SelectTMU(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_2D, gl3state.clusterGridTex);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GL3_CLUSTER_X, GL3_CLUSTER_Y * GL3_CLUSTER_Z,
+			GL_RG_INTEGER, GL_UNSIGNED_INT, clusterGrid);
+
+	if (numIndices > 0)
+	{
+		int rows = (numIndices + GL3_CLUSTER_INDEX_WIDTH - 1) / GL3_CLUSTER_INDEX_WIDTH;
+
+		GL3_SelectTMU(GL_TEXTURE6);
+		glBindTexture(GL_TEXTURE_2D, gl3state.clusterIndexTex);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GL3_CLUSTER_INDEX_WIDTH, rows,
+				GL_RED_INTEGER, GL_UNSIGNED_SHORT, clusterIndices);
+	}
+
+	GL3_SelectTMU(GL_TEXTURE0);
+
 	GL3_UpdateUBOLights();
 }
 
@@ -230,7 +497,7 @@ RecursiveLightPoint(mnode_t *node, vec3_t start, vec3_t end)
 }
 
 void
-GL3_LightPoint(entity_t *currententity, vec3_t p, vec3_t color)
+GL3_LightPoint(entity_t *currententity, vec3_t p, vec3_t color, qboolean addDlights)
 {
 	vec3_t end;
 	float r;
@@ -266,7 +533,7 @@ GL3_LightPoint(entity_t *currententity, vec3_t p, vec3_t color)
 	/* add dynamic lights */
 	dl = r_newrefdef.dlights;
 
-	for (lnum = 0; lnum < r_newrefdef.num_dlights; lnum++, dl++)
+	for (lnum = 0; addDlights && lnum < r_newrefdef.num_dlights; lnum++, dl++)
 	{
 		VectorSubtract(currententity->origin,
 				dl->origin, dist);
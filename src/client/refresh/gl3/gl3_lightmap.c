@@ -35,32 +35,98 @@ extern gl3lightmapstate_t gl3_lms;
 void
 GL3_LM_InitBlock(void)
 {
-	memset(gl3_lms.allocated, 0, sizeof(gl3_lms.allocated));
+	gl3_lms.skyline[0].x = 0;
+	gl3_lms.skyline[0].y = 0;
+	gl3_lms.skyline[0].width = BLOCK_WIDTH;
+	gl3_lms.numSkylineNodes = 1;
+
+	gl3_lms.dirtyMins[0] = BLOCK_WIDTH;
+	gl3_lms.dirtyMins[1] = BLOCK_HEIGHT;
+	gl3_lms.dirtyMaxs[0] = gl3_lms.dirtyMaxs[1] = 0;
 }
 
-void
-GL3_LM_UploadBlock(void)
+/*
+ * returns the height of the allocated area of the current page
+ */
+static int
+LM_UsedHeight(void)
 {
-	int map;
+	int i, height = 0;
 
-	// NOTE: we don't use the dynamic lightmap anymore - all lightmaps are loaded at level load
-	//       and not changed after that. they're blended dynamically depending on light styles
-	//       though, and dynamic lights are (will be) applied in shader, hopefully per fragment.
+	for (i = 0; i < gl3_lms.numSkylineNodes; i++)
+	{
+		height = Q_max(height, gl3_lms.skyline[i].y);
+	}
+
+	return height;
+}
+
+/*
+ * uploads the dirty part of the current page's lightmap buffers,
+ * creating the textures with the given height first if necessary
+ */
+static void
+LM_UploadDirtyRect(int height)
+{
+	int map, x, y, w, h;
+
+	x = gl3_lms.dirtyMins[0];
+	y = gl3_lms.dirtyMins[1];
+	w = gl3_lms.dirtyMaxs[0] - x;
+	h = gl3_lms.dirtyMaxs[1] - y;
+
+	if (w <= 0 || h <= 0)
+	{
+		return;
+	}
 
 	GL3_BindLightmap(gl3_lms.current_lightmap_texture);
 
-	// upload all 4 lightmaps
-	for(map=0; map < MAX_LIGHTMAPS_PER_SURFACE; ++map)
+	// only a rectangle of the buffer is uploaded, its lines are BLOCK_WIDTH apart
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, BLOCK_WIDTH);
+
+	for (map = 0; map < MAX_LIGHTMAPS_PER_SURFACE; ++map)
 	{
 		GL3_SelectTMU(GL_TEXTURE1+map); // this relies on GL_TEXTURE2 being GL_TEXTURE1+1 etc
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_LIGHTMAP_FORMAT,
-		             BLOCK_WIDTH, BLOCK_HEIGHT, 0, GL_LIGHTMAP_FORMAT,
-		             GL_UNSIGNED_BYTE, gl3_lms.lightmap_buffers[map]);
+		if (gl3_lms.pageHeight == 0)
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_LIGHTMAP_FORMAT,
+			             BLOCK_WIDTH, height, 0, GL_LIGHTMAP_FORMAT,
+			             GL_UNSIGNED_BYTE, NULL);
+		}
+
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_LIGHTMAP_FORMAT, GL_UNSIGNED_BYTE,
+		                gl3_lms.lightmap_buffers[map] + (y * BLOCK_WIDTH + x) * LIGHTMAP_BYTES);
 	}
 
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	if (gl3_lms.pageHeight == 0)
+	{
+		gl3_lms.pageHeight = height;
+	}
+
+	gl3_lms.dirtyMins[0] = BLOCK_WIDTH;
+	gl3_lms.dirtyMins[1] = BLOCK_HEIGHT;
+	gl3_lms.dirtyMaxs[0] = gl3_lms.dirtyMaxs[1] = 0;
+}
+
+void
+GL3_LM_UploadBlock(void)
+{
+	// NOTE: we don't use the dynamic lightmap anymore - all lightmaps are loaded at level load
+	//       and not changed after that. they're blended dynamically depending on light styles
+	//       though, and dynamic lights are (will be) applied in shader, hopefully per fragment.
+
+	// the page is full, so it gets its full size
+	LM_UploadDirtyRect(BLOCK_HEIGHT);
+
+	gl3_lms.pageHeight = 0;
+
 	if (++gl3_lms.current_lightmap_texture == MAX_LIGHTMAPS)
 	{
 		Com_Error(ERR_DROP, "LM_UploadBlock() - MAX_LIGHTMAPS exceeded\n");
@@ -68,51 +134,107 @@ GL3_LM_UploadBlock(void)
 }
 
 /*
- * returns a texture number and the position inside it
+ * Skyline bottom-left packing: the block goes to the lowest spot
+ * where it fits, ties are broken by the narrowest skyline segment
+ * to keep the wide ones for wide blocks.
+ * returns the position inside the current lightmap texture
  */
 qboolean
 GL3_LM_AllocBlock(int w, int h, int *x, int *y)
 {
-	int i, j;
-	int best, best2;
+	gl3skylinenode_t *sky = gl3_lms.skyline;
+	int i, j, left;
+	int best = -1, bestX = 0, bestY = BLOCK_HEIGHT, bestWidth = BLOCK_WIDTH + 1;
 
-	best = BLOCK_HEIGHT;
-
-	for (i = 0; i < BLOCK_WIDTH - w; i++)
+	for (i = 0; i < gl3_lms.numSkylineNodes; i++)
 	{
-		best2 = 0;
+		int nodeY = 0;
 
-		for (j = 0; j < w; j++)
+		if (sky[i].x + w > BLOCK_WIDTH)
 		{
-			if (gl3_lms.allocated[i + j] >= best)
-			{
-				break;
-			}
+			break;
+		}
 
-			if (gl3_lms.allocated[i + j] > best2)
-			{
-				best2 = gl3_lms.allocated[i + j];
-			}
+		// the block rests on the highest segment below it
+		for (j = i, left = w; left > 0; j++)
+		{
+			nodeY = Q_max(nodeY, sky[j].y);
+			left -= sky[j].width;
 		}
 
-		if (j == w)
+		if (nodeY + h > BLOCK_HEIGHT)
 		{
-			/* this is a valid spot */
-			*x = i;
-			*y = best = best2;
+			continue;
+		}
+
+		if (nodeY < bestY || (nodeY == bestY && sky[i].width < bestWidth))
+		{
+			best = i;
+			bestX = sky[i].x;
+			bestY = nodeY;
+			bestWidth = sky[i].width;
 		}
 	}
 
-	if (best + h > BLOCK_HEIGHT)
+	if (best < 0)
 	{
 		return false;
 	}
 
-	for (i = 0; i < w; i++)
+	// insert the top edge of the new block into the skyline..
+	memmove(&sky[best + 1], &sky[best],
+			(gl3_lms.numSkylineNodes - best) * sizeof(*sky));
+	gl3_lms.numSkylineNodes++;
+
+	sky[best].x = bestX;
+	sky[best].y = bestY + h;
+	sky[best].width = w;
+
+	// .. cut away the segments it covers ..
+	for (i = best + 1; i < gl3_lms.numSkylineNodes; )
 	{
-		gl3_lms.allocated[*x + i] = best + h;
+		int covered = sky[i - 1].x + sky[i - 1].width - sky[i].x;
+
+		if (covered <= 0)
+		{
+			break;
+		}
+
+		if (sky[i].width > covered)
+		{
+			sky[i].x += covered;
+			sky[i].width -= covered;
+			break;
+		}
+
+		memmove(&sky[i], &sky[i + 1],
+				(gl3_lms.numSkylineNodes - i - 1) * sizeof(*sky));
+		gl3_lms.numSkylineNodes--;
 	}
 
+	// .. and merge neighbours of the same height
+	for (i = 0; i < gl3_lms.numSkylineNodes - 1; )
+	{
+		if (sky[i].y != sky[i + 1].y)
+		{
+			i++;
+			continue;
+		}
+
+		sky[i].width += sky[i + 1].width;
+		memmove(&sky[i + 1], &sky[i + 2],
+				(gl3_lms.numSkylineNodes - i - 2) * sizeof(*sky));
+		gl3_lms.numSkylineNodes--;
+	}
+
+	*x = bestX;
+	*y = bestY;
+
+	gl3_lms.dirtyMins[0] = Q_min(gl3_lms.dirtyMins[0], bestX);
+	gl3_lms.dirtyMins[1] = Q_min(gl3_lms.dirtyMins[1], bestY);
+	gl3_lms.dirtyMaxs[0] = Q_max(gl3_lms.dirtyMaxs[0], bestX + w);
+	gl3_lms.dirtyMaxs[1] = Q_max(gl3_lms.dirtyMaxs[1], bestY + h);
+
 	return true;
 }
 
@@ -236,7 +358,10 @@ GL3_LM_BeginBuildingLightmaps(gl3model_t *m)
 	static lightstyle_t lightstyles[MAX_LIGHTSTYLES];
 	int i;
 
-	memset(gl3_lms.allocated, 0, sizeof(gl3_lms.allocated));
+	GL3_LM_InitBlock();
+
+	gl3_lms.model = m;
+	gl3_lms.pageHeight = 0;
 
 	gl3_framecount = 1; /* no dlightcache */
 
@@ -258,9 +383,41 @@ GL3_LM_BeginBuildingLightmaps(gl3model_t *m)
 	// Note: the dynamic lightmap used to be initialized here, we don't use that anymore.
 }
 
+/*
+ * The last page usually isn't full, so its textures only get the rows
+ * that are actually used and the lightmap texture coordinates of the
+ * surfaces on it are scaled accordingly.
+ */
 void
 GL3_LM_EndBuildingLightmaps(void)
 {
-	GL3_LM_UploadBlock();
+	gl3model_t *m = gl3_lms.model;
+	int i, j, height;
+	float scale;
+
+	height = Q_max(LM_UsedHeight(), 1);
+	scale = (float)BLOCK_HEIGHT / height;
+
+	for (i = 0; i < m->numsurfaces && height < BLOCK_HEIGHT; i++)
+	{
+		msurface_t *surf = &m->surfaces[i];
+		glpoly_t *p;
+
+		if ((surf->texinfo->flags & (SURF_SKY | SURF_TRANS33 | SURF_TRANS66 | SURF_WARP)) ||
+			(surf->lightmaptexturenum != gl3_lms.current_lightmap_texture))
+		{
+			continue;
+		}
+
+		for (p = surf->polys; p; p = p->next)
+		{
+			for (j = 0; j < p->numverts; j++)
+			{
+				p->vertices[j].lmTexCoord[1] *= scale;
+			}
+		}
+	}
+
+	LM_UploadDirtyRect(height);
 }
 
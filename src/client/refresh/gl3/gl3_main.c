@@ -93,6 +93,8 @@ cvar_t *gl3_particle_size;
 cvar_t *gl3_particle_fade_factor;
 cvar_t *gl3_particle_square;
 cvar_t *gl3_colorlight;
+cvar_t *gl3_clusteredlights;
+cvar_t *gl3_staticworld;
 cvar_t *gl_polyblend;
 
 cvar_t *gl_lefthand;
@@ -249,6 +251,12 @@ GL3_Register(void)
 	gl3_particle_square = ri.Cvar_Get("gl3_particle_square", "0", CVAR_ARCHIVE);
 	// if set to 0, lights (from lightmaps, dynamic lights and on models) are white instead of colored
 	gl3_colorlight = ri.Cvar_Get("gl3_colorlight", "1", CVAR_ARCHIVE);
+	// if set to 1, dynamic lights are assigned to view frustum clusters and evaluated per-pixel
+	// from those lists instead of being marked on all surfaces they touch on the CPU
+	gl3_clusteredlights = ri.Cvar_Get("gl3_clusteredlights", "0", CVAR_ARCHIVE);
+	// if set to 1, opaque world surfaces are drawn from buffers created at map load
+	// instead of being copied into the 3D batch every frame
+	gl3_staticworld = ri.Cvar_Get("gl3_staticworld", "1", CVAR_ARCHIVE);
 	gl_polyblend = ri.Cvar_Get("gl_polyblend", "1", CVAR_ARCHIVE);
 
 	r_norefresh = ri.Cvar_Get("r_norefresh", "0", 0);
@@ -634,6 +642,9 @@ GL3_Init(void)
 		Com_Printf(" - OpenGL Debug Output: Not Supported\n");
 	}
 
+	Com_Printf(" - Persistently mapped stream buffers: %s\n",
+			gl3config.buffer_storage ? "Supported" : "Not supported");
+
 	// generate texture handles for all possible lightmaps
 	glGenTextures(MAX_LIGHTMAPS*MAX_LIGHTMAPS_PER_SURFACE, gl3state.lightmap_textureIDs[0]);
 
@@ -662,6 +673,10 @@ GL3_Init(void)
 
 	GL3_SurfInit();
 
+	GL3_InitLightClusters();
+
+	GL3_InitMeshes();
+
 	glGenFramebuffers(1, &gl3state.ppFBO);
 	// the rest for the FBO is done dynamically in GL3_RenderView() so it can
 	// take the viewsize into account (enforce that by setting invalid size)
@@ -687,6 +702,7 @@ GL3_Shutdown(void)
 		GL3_ShutdownMeshes();
 		GL3_ShutdownImages();
 		GL3_SurfShutdown();
+		GL3_ShutdownLightClusters();
 		GL3_Draw_ShutdownLocal();
 		GL3_ShutdownShaders();
 
@@ -761,22 +777,11 @@ UpdateLMscales(const hmm_vec4 lmScales[MAX_LIGHTMAPS_PER_SURFACE], gl3ShaderInfo
 	}
 }
 
-void GL3_Draw3DBatchesNow()
+// returns a gl3drawCmd_t that reflects the current GL state as far as possible,
+// and otherwise makes sure all state of firstCmd gets set by ApplyDrawCmdState()
+static gl3drawCmd_t
+InitDrawCmdState(const gl3drawCmd_t* firstCmd)
 {
-	if(da_count(drawCmds) == 0)
-		return;
-
-	GL3_BindVAO(gl3state.vao3D);
-	GL3_BindVBO(gl3state.vbo3D);
-	GL3_BindEBO(gl3state.ebo3D);
-
-	glBufferData(GL_ARRAY_BUFFER, da_count(vtxBuf)*sizeof(gl3_3D_vtx_t), vtxBuf.p, GL_STREAM_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, da_count(idxBuf)*sizeof(GLushort), idxBuf.p, GL_STREAM_DRAW);
-
-	++gl3_numBufferVtxData;
-
-	// set curState to something that reflects the actual state, as far as possible,
-	// and otherwise makes sure it'll be set in the loop
 	gl3drawCmd_t curState = GL3_CreateDrawCmd();
 
 	curState.texnum = gl3state.currenttexture;
@@ -788,102 +793,148 @@ void GL3_Draw3DBatchesNow()
 	// for the next two the approach is setting a value that
 	// is different from the one in the first drawCmd, to make sure
 	// the corresponding state is set in the first iteration
-	curState.flags = ~drawCmds.p[0].flags; // just the opposite flags of the first element
-	curState.transModelMatIdx = drawCmds.p[0].transModelMatIdx + 1;
+	curState.flags = ~firstCmd->flags; // just the opposite flags of the first command
+	curState.transModelMatIdx = firstCmd->transModelMatIdx + 1;
 
-	gl3ShaderInfo_t* shader = NULL;
+	return curState;
+}
 
-	for(int i=0, n=da_count(drawCmds); i < n; ++i)
+// sets the GL state (shader, textures, uniforms, ...) for cmd that differs
+// from curState, returns the shader used by cmd
+static gl3ShaderInfo_t*
+ApplyDrawCmdState(const gl3drawCmd_t* cmd, const gl3drawCmd_t* curState, gl3ShaderInfo_t* shader)
+{
+	int flags = cmd->flags;
+	int curFlags = curState->flags;
+	qboolean updateUni3D = false;
+
+	if(cmd->shaderIdx != curState->shaderIdx)
 	{
-		gl3drawCmd_t* cmd = da_getptr(drawCmds, i);
+		shader = GL3_GetDrawCmdShader(cmd);
+		GL3_UseProgram( shader->shaderProgram );
+	}
+	if(cmd->texnum != gl3state.currenttexture)
+		GL3_Bind(cmd->texnum);
+	if(cmd->lmtexnum >= 0)
+		GL3_BindLightmap(cmd->lmtexnum);
 
-		int flags = cmd->flags;
-		int curFlags = curState.flags;
-		qboolean updateUni3D = false;
+	if((flags & DCFlag_DisableDepthMask) != (curFlags & DCFlag_DisableDepthMask))
+		glDepthMask((flags & DCFlag_DisableDepthMask) == 0);
 
-		if(cmd->shaderIdx != curState.shaderIdx)
-		{
-			shader = GL3_GetDrawCmdShader(cmd);
-			GL3_UseProgram( shader->shaderProgram );
-		}
-		if(cmd->texnum != gl3state.currenttexture)
-			GL3_Bind(cmd->texnum);
-		if(cmd->lmtexnum >= 0)
-			GL3_BindLightmap(cmd->lmtexnum);
+	if((flags & DCFlag_Blend) != (curFlags & DCFlag_Blend))
+	{
+		if(flags & DCFlag_Blend)
+			glEnable(GL_BLEND);
+		else
+			glDisable(GL_BLEND);
+	}
 
-		if((flags & DCFlag_DisableDepthMask) != (curFlags & DCFlag_DisableDepthMask))
-			glDepthMask((flags & DCFlag_DisableDepthMask) == 0);
+	if((flags & DCFlag_PolyOffsetFill) != (curFlags & DCFlag_PolyOffsetFill))
+	{
+		if(flags & DCFlag_PolyOffsetFill)
+			glEnable(GL_POLYGON_OFFSET_FILL);
+		else
+			glDisable(GL_POLYGON_OFFSET_FILL);
+	}
 
-		if((flags & DCFlag_Blend) != (curFlags & DCFlag_Blend))
-		{
-			if(flags & DCFlag_Blend)
-				glEnable(GL_BLEND);
-			else
-				glDisable(GL_BLEND);
-		}
+	if((flags & DCFlag_UseScroll) && cmd->scroll != gl3state.uni3DData.scroll)
+	{
+		gl3state.uni3DData.scroll = cmd->scroll;
+		updateUni3D = true;
+	}
 
-		if((flags & DCFlag_PolyOffsetFill) != (curFlags & DCFlag_PolyOffsetFill))
-		{
-			if(flags & DCFlag_PolyOffsetFill)
-				glEnable(GL_POLYGON_OFFSET_FILL);
-			else
-				glDisable(GL_POLYGON_OFFSET_FILL);
-		}
+	if((flags & DCFlag_UseLightScaleForTurb)
+	   && cmd->lightScaleForTurb != gl3state.uni3DData.lightScaleForTurb)
+	{
+		gl3state.uni3DData.lightScaleForTurb = cmd->lightScaleForTurb;
+		updateUni3D = true;
+	}
 
-		if((flags & DCFlag_UseScroll) && cmd->scroll != gl3state.uni3DData.scroll)
+	if((flags & DCFlag_UseLmStyles) && !lmstylesEqual(cmd->styles, curState->styles))
+	{
+		hmm_vec4 lmScales[MAX_LIGHTMAPS_PER_SURFACE] = {0};
+		lmScales[0] = HMM_Vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		for(int map = 0; map < MAX_LIGHTMAPS_PER_SURFACE && cmd->styles[map] != 255; map++)
 		{
-			gl3state.uni3DData.scroll = cmd->scroll;
-			updateUni3D = true;
+			lmScales[map].R = r_newrefdef.lightstyles[cmd->styles[map]].rgb[0];
+			lmScales[map].G = r_newrefdef.lightstyles[cmd->styles[map]].rgb[1];
+			lmScales[map].B = r_newrefdef.lightstyles[cmd->styles[map]].rgb[2];
+			lmScales[map].A = 1.0f;
 		}
+		UpdateLMscales(lmScales, shader);
+	}
 
-		if((flags & DCFlag_UseLightScaleForTurb)
-		   && cmd->lightScaleForTurb != gl3state.uni3DData.lightScaleForTurb)
+	if(flags & DCFlag_UseColor)
+	{
+		if(cmd->alpha != curState->alpha || !colorsEqual(cmd->color, curState->color))
 		{
-			gl3state.uni3DData.lightScaleForTurb = cmd->lightScaleForTurb;
-			updateUni3D = true;
+			gl3state.uniCommonData.color.R = cmd->color[0] * (1.0f/255.0f);
+			gl3state.uniCommonData.color.G = cmd->color[1] * (1.0f/255.0f);
+			gl3state.uniCommonData.color.B = cmd->color[2] * (1.0f/255.0f);
+			gl3state.uniCommonData.color.A = cmd->alpha;
+			GL3_UpdateUBOCommon();
 		}
+	}
+	else if((flags & DCFlag_Blend) && cmd->alpha != gl3state.uni3DData.alpha)
+	{
+		gl3state.uni3DData.alpha = cmd->alpha;
+		updateUni3D = true;
+	}
 
-		if((flags & DCFlag_UseLmStyles) && !lmstylesEqual(cmd->styles, curState.styles))
-		{
-			hmm_vec4 lmScales[MAX_LIGHTMAPS_PER_SURFACE] = {0};
-			lmScales[0] = HMM_Vec4(1.0f, 1.0f, 1.0f, 1.0f);
-			for(int map = 0; map < MAX_LIGHTMAPS_PER_SURFACE && cmd->styles[map] != 255; map++)
-			{
-				lmScales[map].R = r_newrefdef.lightstyles[cmd->styles[map]].rgb[0];
-				lmScales[map].G = r_newrefdef.lightstyles[cmd->styles[map]].rgb[1];
-				lmScales[map].B = r_newrefdef.lightstyles[cmd->styles[map]].rgb[2];
-				lmScales[map].A = 1.0f;
-			}
-			UpdateLMscales(lmScales, shader);
-		}
+	if(cmd->transModelMatIdx != curState->transModelMatIdx)
+	{
+		gl3state.uni3DData.transModelMat4 = da_get(transModelMats, cmd->transModelMatIdx);
+		updateUni3D = true;
+	}
 
-		if(flags & DCFlag_UseColor)
-		{
-			if(cmd->alpha != curState.alpha || !colorsEqual(cmd->color, curState.color))
-			{
-				gl3state.uniCommonData.color.R = cmd->color[0] * (1.0f/255.0f);
-				gl3state.uniCommonData.color.G = cmd->color[1] * (1.0f/255.0f);
-				gl3state.uniCommonData.color.B = cmd->color[2] * (1.0f/255.0f);
-				gl3state.uniCommonData.color.A = cmd->alpha;
-				GL3_UpdateUBOCommon();
-			}
-		}
-		else if((flags & DCFlag_Blend) && cmd->alpha != gl3state.uni3DData.alpha)
-		{
-			gl3state.uni3DData.alpha = cmd->alpha;
-			updateUni3D = true;
-		}
+	if(updateUni3D)
+		GL3_UpdateUBO3D();
 
-		if(cmd->transModelMatIdx != curState.transModelMatIdx)
-		{
-			gl3state.uni3DData.transModelMat4 = da_get(transModelMats, cmd->transModelMatIdx);
-			updateUni3D = true;
-		}
+	return shader;
+}
 
-		if(updateUni3D)
-			GL3_UpdateUBO3D();
+// restore sane default for other draw operations (models, particles, 2D)
+static void
+RestoreDrawCmdState(const gl3drawCmd_t* curState)
+{
+	if(curState->transModelMatIdx != 0)
+	{
+		gl3state.uni3DData.transModelMat4 = gl3_identityMat4;
+		GL3_UpdateUBO3D();
+	}
+	int curFlags = curState->flags;
+	if(curFlags & DCFlag_Blend)
+		glDisable(GL_BLEND);
+	if(curFlags & DCFlag_DisableDepthMask)
+		glDepthMask(GL_TRUE);
+
+	if(curFlags & DCFlag_PolyOffsetFill)
+		glDisable(GL_POLYGON_OFFSET_FILL);
+}
+
+void GL3_Draw3DBatchesNow()
+{
+	if(da_count(drawCmds) == 0)
+		return;
+
+	GL3_BindVAO(gl3state.vao3D);
 
-		uintptr_t elemOffset = cmd->idxBufOffset * sizeof(GLushort);
+	GLintptr vtxOffset = GL3_StreamData(&gl3state.vbo3D, vtxBuf.p, da_count(vtxBuf)*sizeof(gl3_3D_vtx_t));
+	GL3_VertexAttribs3D(vtxOffset);
+	GLintptr idxOffset = GL3_StreamData(&gl3state.ebo3D, idxBuf.p, da_count(idxBuf)*sizeof(GLushort));
+
+	++gl3_numBufferVtxData;
+
+	gl3drawCmd_t curState = InitDrawCmdState(&drawCmds.p[0]);
+	gl3ShaderInfo_t* shader = NULL;
+
+	for(int i=0, n=da_count(drawCmds); i < n; ++i)
+	{
+		gl3drawCmd_t* cmd = da_getptr(drawCmds, i);
+
+		shader = ApplyDrawCmdState(cmd, &curState, shader);
+
+		uintptr_t elemOffset = idxOffset + cmd->idxBufOffset * sizeof(GLushort);
 		glDrawElements(GL_TRIANGLES, cmd->numElements, GL_UNSIGNED_SHORT, (void*)elemOffset);
 		curState = *cmd;
 
@@ -896,20 +947,44 @@ void GL3_Draw3DBatchesNow()
 
 	da_setcount(transModelMats, 1); // keep index 0 (identity matrix)
 
-	// restore sane default for other draw operations (models, particles, 2D)
-	if(curState.transModelMatIdx != 0)
+	RestoreDrawCmdState(&curState);
+}
+
+// draws index ranges of a static buffer with GL_UNSIGNED_INT indices, like the
+// world buffer from gl3_surf.c; the VAO using that buffer must be bound.
+// here cmd->idxBufOffset is the first range in counts/offsets and
+// cmd->numElements the number of ranges
+void
+GL3_DrawStaticBatches(const gl3drawCmd_t* cmds, int numCmds, const GLsizei* counts, const void* const* offsets)
+{
+	if(numCmds == 0)
+		return;
+
+	gl3drawCmd_t curState = InitDrawCmdState(&cmds[0]);
+	gl3ShaderInfo_t* shader = NULL;
+
+	for(int i=0; i < numCmds; ++i)
 	{
-		gl3state.uni3DData.transModelMat4 = gl3_identityMat4;
-		GL3_UpdateUBO3D();
+		const gl3drawCmd_t* cmd = &cmds[i];
+
+		shader = ApplyDrawCmdState(cmd, &curState, shader);
+
+#ifdef YQ2_GL3_GLES
+		// GLES3 doesn't have glMultiDrawElements()
+		for(int r = cmd->idxBufOffset; r < cmd->idxBufOffset + cmd->numElements; ++r)
+		{
+			glDrawElements(GL_TRIANGLES, counts[r], GL_UNSIGNED_INT, offsets[r]);
+		}
+#else
+		glMultiDrawElements(GL_TRIANGLES, counts + cmd->idxBufOffset, GL_UNSIGNED_INT,
+		                    offsets + cmd->idxBufOffset, cmd->numElements);
+#endif
+		curState = *cmd;
+
+		++gl3_num3Ddraws;
 	}
-	int curFlags = curState.flags;
-	if(curFlags & DCFlag_Blend)
-		glDisable(GL_BLEND);
-	if(curFlags & DCFlag_DisableDepthMask)
-		glDepthMask(GL_TRUE);
 
-	if(curFlags & DCFlag_PolyOffsetFill)
-		glDisable(GL_POLYGON_OFFSET_FILL);
+	RestoreDrawCmdState(&curState);
 }
 
 static qboolean drawStateEqual(const gl3drawCmd_t* a, const gl3drawCmd_t* b)
@@ -1199,7 +1274,7 @@ GL3_DrawNullModel(entity_t *currententity)
 	}
 	else
 	{
-		GL3_LightPoint(currententity, currententity->origin, shadelight);
+		GL3_LightPoint(currententity, currententity->origin, shadelight, true);
 	}
 
 	GL3_RotateForEntity(currententity, &drawCmd);
@@ -1243,8 +1318,7 @@ GL3_DrawParticles(void)
 
 	//if (!(stereo_split_tb || stereo_split_lr))
 	{
-		int i;
-		int numParticles = r_newrefdef.num_particles;
+		int i, first, numParticles;
 		YQ2_ALIGNAS_TYPE(unsigned) byte color[4];
 		const particle_t *p;
 		// assume the size looks good with window height 480px and scale according to real resolution
@@ -1259,12 +1333,14 @@ GL3_DrawParticles(void)
 		YQ2_STATIC_ASSERT(sizeof(part_vtx)==9*sizeof(float), "invalid part_vtx size"); // remember to update GL3_SurfInit() if this changes!
 
 		// Don't try to draw particles if there aren't any.
-		if (numParticles == 0)
+		if (r_newrefdef.num_particles == 0)
 		{
 			return;
 		}
 
-		YQ2_VLA(part_vtx, buf, numParticles);
+		// the client may send a lot of particles, they're drawn in batches
+		// of MAX_PARTICLES so the VLA doesn't blow the stack
+		YQ2_VLA(part_vtx, buf, Q_min(r_newrefdef.num_particles, MAX_PARTICLES));
 
 		// TODO: viewOrg could be in UBO
 		vec3_t viewOrg;
@@ -1284,29 +1360,33 @@ GL3_DrawParticles(void)
 #endif
 
 		GL3_UseProgram(gl3state.siParticle.shaderProgram);
+		GL3_BindVAO(gl3state.vaoParticle);
 
-		for ( i = 0, p = r_newrefdef.particles; i < numParticles; i++, p++ )
+		for ( first = 0; first < r_newrefdef.num_particles; first += numParticles )
 		{
-			*(int *) color = d_8to24table [ p->color & 0xFF ];
-			part_vtx* cur = &buf[i];
-			vec3_t offset; // between viewOrg and particle position
-			VectorSubtract(viewOrg, p->origin, offset);
+			numParticles = Q_min(r_newrefdef.num_particles - first, MAX_PARTICLES);
 
-			VectorCopy(p->origin, cur->pos);
-			cur->size = pointSize;
-			cur->dist = VectorLength(offset);
+			for ( i = 0, p = r_newrefdef.particles + first; i < numParticles; i++, p++ )
+			{
+				*(int *) color = d_8to24table [ p->color & 0xFF ];
+				part_vtx* cur = &buf[i];
+				vec3_t offset; // between viewOrg and particle position
+				VectorSubtract(viewOrg, p->origin, offset);
 
-			for(int j=0; j<3; ++j)  cur->color[j] = color[j]*(1.0f/255.0f);
+				VectorCopy(p->origin, cur->pos);
+				cur->size = pointSize;
+				cur->dist = VectorLength(offset);
 
-			cur->color[3] = p->alpha;
-		}
+				for(int j=0; j<3; ++j)  cur->color[j] = color[j]*(1.0f/255.0f);
 
-		GL3_BindVAO(gl3state.vaoParticle);
-		GL3_BindVBO(gl3state.vboParticle);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(part_vtx)*numParticles, buf, GL_STREAM_DRAW);
-		glDrawArrays(GL_POINTS, 0, numParticles);
-		++gl3_num3Ddraws;
-		++gl3_numBufferVtxData;
+				cur->color[3] = p->alpha;
+			}
+
+			GL3_VertexAttribsParticle(GL3_StreamData(&gl3state.vboParticle, buf, sizeof(part_vtx)*numParticles));
+			glDrawArrays(GL_POINTS, 0, numParticles);
+			++gl3_num3Ddraws;
+			++gl3_numBufferVtxData;
+		}
 
 		glDisable(GL_BLEND);
 		glDepthMask(GL_TRUE);
@@ -1917,6 +1997,8 @@ GL3_RenderView(refdef_t *fd)
 
 	SetupGL();
 
+	GL3_BuildLightClusters();
+
 	GL3_MarkLeaves(); /* done here so we know if we're in water */
 
 	GL3_DrawWorld();
@@ -1991,7 +2073,7 @@ GL3_SetLightLevel(entity_t *currententity)
 	}
 
 	/* save off light value for server to look at */
-	GL3_LightPoint(currententity, r_newrefdef.vieworg, shadelight);
+	GL3_LightPoint(currententity, r_newrefdef.vieworg, shadelight, true);
 
 	/* pick the greatest component, which should be the
 	 * same as the mono value returned by software */
@@ -2264,6 +2346,7 @@ GetRefAPI(refimport_t imp)
 
 	re.api_version = API_VERSION;
 	re.framework_version = GL3_GetSDLVersion();
+	re.max_dlights = GL3_MAX_DLIGHTS;
 
 	re.Init = GL3_Init;
 	re.Shutdown = GL3_Shutdown;
@@ -63,6 +63,50 @@ DA_TYPEDEF(GLushort, UShortArray_t);
 static AliasVtxArray_t vtxBuf = {0};
 static UShortArray_t idxBuf = {0};
 
+void
+GL3_InitMeshes(void)
+{
+	// (normal, shadedot) for each normal index (x) and quantized yaw (y),
+	// used by the vertex shader of si3DaliasLerp
+	static float anorms[SHADEDOT_QUANT][256][4];
+	int i, j;
+
+	for (i = 0; i < SHADEDOT_QUANT; i++)
+	{
+		for (j = 0; j < 256; j++)
+		{
+			if (j < NUMVERTEXNORMALS)
+			{
+				VectorCopy(r_avertexnormals[j], anorms[i][j]);
+			}
+			else
+			{
+				VectorClear(anorms[i][j]);
+			}
+
+			anorms[i][j][3] = r_avertexnormal_dots[i][j];
+		}
+	}
+
+	glGenTextures(1, &gl3state.anormTex);
+
+	GL3_SelectTMU(GL_TEXTURE7);
+	glBindTexture(GL_TEXTURE_2D, gl3state.anormTex);
+	// only read with texelFetch()
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, 256, SHADEDOT_QUANT, 0, GL_RGBA, GL_FLOAT, anorms);
+	GL3_SelectTMU(GL_TEXTURE0);
+
+	// the attribute pointers are set for each model in DrawAliasFrameLerpGPU()
+	glGenVertexArrays(1, &gl3state.vaoAliasLerp);
+	GL3_BindVAO(gl3state.vaoAliasLerp);
+
+	glEnableVertexAttribArray(GL3_ATTRIB_TEXCOORD);
+	glEnableVertexAttribArray(GL3_ATTRIB_FRONTVERT);
+	glEnableVertexAttribArray(GL3_ATTRIB_BACKVERT);
+}
+
 void
 GL3_ShutdownMeshes(void)
 {
@@ -70,6 +114,226 @@ GL3_ShutdownMeshes(void)
 	da_free(idxBuf);
 
 	da_free(shadowModels);
+
+	if (gl3state.vaoAliasLerp != 0)
+	{
+		GL3_BindVAO(0);
+		glDeleteVertexArrays(1, &gl3state.vaoAliasLerp);
+		gl3state.vaoAliasLerp = 0;
+	}
+
+	if (gl3state.anormTex != 0)
+	{
+		glDeleteTextures(1, &gl3state.anormTex);
+		gl3state.anormTex = 0;
+	}
+}
+
+/*
+ * Unrolls the glcmds of an alias model into triangles and puts the
+ * texture coordinates and all frames into aliasVBO, so the frames don't
+ * have to be lerped and uploaded on the CPU for each draw.
+ * aliasVBO layout: aliasNumVerts texcoords (2 floats each), followed by
+ * aliasNumVerts dtrivertx_t for each frame.
+ */
+void
+GL3_BuildAliasBuffers(gl3model_t *mod)
+{
+	dmdl_t *paliashdr = (dmdl_t *)mod->extradata;
+	int *order;
+	int numVerts = 0, numIndices = 0;
+	int i, f;
+	GLfloat *texCoords;
+	int *xyzIndices;
+	GLushort *indices;
+	dtrivertx_t *frameVerts;
+	size_t framesSize;
+
+	mod->aliasVBO = mod->aliasEBO = 0;
+	mod->aliasNumVerts = mod->aliasNumIndices = 0;
+
+	if (mod->type != mod_alias || paliashdr == NULL)
+	{
+		return;
+	}
+
+	// first count the vertices and indices
+	order = (int *)((byte *)paliashdr + paliashdr->ofs_glcmds);
+
+	while (*order)
+	{
+		int count = abs(*order);
+
+		numVerts += count;
+		numIndices += 3 * (count - 2);
+		order += 1 + 3 * count;
+	}
+
+	if (numVerts == 0 || numVerts > UINT16_MAX)
+	{
+		// stays on the CPU path
+		return;
+	}
+
+	texCoords = malloc(numVerts * 2 * sizeof(GLfloat));
+	xyzIndices = malloc(numVerts * sizeof(int));
+	indices = malloc(numIndices * sizeof(GLushort));
+	numVerts = numIndices = 0;
+
+	order = (int *)((byte *)paliashdr + paliashdr->ofs_glcmds);
+
+	while (1)
+	{
+		GLushort nextVtxIdx = numVerts;
+		qboolean fan;
+		int count = *order++;
+
+		if (!count)
+		{
+			break;
+		}
+
+		fan = count < 0;
+		count = abs(count);
+
+		for (i = 0; i < count; i++, numVerts++)
+		{
+			texCoords[2 * numVerts] = ((float *)order)[0];
+			texCoords[2 * numVerts + 1] = ((float *)order)[1];
+			// don't read past the frame for broken glcmds
+			xyzIndices[numVerts] = (order[2] >= 0 && order[2] < paliashdr->num_xyz) ? order[2] : 0;
+			order += 3;
+		}
+
+		// translate triangle fan/strip to just triangle indices, like DrawAliasFrameLerp()
+		if (fan)
+		{
+			for (i = 1; i < count - 1; i++)
+			{
+				indices[numIndices++] = nextVtxIdx;
+				indices[numIndices++] = nextVtxIdx + i;
+				indices[numIndices++] = nextVtxIdx + i + 1;
+			}
+		}
+		else
+		{
+			for (i = 1; i < count - 2; i += 2)
+			{
+				indices[numIndices++] = nextVtxIdx + i - 1;
+				indices[numIndices++] = nextVtxIdx + i;
+				indices[numIndices++] = nextVtxIdx + i + 1;
+
+				indices[numIndices++] = nextVtxIdx + i;
+				indices[numIndices++] = nextVtxIdx + i + 2;
+				indices[numIndices++] = nextVtxIdx + i + 1;
+			}
+
+			if (i < count - 1)
+			{
+				indices[numIndices++] = nextVtxIdx + i - 1;
+				indices[numIndices++] = nextVtxIdx + i;
+				indices[numIndices++] = nextVtxIdx + i + 1;
+			}
+		}
+	}
+
+	framesSize = (size_t)numVerts * paliashdr->num_frames * sizeof(dtrivertx_t);
+	frameVerts = malloc(framesSize);
+
+	for (f = 0; f < paliashdr->num_frames; f++)
+	{
+		daliasframe_t *frame = (daliasframe_t *)((byte *)paliashdr
+				+ paliashdr->ofs_frames + f * paliashdr->framesize);
+
+		for (i = 0; i < numVerts; i++)
+		{
+			frameVerts[f * numVerts + i] = frame->verts[xyzIndices[i]];
+		}
+	}
+
+	// GL_COPY_WRITE_BUFFER doesn't mess with the EBO binding of the current VAO
+	glGenBuffers(1, &mod->aliasVBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, mod->aliasVBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, numVerts * 2 * sizeof(GLfloat) + framesSize, NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, 0, numVerts * 2 * sizeof(GLfloat), texCoords);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, numVerts * 2 * sizeof(GLfloat), framesSize, frameVerts);
+
+	glGenBuffers(1, &mod->aliasEBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, mod->aliasEBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, numIndices * sizeof(GLushort), indices, GL_STATIC_DRAW);
+
+	mod->aliasNumVerts = numVerts;
+	mod->aliasNumIndices = numIndices;
+
+	free(frameVerts);
+	free(indices);
+	free(xyzIndices);
+	free(texCoords);
+}
+
+void
+GL3_FreeAliasBuffers(gl3model_t *mod)
+{
+	if (mod->aliasVBO != 0)
+	{
+		if (gl3state.currentVBO == mod->aliasVBO)
+		{
+			GL3_BindVBO(0);
+		}
+
+		glDeleteBuffers(1, &mod->aliasVBO);
+		mod->aliasVBO = 0;
+	}
+
+	if (mod->aliasEBO != 0)
+	{
+		// deleting it also removes it from vaoAliasLerp
+		if (gl3state.currentEBO == mod->aliasEBO)
+		{
+			gl3state.currentEBO = 0;
+		}
+
+		glDeleteBuffers(1, &mod->aliasEBO);
+		mod->aliasEBO = 0;
+	}
+}
+
+/*
+ * Draws a model from its aliasVBO, the lerping between frame and oldframe
+ * (see LerpVerts()) and the shading happen in the vertex shader.
+ */
+static void
+DrawAliasFrameLerpGPU(gl3model_t *model, entity_t *entity, qboolean colorOnly,
+		const vec3_t move, const vec3_t frontv, const vec3_t backv,
+		const vec3_t shadelight, float alpha)
+{
+	gl3ShaderInfo_t *shader = colorOnly ? &gl3state.si3DaliasLerpColor : &gl3state.si3DaliasLerp;
+	int shadeDotsRow = ((int)(entity->angles[1] * (SHADEDOT_QUANT / 360.0))) & (SHADEDOT_QUANT - 1);
+	GLintptr framesOfs = model->aliasNumVerts * 2 * sizeof(GLfloat);
+	GLsizei frameSize = model->aliasNumVerts * sizeof(dtrivertx_t);
+
+	GLfloat aliasFrame[4][4] = {
+		{ move[0], move[1], move[2], colorOnly ? POWERSUIT_SCALE : 0.0f },
+		{ frontv[0], frontv[1], frontv[2], shadeDotsRow },
+		{ backv[0], backv[1], backv[2], colorOnly ? 1.0f : 0.0f },
+		{ shadelight[0], shadelight[1], shadelight[2], alpha }
+	};
+
+	GL3_UseProgram(shader->shaderProgram);
+	glUniform4fv(shader->uniAliasFrame, 4, aliasFrame[0]);
+
+	GL3_BindVAO(gl3state.vaoAliasLerp);
+	GL3_BindVBO(model->aliasVBO);
+
+	qglVertexAttribPointer(GL3_ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	qglVertexAttribPointer(GL3_ATTRIB_FRONTVERT, 4, GL_UNSIGNED_BYTE, GL_FALSE, 0,
+			framesOfs + entity->frame * frameSize);
+	qglVertexAttribPointer(GL3_ATTRIB_BACKVERT, 4, GL_UNSIGNED_BYTE, GL_FALSE, 0,
+			framesOfs + entity->oldframe * frameSize);
+
+	GL3_BindEBO(model->aliasEBO);
+	glDrawElements(GL_TRIANGLES, model->aliasNumIndices, GL_UNSIGNED_SHORT, NULL);
+	++gl3_num3Ddraws;
 }
 
 static void
@@ -124,6 +388,7 @@ DrawAliasFrameLerp(dmdl_t *paliashdr, entity_t* entity, vec3_t shadelight)
 	float backlerp = entity->backlerp;
 	float frontlerp = 1.0 - backlerp;
 	float *lerp;
+	gl3model_t *model = entity->model;
 	// draw without texture? used for quad damage effect etc, I think
 	qboolean colorOnly = 0 != (entity->flags &
 			(RF_SHELL_RED | RF_SHELL_GREEN | RF_SHELL_BLUE | RF_SHELL_DOUBLE |
@@ -152,15 +417,6 @@ DrawAliasFrameLerp(dmdl_t *paliashdr, entity_t* entity, vec3_t shadelight)
 		alpha = 1.0;
 	}
 
-	if (colorOnly)
-	{
-		GL3_UseProgram(gl3state.si3DaliasColor.shaderProgram);
-	}
-	else
-	{
-		GL3_UseProgram(gl3state.si3Dalias.shaderProgram);
-	}
-
 	if(gl3_colorlight->value == 0.0f)
 	{
 		float avg = 0.333333f * (shadelight[0]+shadelight[1]+shadelight[2]);
@@ -185,6 +441,21 @@ DrawAliasFrameLerp(dmdl_t *paliashdr, entity_t* entity, vec3_t shadelight)
 		backv[i] = backlerp * oldframe->scale[i];
 	}
 
+	if (model->aliasVBO != 0)
+	{
+		DrawAliasFrameLerpGPU(model, entity, colorOnly, move, frontv, backv, shadelight, alpha);
+		return;
+	}
+
+	if (colorOnly)
+	{
+		GL3_UseProgram(gl3state.si3DaliasColor.shaderProgram);
+	}
+	else
+	{
+		GL3_UseProgram(gl3state.si3Dalias.shaderProgram);
+	}
+
 	lerp = s_lerped[0];
 
 	LerpVerts(colorOnly, paliashdr->num_xyz, v, ov, verts, lerp, move, frontv, backv);
@@ -317,12 +588,10 @@ DrawAliasFrameLerp(dmdl_t *paliashdr, entity_t* entity, vec3_t shadelight)
 	}
 
 	GL3_BindVAO(gl3state.vaoAlias);
-	GL3_BindVBO(gl3state.vboAlias);
 
-	glBufferData(GL_ARRAY_BUFFER, da_count(vtxBuf)*sizeof(gl3_alias_vtx_t), vtxBuf.p, GL_STREAM_DRAW);
-	GL3_BindEBO(gl3state.eboAlias);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, da_count(idxBuf)*sizeof(GLushort), idxBuf.p, GL_STREAM_DRAW);
-	glDrawElements(GL_TRIANGLES, da_count(idxBuf), GL_UNSIGNED_SHORT, NULL);
+	GL3_VertexAttribsAlias(GL3_StreamData(&gl3state.vboAlias, vtxBuf.p, da_count(vtxBuf)*sizeof(gl3_alias_vtx_t)));
+	GLintptr idxOffset = GL3_StreamData(&gl3state.eboAlias, idxBuf.p, da_count(idxBuf)*sizeof(GLushort));
+	glDrawElements(GL_TRIANGLES, da_count(idxBuf), GL_UNSIGNED_SHORT, (void*)idxOffset);
 	++gl3_num3Ddraws;
 	++gl3_numBufferVtxData;
 	// TODO ++gl3_numBufferIdxData ?
@@ -481,12 +750,10 @@ DrawAliasShadow(gl3_shadowinfo_t* shadowInfo)
 	}
 
 	GL3_BindVAO(gl3state.vaoAlias);
-	GL3_BindVBO(gl3state.vboAlias);
 
-	glBufferData(GL_ARRAY_BUFFER, da_count(vtxBuf)*sizeof(gl3_alias_vtx_t), vtxBuf.p, GL_STREAM_DRAW);
-	GL3_BindEBO(gl3state.eboAlias);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, da_count(idxBuf)*sizeof(GLushort), idxBuf.p, GL_STREAM_DRAW);
-	glDrawElements(GL_TRIANGLES, da_count(idxBuf), GL_UNSIGNED_SHORT, NULL);
+	GL3_VertexAttribsAlias(GL3_StreamData(&gl3state.vboAlias, vtxBuf.p, da_count(vtxBuf)*sizeof(gl3_alias_vtx_t)));
+	GLintptr idxOffset = GL3_StreamData(&gl3state.eboAlias, idxBuf.p, da_count(idxBuf)*sizeof(GLushort));
+	glDrawElements(GL_TRIANGLES, da_count(idxBuf), GL_UNSIGNED_SHORT, (void*)idxOffset);
 	++gl3_num3Ddraws;
 	++gl3_numBufferVtxData;
 	// TODO ++gl3_numBufferIdxData ?
@@ -723,33 +990,46 @@ GL3_DrawAliasModel(entity_t *entity)
 	}
 	else
 	{
-		GL3_LightPoint(entity, entity->origin, shadelight);
+		/* with gl3_clusteredlights the shader adds the dynamic lights */
+		GL3_LightPoint(entity, entity->origin, shadelight, !gl3state.clusteredLights);
 
 		/* player lighting hack for communication back to server */
 		if (entity->flags & RF_WEAPONMODEL)
 		{
+			vec3_t lightlevel;
+
+			/* the server wants to know about dynamic lights (muzzleflashes..) */
+			if (gl3state.clusteredLights)
+			{
+				GL3_LightPoint(entity, entity->origin, lightlevel, true);
+			}
+			else
+			{
+				VectorCopy(shadelight, lightlevel);
+			}
+
 			/* pick the greatest component, which should be
 			   the same as the mono value returned by software */
-			if (shadelight[0] > shadelight[1])
+			if (lightlevel[0] > lightlevel[1])
 			{
-				if (shadelight[0] > shadelight[2])
+				if (lightlevel[0] > lightlevel[2])
 				{
-					r_lightlevel->value = 150 * shadelight[0];
+					r_lightlevel->value = 150 * lightlevel[0];
 				}
 				else
 				{
-					r_lightlevel->value = 150 * shadelight[2];
+					r_lightlevel->value = 150 * lightlevel[2];
 				}
 			}
 			else
 			{
-				if (shadelight[1] > shadelight[2])
+				if (lightlevel[1] > lightlevel[2])
 				{
-					r_lightlevel->value = 150 * shadelight[1];
+					r_lightlevel->value = 150 * lightlevel[1];
 				}
 				else
 				{
-					r_lightlevel->value = 150 * shadelight[2];
+					r_lightlevel->value = 150 * lightlevel[2];
 				}
 			}
 		}
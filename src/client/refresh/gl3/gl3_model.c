@@ -591,6 +591,7 @@ Mod_LoadBrushModel(gl3model_t *mod, void *buffer, int modfilelen)
 static void
 Mod_Free(gl3model_t *mod)
 {
+	GL3_FreeAliasBuffers(mod);
 	Hunk_Free(mod->extradata);
 	memset(mod, 0, sizeof(*mod));
 }
@@ -702,6 +703,8 @@ Mod_ForName(const char *name, gl3model_t *parent_model, qboolean crash)
 					Com_Error(ERR_DROP, "%s: Failed to load %s",
 						__func__, mod->name);
 				}
+
+				GL3_BuildAliasBuffers(mod);
 			};
 			break;
 
@@ -763,6 +766,8 @@ GL3_BeginRegistration(const char *model)
 
 	gl3_worldmodel = Mod_ForName(fullname, NULL, true);
 
+	GL3_BuildWorldBuffers();
+
 	gl3_viewcluster = -1;
 }
 
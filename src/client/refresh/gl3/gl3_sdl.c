@@ -404,8 +404,10 @@ int GL3_InitContext(void* win)
 
 #ifdef YQ2_GL3_GLES
 	gl3config.debug_output = GLAD_GL_KHR_debug != 0;
+	gl3config.buffer_storage = false; // GL_EXT_buffer_storage isn't loaded, streaming falls back to orphaning
 #else // Desktop GL
 	gl3config.debug_output = GLAD_GL_ARB_debug_output != 0;
+	gl3config.buffer_storage = GLAD_GL_ARB_buffer_storage != 0;
 #endif
 	gl3config.anisotropic = GLAD_GL_EXT_texture_filter_anisotropic != 0;
 
@@ -117,6 +117,8 @@ CreateShaderProgram(int numShaders, const GLuint* shaders)
 	glBindAttribLocation(shaderProgram, GL3_ATTRIB_COLOR, "vertColor");
 	glBindAttribLocation(shaderProgram, GL3_ATTRIB_NORMAL, "normal");
 	glBindAttribLocation(shaderProgram, GL3_ATTRIB_LIGHTFLAGS, "lightFlags");
+	glBindAttribLocation(shaderProgram, GL3_ATTRIB_FRONTVERT, "frontVert");
+	glBindAttribLocation(shaderProgram, GL3_ATTRIB_BACKVERT, "backVert");
 
 	// the following line is not necessary/implicit (as there's only one output)
 	// glBindFragDataLocation(shaderProgram, 0, "outColor"); XXX would this even be here?
@@ -439,6 +441,131 @@ static const char* fragmentCommon3D = MULTILINE_STRING(
 			float _pad_1; // AMDs legacy windows driver needs this, otherwise uni3D has wrong size
 			float _pad_2;
 		};
+
+		struct DynLight { // gl3UniDynLight in C
+			vec3 lightOrigin;
+			float _pad;
+			//vec3 lightColor;
+			//float lightIntensity;
+			vec4 lightColor; // .a is intensity; this way it also works on OSX...
+			// (otherwise lightIntensity always contained 1 there)
+		};
+
+		layout (std140) uniform uniLights
+		{
+			DynLight dynLights[256]; // GL3_MAX_DLIGHTS
+			uint numDynLights;
+			uint clusterDimX; // all three are 0 if gl3_clusteredlights is off
+			uint clusterDimY;
+			uint clusterDimZ;
+
+			mat4 clusterProjView;
+			float clusterZNear;
+			float clusterZScale;
+			uint clusterIndexWidth;
+			float modulate;
+		};
+
+		// for gl3_clusteredlights: .x is the offset into clusterIndices, .y the number of lights
+		uniform highp usampler2D clusterGrid;    // GL_TEXTURE5
+		uniform highp usampler2D clusterIndices; // GL_TEXTURE6
+
+		uvec2 clusterForPos(vec3 worldCoord)
+		{
+			// use the main view's projection, so this also works for the gun (which has its own)
+			vec4 clipPos = clusterProjView * vec4(worldCoord, 1.0);
+			float depth = max(clipPos.w, clusterZNear);
+			vec2 tc = clamp(0.5*(clipPos.xy/depth) + 0.5, 0.0, 0.999);
+
+			uint x = uint(tc.x * float(clusterDimX));
+			uint y = uint(tc.y * float(clusterDimY));
+			uint z = min(uint(log(depth/clusterZNear) * clusterZScale), clusterDimZ-1u);
+
+			return texelFetch(clusterGrid, ivec2(x, y + z*clusterDimY), 0).xy;
+		}
+
+		uint clusterLightIndex(uint i)
+		{
+			return texelFetch(clusterIndices, ivec2(i % clusterIndexWidth, i / clusterIndexWidth), 0).x;
+		}
+
+		vec3 surfaceDynLight(uint i, vec3 worldCoord, vec3 normal)
+		{
+			// I made the following up, it's probably not too cool..
+			// it basically checks if the light is on the right side of the surface
+			// and, if it is, sets intensity according to distance between light and pixel on surface
+
+			float intens = dynLights[i].lightColor.a;
+
+			vec3 lightToPos = dynLights[i].lightOrigin - worldCoord;
+			float distLightToPos = length(lightToPos);
+			float fact = max(0.0, intens - distLightToPos - 52.0);
+
+			// move the light source a bit further above the surface
+			// => helps if the lightsource is so close to the surface (e.g. grenades, rockets)
+			//    that the dot product below would return 0
+			// (light sources that are below the surface are filtered out by the caller)
+			lightToPos += normal*32.0;
+
+			// also factor in angle between light and point on surface
+			fact *= max(0.0, dot(normal, normalize(lightToPos)));
+
+			return dynLights[i].lightColor.rgb * fact * (1.0/256.0);
+		}
+
+		// dynamic lights for lightmapped surfaces
+		vec3 calcSurfaceDynLights(vec3 worldCoord, vec3 normal, uint lightFlags)
+		{
+			vec3 ret = vec3(0.0);
+
+			if(clusterDimZ != 0u)
+			{
+				uvec2 cluster = clusterForPos(worldCoord);
+				for(uint j=0u; j<cluster.y; ++j)
+				{
+					uint i = clusterLightIndex(cluster.x + j);
+					// light is behind the surface (GL3_MarkSurfaceLights() does this on the CPU otherwise)
+					if(dot(normal, dynLights[i].lightOrigin - worldCoord) < 0.0)  continue;
+
+					ret += surfaceDynLight(i, worldCoord, normal);
+				}
+			}
+			else if(lightFlags != 0u)
+			{
+				// TODO: or is hardcoding 32 better?
+				for(uint i=0u; i<numDynLights; ++i)
+				{
+					// dyn light number i does not affect this plane, just skip it
+					if((lightFlags & (1u << i)) == 0u)  continue;
+
+					ret += surfaceDynLight(i, worldCoord, normal);
+				}
+			}
+
+			return ret;
+		}
+
+		// dynamic lights for models; without gl3_clusteredlights they're
+		// already part of the vertex color (see GL3_LightPoint())
+		vec3 calcModelDynLights(vec3 worldCoord)
+		{
+			vec3 ret = vec3(0.0);
+
+			if(clusterDimZ != 0u)
+			{
+				uvec2 cluster = clusterForPos(worldCoord);
+				for(uint j=0u; j<cluster.y; ++j)
+				{
+					uint i = clusterLightIndex(cluster.x + j);
+					float dist = length(dynLights[i].lightOrigin - worldCoord);
+					float fact = max(0.0, dynLights[i].lightColor.a - dist) * (1.0/256.0);
+
+					ret += dynLights[i].lightColor.rgb * fact;
+				}
+			}
+
+			return ret * modulate;
+		}
 );
 
 static const char* vertexSrc3D = MULTILINE_STRING(
@@ -553,22 +680,6 @@ static const char* fragmentSrc3Dlm = MULTILINE_STRING(
 
 		// it gets attributes and uniforms from fragmentCommon3D
 
-		struct DynLight { // gl3UniDynLight in C
-			vec3 lightOrigin;
-			float _pad;
-			//vec3 lightColor;
-			//float lightIntensity;
-			vec4 lightColor; // .a is intensity; this way it also works on OSX...
-			// (otherwise lightIntensity always contained 1 there)
-		};
-
-		layout (std140) uniform uniLights
-		{
-			DynLight dynLights[32];
-			uint numDynLights;
-			uint _pad1; uint _pad2; uint _pad3; // FFS, AMD!
-		};
-
 		uniform sampler2D tex;
 
 		uniform sampler2D lightmap0;
@@ -596,37 +707,7 @@ static const char* fragmentSrc3Dlm = MULTILINE_STRING(
 			lmTex     += texture(lightmap2, passLMcoord) * lmScales[2];
 			lmTex     += texture(lightmap3, passLMcoord) * lmScales[3];
 
-			if(passLightFlags != 0u)
-			{
-				// TODO: or is hardcoding 32 better?
-				for(uint i=0u; i<numDynLights; ++i)
-				{
-					// I made the following up, it's probably not too cool..
-					// it basically checks if the light is on the right side of the surface
-					// and, if it is, sets intensity according to distance between light and pixel on surface
-
-					// dyn light number i does not affect this plane, just skip it
-					if((passLightFlags & (1u << i)) == 0u)  continue;
-
-					float intens = dynLights[i].lightColor.a;
-
-					vec3 lightToPos = dynLights[i].lightOrigin - passWorldCoord;
-					float distLightToPos = length(lightToPos);
-					float fact = max(0.0, intens - distLightToPos - 52.0);
-
-					// move the light source a bit further above the surface
-					// => helps if the lightsource is so close to the surface (e.g. grenades, rockets)
-					//    that the dot product below would return 0
-					// (light sources that are below the surface are filtered out by lightFlags)
-					lightToPos += passNormal*32.0;
-
-					// also factor in angle between light and point on surface
-					fact *= max(0.0, dot(passNormal, normalize(lightToPos)));
-
-
-					lmTex.rgb += dynLights[i].lightColor.rgb * fact * (1.0/256.0);
-				}
-			}
+			lmTex.rgb += calcSurfaceDynLights(passWorldCoord, passNormal, passLightFlags);
 
 			lmTex.rgb *= overbrightbits;
 			outColor = lmTex*texel;
@@ -640,22 +721,6 @@ static const char* fragmentSrc3DlmNoColor = MULTILINE_STRING(
 
 		// it gets attributes and uniforms from fragmentCommon3D
 
-		struct DynLight { // gl3UniDynLight in C
-			vec3 lightOrigin;
-			float _pad;
-			//vec3 lightColor;
-			//float lightIntensity;
-			vec4 lightColor; // .a is intensity; this way it also works on OSX...
-			// (otherwise lightIntensity always contained 1 there)
-		};
-
-		layout (std140) uniform uniLights
-		{
-			DynLight dynLights[32];
-			uint numDynLights;
-			uint _pad1; uint _pad2; uint _pad3; // FFS, AMD!
-		};
-
 		uniform sampler2D tex;
 
 		uniform sampler2D lightmap0;
@@ -683,37 +748,7 @@ static const char* fragmentSrc3DlmNoColor = MULTILINE_STRING(
 			lmTex     += texture(lightmap2, passLMcoord) * lmScales[2];
 			lmTex     += texture(lightmap3, passLMcoord) * lmScales[3];
 
-			if(passLightFlags != 0u)
-			{
-				// TODO: or is hardcoding 32 better?
-				for(uint i=0u; i<numDynLights; ++i)
-				{
-					// I made the following up, it's probably not too cool..
-					// it basically checks if the light is on the right side of the surface
-					// and, if it is, sets intensity according to distance between light and pixel on surface
-
-					// dyn light number i does not affect this plane, just skip it
-					if((passLightFlags & (1u << i)) == 0u)  continue;
-
-					float intens = dynLights[i].lightColor.a;
-
-					vec3 lightToPos = dynLights[i].lightOrigin - passWorldCoord;
-					float distLightToPos = length(lightToPos);
-					float fact = max(0.0, intens - distLightToPos - 52.0);
-
-					// move the light source a bit further above the surface
-					// => helps if the lightsource is so close to the surface (e.g. grenades, rockets)
-					//    that the dot product below would return 0
-					// (light sources that are below the surface are filtered out by lightFlags)
-					lightToPos += passNormal*32.0;
-
-					// also factor in angle between light and point on surface
-					fact *= max(0.0, dot(passNormal, normalize(lightToPos)));
-
-
-					lmTex.rgb += dynLights[i].lightColor.rgb * fact * (1.0/256.0);
-				}
-			}
+			lmTex.rgb += calcSurfaceDynLights(passWorldCoord, passNormal, passLightFlags);
 
 			// turn lightcolor into grey for gl3_colorlight 0
 			lmTex.rgb = vec3(0.333 * (lmTex.r+lmTex.g+lmTex.b));
@@ -814,12 +849,51 @@ static const char* vertexSrcAlias = MULTILINE_STRING(
 		// it gets attributes and uniforms from vertexCommon3D
 
 		out vec4 passColor;
+		out vec3 passWorldCoord;
 
 		void main()
 		{
 			passColor = vertColor*overbrightbits;
 			passTexCoord = texCoord;
-			gl_Position = transProjView* transModel * vec4(position, 1.0);
+			vec4 worldCoord = transModel * vec4(position, 1.0);
+			passWorldCoord = worldCoord.xyz;
+			gl_Position = transProjView * worldCoord;
+		}
+);
+
+static const char* vertexSrcAliasLerp = MULTILINE_STRING(
+
+		// it gets attributes and uniforms from vertexCommon3D
+
+		// x, y, z, lightnormalindex of the current and the old frame (dtrivertx_t)
+		in vec4 frontVert; // GL3_ATTRIB_FRONTVERT
+		in vec4 backVert;  // GL3_ATTRIB_BACKVERT
+
+		// [0]: move, w: shell scale (POWERSUIT_SCALE or 0)
+		// [1]: frontv (frontlerp * frame scale), w: shadedots row (quantized yaw)
+		// [2]: backv (backlerp * oldframe scale), w: 1 to ignore shadedots (color only)
+		// [3]: shadelight, w: alpha
+		uniform vec4 aliasFrame[4];
+
+		// texel (normal index, shadedots row) is (normal, shadedot)
+		uniform highp sampler2D anormTable;
+
+		out vec4 passColor;
+		out vec3 passWorldCoord;
+
+		void main()
+		{
+			vec4 anorm = texelFetch(anormTable, ivec2(int(frontVert.w), int(aliasFrame[1].w)), 0);
+			float l = mix(anorm.w, 1.0, aliasFrame[2].w);
+
+			vec3 pos = aliasFrame[0].xyz + backVert.xyz * aliasFrame[2].xyz
+			           + frontVert.xyz * aliasFrame[1].xyz + anorm.xyz * aliasFrame[0].w;
+
+			passColor = vec4(l * aliasFrame[3].rgb, aliasFrame[3].a) * overbrightbits;
+			passTexCoord = texCoord;
+			vec4 worldCoord = transModel * vec4(pos, 1.0);
+			passWorldCoord = worldCoord.xyz;
+			gl_Position = transProjView * worldCoord;
 		}
 );
 
@@ -830,15 +904,19 @@ static const char* fragmentSrcAlias = MULTILINE_STRING(
 		uniform sampler2D tex;
 
 		in vec4 passColor;
+		in vec3 passWorldCoord;
 
 		void main()
 		{
 			vec4 texel = texture(tex, passTexCoord);
 
+			vec4 light = passColor;
+			light.rgb += calcModelDynLights(passWorldCoord) * overbrightbits;
+
 			// apply gamma correction and intensity
 			texel.rgb *= intensity;
 			texel.a *= alpha; // is alpha even used here?
-			texel *= min(vec4(1.5), passColor);
+			texel *= min(vec4(1.5), light);
 
 			outColor.rgb = pow(texel.rgb, vec3(gamma));
 			outColor.a = texel.a; // I think alpha shouldn't be modified by gamma and intensity
@@ -1053,6 +1131,7 @@ initShader3D(gl3ShaderInfo_t* shaderInfo, const char* vertSrc, const char* fragS
 	shaderInfo->shaderProgram = 0;
 	shaderInfo->uniLmScalesOrTime = -1;
 	shaderInfo->uniVblend = -1;
+	shaderInfo->uniAliasFrame = -1;
 
 	shaders3D[0] = CompileShader(GL_VERTEX_SHADER, vertexCommon3D, vertSrc);
 	if(shaders3D[0] == 0)  return false;
@@ -1139,6 +1218,26 @@ initShader3D(gl3ShaderInfo_t* shaderInfo, const char* vertSrc, const char* fragS
 		glUniform1i(texLoc, 0);
 	}
 
+	// the cluster lists for gl3_clusteredlights use GL_TEXTURE5 and GL_TEXTURE6
+	GLint clusterLoc = glGetUniformLocation(prog, "clusterGrid");
+	if(clusterLoc != -1)
+	{
+		glUniform1i(clusterLoc, 5);
+	}
+	clusterLoc = glGetUniformLocation(prog, "clusterIndices");
+	if(clusterLoc != -1)
+	{
+		glUniform1i(clusterLoc, 6);
+	}
+
+	// the normals and shadedots for lerping models in the shader are in GL_TEXTURE7
+	GLint anormLoc = glGetUniformLocation(prog, "anormTable");
+	if(anormLoc != -1)
+	{
+		glUniform1i(anormLoc, 7);
+	}
+	shaderInfo->uniAliasFrame = glGetUniformLocation(prog, "aliasFrame");
+
 	// ..  and the 4 lightmap texture use GL_TEXTURE1..4
 	char lmName[10] = "lightmapX";
 	for(i=0; i<4; ++i)
@@ -1318,6 +1417,16 @@ static qboolean createShaders(void)
 		Com_Printf("WARNING: Failed to create shader program for rendering flat-colored models!\n");
 		return false;
 	}
+	if(!initShader3D(&gl3state.si3DaliasLerp, vertexSrcAliasLerp, fragmentSrcAlias))
+	{
+		Com_Printf("WARNING: Failed to create shader program for rendering textured models lerped on the GPU!\n");
+		return false;
+	}
+	if(!initShader3D(&gl3state.si3DaliasLerpColor, vertexSrcAliasLerp, fragmentSrcAliasColor))
+	{
+		Com_Printf("WARNING: Failed to create shader program for rendering flat-colored models lerped on the GPU!\n");
+		return false;
+	}
 
 	const char* particleFrag = fragmentSrcParticles;
 	if(gl3_particle_square->value != 0.0f)
@@ -35,6 +35,35 @@ int c_visible_textures;
 static vec3_t modelorg; /* relative to viewpoint */
 static msurface_t *gl3_alpha_surfaces;
 
+/*
+ * Static world geometry: all opaque lightmapped surfaces of the world are
+ * put into one vertex and index buffer at map load, sorted into groups of
+ * surfaces with identical texture, lightmap, lightstyles and flowing.
+ * Each frame DrawTextureChains() only collects the index ranges of the
+ * visible surfaces per group, and DrawWorldGroups() draws each group with
+ * a single glMultiDrawElements().
+ */
+typedef struct
+{
+	mtexinfo_t *texinfo; // of the first surface, for R_TextureAnimation()
+	int lmtexnum;
+	byte styles[MAXLIGHTMAPS];
+	qboolean flowing;
+
+	int firstRange; // into worldRangeCounts and worldRangeOffsets
+	int numRanges;  // for visible surfaces in the current frame
+
+	// first and behind last index of the last range, for merging neighbouring surfaces
+	int lastFirstIndex, lastEndIndex;
+} gl3worldgroup_t;
+
+static GLuint worldVAO, worldVBO, worldEBO;
+static gl3worldgroup_t *worldGroups;
+static int numWorldGroups;
+static GLsizei *worldRangeCounts; // one range per surface at most
+static const void **worldRangeOffsets;
+static gl3drawCmd_t *worldDrawCmds; // one per group
+
 gl3lightmapstate_t gl3_lms;
 
 #define BACKFACE_EPSILON 0.01
@@ -42,6 +71,312 @@ gl3lightmapstate_t gl3_lms;
 extern gl3image_t gl3textures[MAX_GL3TEXTURES];
 extern int numgl3textures;
 
+// (re)sets the attribute pointers of the currently bound VAO for vertices
+// starting at offset base in the currently bound GL_ARRAY_BUFFER;
+// needed after each GL3_StreamData() because the data can be anywhere in the ring
+
+void GL3_VertexAttribs3D(GLintptr base)
+{
+	qglVertexAttribPointer(GL3_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(gl3_3D_vtx_t), base);
+	qglVertexAttribPointer(GL3_ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(gl3_3D_vtx_t), base + offsetof(gl3_3D_vtx_t, texCoord));
+	qglVertexAttribPointer(GL3_ATTRIB_LMTEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(gl3_3D_vtx_t), base + offsetof(gl3_3D_vtx_t, lmTexCoord));
+	qglVertexAttribPointer(GL3_ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, sizeof(gl3_3D_vtx_t), base + offsetof(gl3_3D_vtx_t, normal));
+	qglVertexAttribIPointer(GL3_ATTRIB_LIGHTFLAGS, 1, GL_UNSIGNED_INT, sizeof(gl3_3D_vtx_t), base + offsetof(gl3_3D_vtx_t, lightFlags));
+}
+
+void GL3_VertexAttribsAlias(GLintptr base)
+{
+	qglVertexAttribPointer(GL3_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 9*sizeof(GLfloat), base);
+	qglVertexAttribPointer(GL3_ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 9*sizeof(GLfloat), base + 3*sizeof(GLfloat));
+	qglVertexAttribPointer(GL3_ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, 9*sizeof(GLfloat), base + 5*sizeof(GLfloat));
+}
+
+void GL3_VertexAttribsParticle(GLintptr base)
+{
+	// same layout, but TEXCOORD is abused for (point_size, distance) here..
+	// TODO: maybe move point size and camera origin to UBO and calculate distance in vertex shader
+	GL3_VertexAttribsAlias(base);
+}
+
+static void
+FreeWorldBuffers(void)
+{
+	if (worldVAO != 0)
+	{
+		if (gl3state.currentVAO == worldVAO)
+		{
+			GL3_BindVAO(0);
+		}
+
+		if (gl3state.currentVBO == worldVBO)
+		{
+			GL3_BindVBO(0);
+		}
+
+		// the EBO binding belongs to the VAO, so it's gone with it
+		if (gl3state.currentEBO == worldEBO)
+		{
+			gl3state.currentEBO = 0;
+		}
+
+		glDeleteBuffers(1, &worldEBO);
+		glDeleteBuffers(1, &worldVBO);
+		glDeleteVertexArrays(1, &worldVAO);
+		worldVAO = worldVBO = worldEBO = 0;
+	}
+
+	free(worldGroups);
+	free(worldRangeCounts);
+	free(worldRangeOffsets);
+	free(worldDrawCmds);
+	worldGroups = NULL;
+	worldRangeCounts = NULL;
+	worldRangeOffsets = NULL;
+	worldDrawCmds = NULL;
+	numWorldGroups = 0;
+}
+
+static qboolean
+IsStaticWorldSurface(const msurface_t *surf)
+{
+	// the surfaces RenderBrushPoly() draws with a lightmap
+	return surf->polys != NULL && surf->polys->numverts >= 3
+		&& !(surf->flags & SURF_DRAWTURB)
+		&& !(surf->texinfo->flags & (SURF_SKY | SURF_TRANS33 | SURF_TRANS66 | SURF_WARP));
+}
+
+static int
+FindWorldGroup(const msurface_t *surf)
+{
+	qboolean flowing = (surf->texinfo->flags & SURF_FLOWING) != 0;
+	int i;
+
+	// neighbouring surfaces often share the group, so start at the last one
+	for (i = numWorldGroups - 1; i >= 0; i--)
+	{
+		const gl3worldgroup_t *g = &worldGroups[i];
+
+		if (g->texinfo->image == surf->texinfo->image
+			&& g->lmtexnum == surf->lightmaptexturenum
+			&& g->flowing == flowing
+			&& memcmp(g->styles, surf->styles, sizeof(g->styles)) == 0)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Builds the static world buffers for gl3_worldmodel,
+ * called when a map is loaded.
+ */
+void
+GL3_BuildWorldBuffers(void)
+{
+	msurface_t *surf, **sorted;
+	gl3_3D_vtx_t *verts;
+	GLuint *indices;
+	int i, j, numSurfs, numVerts, numIndices;
+
+	FreeWorldBuffers();
+
+	if (gl3_worldmodel == NULL || gl3_worldmodel->numsurfaces == 0)
+	{
+		return;
+	}
+
+	// worst case is one group per surface, shrunk below.
+	// while assigning groups, numRanges counts their surfaces
+	worldGroups = malloc(gl3_worldmodel->numsurfaces * sizeof(gl3worldgroup_t));
+	numSurfs = numVerts = numIndices = 0;
+
+	for (i = 0, surf = gl3_worldmodel->surfaces; i < gl3_worldmodel->numsurfaces; i++, surf++)
+	{
+		int g;
+
+		surf->worldGroup = -1;
+
+		if (!IsStaticWorldSurface(surf))
+		{
+			continue;
+		}
+
+		g = FindWorldGroup(surf);
+
+		if (g < 0)
+		{
+			gl3worldgroup_t *group = &worldGroups[numWorldGroups];
+
+			memset(group, 0, sizeof(*group));
+			group->texinfo = surf->texinfo;
+			group->lmtexnum = surf->lightmaptexturenum;
+			group->flowing = (surf->texinfo->flags & SURF_FLOWING) != 0;
+			memcpy(group->styles, surf->styles, sizeof(group->styles));
+
+			g = numWorldGroups++;
+		}
+
+		surf->worldGroup = g;
+		worldGroups[g].numRanges++;
+
+		numSurfs++;
+		numVerts += surf->polys->numverts;
+		numIndices += 3 * (surf->polys->numverts - 2);
+	}
+
+	if (numSurfs == 0)
+	{
+		FreeWorldBuffers();
+		return;
+	}
+
+	worldGroups = realloc(worldGroups, numWorldGroups * sizeof(gl3worldgroup_t));
+
+	// sort the surfaces by group, so the ones of a group are contiguous in the buffers
+	for (i = 0, j = 0; i < numWorldGroups; i++)
+	{
+		worldGroups[i].firstRange = j;
+		j += worldGroups[i].numRanges;
+		worldGroups[i].numRanges = 0;
+	}
+
+	sorted = malloc(numSurfs * sizeof(msurface_t *));
+
+	for (i = 0, surf = gl3_worldmodel->surfaces; i < gl3_worldmodel->numsurfaces; i++, surf++)
+	{
+		if (surf->worldGroup >= 0)
+		{
+			gl3worldgroup_t *g = &worldGroups[surf->worldGroup];
+
+			sorted[g->firstRange + g->numRanges] = surf;
+			g->numRanges++;
+		}
+	}
+
+	for (i = 0; i < numWorldGroups; i++)
+	{
+		worldGroups[i].numRanges = 0;
+	}
+
+	verts = malloc(numVerts * sizeof(gl3_3D_vtx_t));
+	indices = malloc(numIndices * sizeof(GLuint));
+	numVerts = numIndices = 0;
+
+	for (i = 0; i < numSurfs; i++)
+	{
+		glpoly_t *p;
+
+		surf = sorted[i];
+		p = surf->polys;
+
+		surf->worldFirstIndex = numIndices;
+		surf->worldNumIndices = 3 * (p->numverts - 2);
+
+		// triangle fan to triangles
+		for (j = 1; j < p->numverts - 1; j++)
+		{
+			indices[numIndices++] = numVerts;
+			indices[numIndices++] = numVerts + j;
+			indices[numIndices++] = numVerts + j + 1;
+		}
+
+		memcpy(&verts[numVerts], p->vertices, p->numverts * sizeof(gl3_3D_vtx_t));
+
+		// surfaces hit by dynamic lights are drawn through the batch
+		// (unless gl3_clusteredlights is on, which doesn't need the flags)
+		for (j = 0; j < p->numverts; j++)
+		{
+			verts[numVerts + j].lightFlags = 0;
+		}
+
+		numVerts += p->numverts;
+	}
+
+	glGenVertexArrays(1, &worldVAO);
+	GL3_BindVAO(worldVAO);
+
+	glGenBuffers(1, &worldVBO);
+	GL3_BindVBO(worldVBO);
+	glBufferData(GL_ARRAY_BUFFER, numVerts * sizeof(gl3_3D_vtx_t), verts, GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(GL3_ATTRIB_POSITION);
+	glEnableVertexAttribArray(GL3_ATTRIB_TEXCOORD);
+	glEnableVertexAttribArray(GL3_ATTRIB_LMTEXCOORD);
+	glEnableVertexAttribArray(GL3_ATTRIB_NORMAL);
+	glEnableVertexAttribArray(GL3_ATTRIB_LIGHTFLAGS);
+	GL3_VertexAttribs3D(0);
+
+	glGenBuffers(1, &worldEBO);
+	GL3_BindEBO(worldEBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(GLuint), indices, GL_STATIC_DRAW);
+
+	free(indices);
+	free(verts);
+	free(sorted);
+
+	worldRangeCounts = malloc(numSurfs * sizeof(GLsizei));
+	worldRangeOffsets = malloc(numSurfs * sizeof(void *));
+	worldDrawCmds = malloc(numWorldGroups * sizeof(gl3drawCmd_t));
+
+	R_Printf(PRINT_DEVELOPER, "%s: %d surfaces in %d groups, %d vertices, %d indices\n",
+			__func__, numSurfs, numWorldGroups, numVerts, numIndices);
+}
+
+/*
+ * Adds the surface to the ranges drawn by DrawWorldGroups(),
+ * returns false if it must be drawn through the batch instead.
+ */
+static qboolean
+AddWorldRange(const msurface_t *surf)
+{
+	gl3worldgroup_t *g;
+	int first, end, last;
+
+	if (surf->worldGroup < 0 || worldVAO == 0 || !gl3_staticworld->value)
+	{
+		return false;
+	}
+
+	// without gl3_clusteredlights dynamic lights need the lightFlags in the vertices
+	if (!gl3state.clusteredLights && surf->dlightframe == gl3_framecount && surf->dlightbits != 0)
+	{
+		return false;
+	}
+
+	g = &worldGroups[surf->worldGroup];
+	first = surf->worldFirstIndex;
+	end = first + surf->worldNumIndices;
+	last = g->firstRange + g->numRanges - 1;
+
+	c_brush_polys++;
+
+	if (g->numRanges > 0 && first == g->lastEndIndex)
+	{
+		worldRangeCounts[last] += surf->worldNumIndices;
+		g->lastEndIndex = end;
+	}
+	else if (g->numRanges > 0 && end == g->lastFirstIndex)
+	{
+		// texture chains are built back to front, so this is the common case
+		worldRangeCounts[last] += surf->worldNumIndices;
+		worldRangeOffsets[last] = (const void *)(first * sizeof(GLuint));
+		g->lastFirstIndex = first;
+	}
+	else
+	{
+		last++;
+		worldRangeCounts[last] = surf->worldNumIndices;
+		worldRangeOffsets[last] = (const void *)(first * sizeof(GLuint));
+		g->numRanges++;
+		g->lastFirstIndex = first;
+		g->lastEndIndex = end;
+	}
+
+	return true;
+}
+
 void GL3_SurfInit(void)
 {
 	// init the VAO and VBO for the standard vertexdata: 10 floats and 1 uint
@@ -50,25 +385,17 @@ void GL3_SurfInit(void)
 	glGenVertexArrays(1, &gl3state.vao3D);
 	GL3_BindVAO(gl3state.vao3D);
 
-	glGenBuffers(1, &gl3state.vbo3D);
-	GL3_BindVBO(gl3state.vbo3D);
+	GL3_InitStreamBuffer(&gl3state.vbo3D, GL_ARRAY_BUFFER, 4*1024*1024);
+	GL3_BindVBO(gl3state.vbo3D.buffer);
 
 	glEnableVertexAttribArray(GL3_ATTRIB_POSITION);
-	qglVertexAttribPointer(GL3_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(gl3_3D_vtx_t), 0);
-
 	glEnableVertexAttribArray(GL3_ATTRIB_TEXCOORD);
-	qglVertexAttribPointer(GL3_ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(gl3_3D_vtx_t), offsetof(gl3_3D_vtx_t, texCoord));
-
 	glEnableVertexAttribArray(GL3_ATTRIB_LMTEXCOORD);
-	qglVertexAttribPointer(GL3_ATTRIB_LMTEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(gl3_3D_vtx_t), offsetof(gl3_3D_vtx_t, lmTexCoord));
-
 	glEnableVertexAttribArray(GL3_ATTRIB_NORMAL);
-	qglVertexAttribPointer(GL3_ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, sizeof(gl3_3D_vtx_t), offsetof(gl3_3D_vtx_t, normal));
-
 	glEnableVertexAttribArray(GL3_ATTRIB_LIGHTFLAGS);
-	qglVertexAttribIPointer(GL3_ATTRIB_LIGHTFLAGS, 1, GL_UNSIGNED_INT, sizeof(gl3_3D_vtx_t), offsetof(gl3_3D_vtx_t, lightFlags));
+	GL3_VertexAttribs3D(0);
 
-	glGenBuffers(1, &gl3state.ebo3D);
+	GL3_InitStreamBuffer(&gl3state.ebo3D, GL_ELEMENT_ARRAY_BUFFER, 1024*1024);
 
 	// init VAO and VBO for model vertexdata: 9 floats
 	// (X,Y,Z), (S,T), (R,G,B,A)
@@ -76,19 +403,15 @@ void GL3_SurfInit(void)
 	glGenVertexArrays(1, &gl3state.vaoAlias);
 	GL3_BindVAO(gl3state.vaoAlias);
 
-	glGenBuffers(1, &gl3state.vboAlias);
-	GL3_BindVBO(gl3state.vboAlias);
+	GL3_InitStreamBuffer(&gl3state.vboAlias, GL_ARRAY_BUFFER, 2*1024*1024);
+	GL3_BindVBO(gl3state.vboAlias.buffer);
 
 	glEnableVertexAttribArray(GL3_ATTRIB_POSITION);
-	qglVertexAttribPointer(GL3_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 9*sizeof(GLfloat), 0);
-
 	glEnableVertexAttribArray(GL3_ATTRIB_TEXCOORD);
-	qglVertexAttribPointer(GL3_ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 9*sizeof(GLfloat), 3*sizeof(GLfloat));
-
 	glEnableVertexAttribArray(GL3_ATTRIB_COLOR);
-	qglVertexAttribPointer(GL3_ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, 9*sizeof(GLfloat), 5*sizeof(GLfloat));
+	GL3_VertexAttribsAlias(0);
 
-	glGenBuffers(1, &gl3state.eboAlias);
+	GL3_InitStreamBuffer(&gl3state.eboAlias, GL_ELEMENT_ARRAY_BUFFER, 512*1024);
 
 	// init VAO and VBO for particle vertexdata: 9 floats
 	// (X,Y,Z), (point_size,distace_to_camera), (R,G,B,A)
@@ -96,35 +419,32 @@ void GL3_SurfInit(void)
 	glGenVertexArrays(1, &gl3state.vaoParticle);
 	GL3_BindVAO(gl3state.vaoParticle);
 
-	glGenBuffers(1, &gl3state.vboParticle);
-	GL3_BindVBO(gl3state.vboParticle);
+	GL3_InitStreamBuffer(&gl3state.vboParticle, GL_ARRAY_BUFFER, 2*1024*1024);
+	GL3_BindVBO(gl3state.vboParticle.buffer);
 
 	glEnableVertexAttribArray(GL3_ATTRIB_POSITION);
-	qglVertexAttribPointer(GL3_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 9*sizeof(GLfloat), 0);
-
-	// TODO: maybe move point size and camera origin to UBO and calculate distance in vertex shader
-	glEnableVertexAttribArray(GL3_ATTRIB_TEXCOORD); // it's abused for (point_size, distance) here..
-	qglVertexAttribPointer(GL3_ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 9*sizeof(GLfloat), 3*sizeof(GLfloat));
-
+	glEnableVertexAttribArray(GL3_ATTRIB_TEXCOORD);
 	glEnableVertexAttribArray(GL3_ATTRIB_COLOR);
-	qglVertexAttribPointer(GL3_ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, 9*sizeof(GLfloat), 5*sizeof(GLfloat));
+	GL3_VertexAttribsParticle(0);
 }
 
 void GL3_SurfShutdown(void)
 {
-	glDeleteBuffers(1, &gl3state.ebo3D);
-	gl3state.ebo3D = 0;
-	glDeleteBuffers(1, &gl3state.vbo3D);
-	gl3state.vbo3D = 0;
+	GL3_ShutdownStreamBuffer(&gl3state.ebo3D);
+	GL3_ShutdownStreamBuffer(&gl3state.vbo3D);
 	glDeleteVertexArrays(1, &gl3state.vao3D);
 	gl3state.vao3D = 0;
 
-	glDeleteBuffers(1, &gl3state.eboAlias);
-	gl3state.eboAlias = 0;
-	glDeleteBuffers(1, &gl3state.vboAlias);
-	gl3state.vboAlias = 0;
+	GL3_ShutdownStreamBuffer(&gl3state.eboAlias);
+	GL3_ShutdownStreamBuffer(&gl3state.vboAlias);
 	glDeleteVertexArrays(1, &gl3state.vaoAlias);
 	gl3state.vaoAlias = 0;
+
+	GL3_ShutdownStreamBuffer(&gl3state.vboParticle);
+	glDeleteVertexArrays(1, &gl3state.vaoParticle);
+	gl3state.vaoParticle = 0;
+
+	FreeWorldBuffers();
 }
 
 static void
@@ -167,21 +487,27 @@ GL3_DrawGLPoly(msurface_t *fa, gl3drawCmd_t drawCmd)
 	GL3_Add3DdrawCmdToBatch(p->vertices, p->numverts, GL_TRIANGLE_FAN, drawCmd);
 }
 
+static float
+FlowingScroll(void)
+{
+	float scroll = -64.0f * ((r_newrefdef.time / 40.0f) - (int)(r_newrefdef.time / 40.0f));
+
+	if (scroll == 0.0f)
+	{
+		scroll = -64.0f;
+	}
+
+	return scroll;
+}
+
 void
 GL3_DrawGLFlowingPoly(msurface_t *fa, gl3drawCmd_t drawCmd)
 {
 	glpoly_t *p;
-	float scroll;
 
 	p = fa->polys;
 
-	scroll = -64.0f * ((r_newrefdef.time / 40.0f) - (int)(r_newrefdef.time / 40.0f));
-
-	if (scroll == 0.0f)
-	{
-		scroll = -64.0f;
-	}
-	drawCmd.scroll = scroll;
+	drawCmd.scroll = FlowingScroll();
 	drawCmd.flags |= DCFlag_UseScroll;
 
 	GL3_Add3DdrawCmdToBatch(p->vertices, p->numverts, GL_TRIANGLE_FAN, drawCmd);
@@ -209,7 +535,6 @@ DrawTriangleOutlines(void)
 	gl3state.uniCommonData.color = HMM_Vec4(1.0f, 1.0f, 1.0f, 1.0f);
 	GL3_UpdateUBOCommon();
 	GL3_BindVAO(gl3state.vao3D);
-	GL3_BindVBO(gl3state.vbo3D);
 
 	curr_vtx = 0;
 
@@ -233,7 +558,7 @@ DrawTriangleOutlines(void)
 
 				if (curr_vtx > (LINE_VTX_COUNT - 6))
 				{
-					glBufferData(GL_ARRAY_BUFFER, sizeof(vtx), vtx, GL_STREAM_DRAW);
+					GL3_VertexAttribs3D(GL3_StreamData(&gl3state.vbo3D, vtx, curr_vtx * sizeof(gl3_3D_vtx_t)));
 					glDrawArrays(GL_LINES, 0, curr_vtx);
 					curr_vtx = 0;
 					memset(vtx, 0, sizeof(vtx));
@@ -258,7 +583,7 @@ DrawTriangleOutlines(void)
 
 	if (curr_vtx)
 	{
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vtx), vtx, GL_STREAM_DRAW);
+		GL3_VertexAttribs3D(GL3_StreamData(&gl3state.vbo3D, vtx, curr_vtx * sizeof(gl3_3D_vtx_t)));
 		glDrawArrays(GL_LINES, 0, curr_vtx);
 	}
 
@@ -354,6 +679,55 @@ GL3_DrawAlphaSurfaces(void)
 	gl3_alpha_surfaces = NULL;
 }
 
+static void
+DrawWorldGroups(entity_t *currententity)
+{
+	int i, numCmds = 0;
+
+	for (i = 0; i < numWorldGroups; i++)
+	{
+		gl3worldgroup_t *g = &worldGroups[i];
+		gl3drawCmd_t *cmd;
+		gl3image_t *image;
+
+		if (g->numRanges == 0)
+		{
+			continue;
+		}
+
+		image = R_TextureAnimation(currententity, g->texinfo);
+
+		cmd = &worldDrawCmds[numCmds++];
+		*cmd = GL3_CreateDrawCmd();
+		cmd->texnum = image->texnum;
+		cmd->lmtexnum = g->lmtexnum;
+		memcpy(cmd->styles, g->styles, sizeof(cmd->styles));
+		cmd->flags |= DCFlag_UseLmStyles;
+
+		if (g->flowing)
+		{
+			GL3_SetDrawCmdShader(cmd, &gl3state.si3DlmFlow);
+			cmd->scroll = FlowingScroll();
+			cmd->flags |= DCFlag_UseScroll;
+		}
+		else
+		{
+			GL3_SetDrawCmdShader(cmd, &gl3state.si3Dlm);
+		}
+
+		cmd->idxBufOffset = g->firstRange;
+		cmd->numElements = g->numRanges;
+
+		g->numRanges = 0;
+	}
+
+	if (numCmds > 0)
+	{
+		GL3_BindVAO(worldVAO);
+		GL3_DrawStaticBatches(worldDrawCmds, numCmds, worldRangeCounts, worldRangeOffsets);
+	}
+}
+
 static void
 DrawTextureChains(entity_t *currententity)
 {
@@ -383,13 +757,18 @@ DrawTextureChains(entity_t *currententity)
 
 		for ( ; s; s = s->texturechain)
 		{
-			SetLightFlags(s);
-			RenderBrushPoly(currententity, s, drawCmd);
+			if (!AddWorldRange(s))
+			{
+				SetLightFlags(s);
+				RenderBrushPoly(currententity, s, drawCmd);
+			}
 		}
 
 		image->texturechain = NULL;
 	}
 
+	DrawWorldGroups(currententity);
+
 	// TODO: maybe one loop for normal faces and one for SURF_DRAWTURB ???
 }
 
@@ -432,10 +811,10 @@ DrawInlineBModel(entity_t *currententity, gl3model_t *currentmodel, gl3drawCmd_t
 	msurface_t *psurf;
 	dlight_t *lt;
 
-	/* calculate dynamic lighting for bmodel */
+	/* calculate dynamic lighting for bmodel, unless the shader does it */
 	lt = r_newrefdef.dlights;
 
-	for (k = 0; k < r_newrefdef.num_dlights; k++, lt++)
+	for (k = 0; !gl3state.clusteredLights && k < gl3state.uniLightsData.numDynLights; k++, lt++)
 	{
 		R_MarkLights(lt, 1 << k, currentmodel->nodes + currentmodel->firstnode,
 			r_dlightframecount, GL3_MarkSurfaceLights);
@@ -96,7 +96,9 @@ enum {
 	GL3_ATTRIB_LMTEXCOORD = 2, // for lightmap
 	GL3_ATTRIB_COLOR      = 3, // per-vertex color
 	GL3_ATTRIB_NORMAL     = 4, // vertex normal
-	GL3_ATTRIB_LIGHTFLAGS = 5  // uint, each set bit means "dyn light i affects this surface"
+	GL3_ATTRIB_LIGHTFLAGS = 5, // uint, each set bit means "dyn light i affects this surface"
+	GL3_ATTRIB_FRONTVERT  = 6, // dtrivertx_t of the current frame, for lerping models in the shader
+	GL3_ATTRIB_BACKVERT   = 7  // dtrivertx_t of the old frame
 };
 
 // always using RGBA now, GLES3 on RPi4 doesn't work otherwise
@@ -111,6 +113,7 @@ extern unsigned d_8to24table[256];
 
 // for stats
 extern int gl3_num3Ddraws, gl3_num2Ddraws, gl3_numBufferVtxData, gl3_numBufferUniforms;
+extern int gl3_numStreamedBytes, gl3_numStreamStalls;
 
 typedef struct
 {
@@ -126,6 +129,7 @@ typedef struct
 
 	qboolean anisotropic; // is GL_EXT_texture_filter_anisotropic supported?
 	qboolean debug_output; // is GL_ARB_debug_output supported?
+	qboolean buffer_storage; // is GL_ARB_buffer_storage supported? (=> persistently mapped stream buffers)
 	qboolean stencil; // Do we have a stencil buffer?
 
 	// ----
@@ -133,11 +137,29 @@ typedef struct
 	float max_anisotropy;
 } gl3config_t;
 
+enum {
+	GL3_STREAM_SEGMENTS = 4, // each stream buffer is split into that many fenced segments
+	GL3_STREAM_ALIGN = 16    // data in stream buffers starts at multiples of this
+};
+
+// a ring buffer that vertex/index data is streamed into, see gl3_buffer.c
+typedef struct
+{
+	GLuint buffer;
+	GLenum target; // GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER
+	GLsizeiptr size;
+	GLintptr offset; // where the next write goes
+	byte *mapped; // persistent mapping, NULL if gl3config.buffer_storage is false
+	GLsync fences[GL3_STREAM_SEGMENTS];
+	int segment; // segment that offset is in
+} gl3streambuf_t;
+
 typedef struct
 {
 	GLuint shaderProgram;
 	GLint uniVblend;
 	GLint uniLmScalesOrTime; // for 3D it's lmScales, for 2D underwater PP it's time
+	GLint uniAliasFrame; // vec4[4] with the lerp parameters for si3DaliasLerp*
 	hmm_vec4 lmScales[4];
 } gl3ShaderInfo_t;
 
@@ -184,18 +206,43 @@ typedef struct
 	GLfloat intensity;
 } gl3UniDynLight;
 
+enum {
+	// the uniLights UBO can hold this many lights; without gl3_clusteredlights
+	// only the first 32 are used, because lightFlags is a 32bit mask
+	GL3_MAX_DLIGHTS = 256,
+
+	// size of the froxel grid used by gl3_clusteredlights: X*Y screen tiles
+	// and Z exponentially distributed depth slices
+	GL3_CLUSTER_X = 16,
+	GL3_CLUSTER_Y = 8,
+	GL3_CLUSTER_Z = 24,
+	GL3_NUM_CLUSTERS = GL3_CLUSTER_X * GL3_CLUSTER_Y * GL3_CLUSTER_Z,
+
+	// the light index list is stored in a GL_R16UI texture of this width
+	GL3_CLUSTER_INDEX_WIDTH = 1024,
+	GL3_CLUSTER_INDEX_HEIGHT = 256,
+	GL3_MAX_CLUSTER_INDICES = GL3_CLUSTER_INDEX_WIDTH * GL3_CLUSTER_INDEX_HEIGHT
+};
+
 typedef struct
 {
-	gl3UniDynLight dynLights[MAX_DLIGHTS];
+	gl3UniDynLight dynLights[GL3_MAX_DLIGHTS];
 	GLuint numDynLights;
-	GLfloat _padding[3];
+	GLuint clusterDims[3]; // GL3_CLUSTER_X/Y/Z, or all 0 if clustered lights are disabled
+
+	hmm_mat4 clusterProjView; // projMat3D * viewMat3D of the main view, to find a fragment's cluster
+	GLfloat clusterZNear;
+	GLfloat clusterZScale; // GL3_CLUSTER_Z / log(zFar/zNear)
+	GLuint clusterIndexWidth; // GL3_CLUSTER_INDEX_WIDTH
+	GLfloat modulate; // r_modulate, for dynamic lights on models
 } gl3UniLights_t;
 
 enum {
 	// width and height used to be 128, so now we should be able to get the same lightmap data
-	// that used 32 lightmaps before into one, so 4 lightmaps should be enough
+	// that used 64 lightmaps before into one, so 4 lightmaps should be more than enough.
+	// the last page is shrunk to the rows actually used, see GL3_LM_EndBuildingLightmaps()
 	BLOCK_WIDTH = 1024,
-	BLOCK_HEIGHT = 512,
+	BLOCK_HEIGHT = 1024,
 	LIGHTMAP_BYTES = 4,
 	MAX_LIGHTMAPS = 4,
 	MAX_LIGHTMAPS_PER_SURFACE = MAXLIGHTMAPS // 4
@@ -253,13 +300,18 @@ typedef struct
 
 	gl3ShaderInfo_t si3Dalias;      // for models
 	gl3ShaderInfo_t si3DaliasColor; // for models w/ flat colors
+	gl3ShaderInfo_t si3DaliasLerp;      // for models with all frames in a VBO, lerped in the shader
+	gl3ShaderInfo_t si3DaliasLerpColor; // same w/ flat colors
 
 	// NOTE: make sure siParticle is always the last shaderInfo (or adapt GL3_ShutdownShaders())
 	gl3ShaderInfo_t siParticle; // for particles. surprising, right?
 
-	GLuint vao3D, vbo3D, ebo3D; // for brushes etc, using 10 floats and one uint as vertex input (x,y,z, s,t, lms,lmt, normX,normY,normZ ; lightFlags)
-	GLuint vaoAlias, vboAlias, eboAlias; // for models, using 9 floats as (x,y,z, s,t, r,g,b,a)
-	GLuint vaoParticle, vboParticle; // for particles, using 9 floats (x,y,z, size,distance, r,g,b,a)
+	GLuint vao3D, vaoAlias, vaoParticle;
+	GLuint vaoAliasLerp; // for models with their own buffers, attributes are set per draw
+	GLuint anormTex; // RGBA32F 256x16: (normal, shadedot) per normal index and yaw, bound to GL_TEXTURE7
+	gl3streambuf_t vbo3D, ebo3D; // for brushes etc, using 10 floats and one uint as vertex input (x,y,z, s,t, lms,lmt, normX,normY,normZ ; lightFlags)
+	gl3streambuf_t vboAlias, eboAlias; // for models, using 9 floats as (x,y,z, s,t, r,g,b,a)
+	gl3streambuf_t vboParticle; // for particles, using 9 floats (x,y,z, size,distance, r,g,b,a)
 
 	// UBOs and their data
 	gl3UniCommon_t uniCommonData;
@@ -271,6 +323,11 @@ typedef struct
 	GLuint uni3DUBO;
 	GLuint uniLightsUBO;
 
+	// for gl3_clusteredlights: (offset, count) per cluster and the light indices they refer to
+	GLuint clusterGridTex; // GL_RG32UI, GL3_CLUSTER_X * (GL3_CLUSTER_Y*GL3_CLUSTER_Z), bound to GL_TEXTURE5
+	GLuint clusterIndexTex; // GL_R16UI, GL3_CLUSTER_INDEX_WIDTH * GL3_CLUSTER_INDEX_HEIGHT, bound to GL_TEXTURE6
+	qboolean clusteredLights; // gl3_clusteredlights is used for the current frame
+
 	hmm_mat4 projMat3D;
 	hmm_mat4 viewMat3D;
 } gl3state_t;
@@ -395,13 +452,30 @@ enum {MAX_GL3TEXTURES = 1024};
 // include this down here so it can use gl3image_t
 #include "model.h"
 
+typedef struct
+{
+	int x, y, width;
+} gl3skylinenode_t;
+
 typedef struct
 {
 	int current_lightmap_texture; // index into gl3state.lightmap_textureIDs[]
 
 	//msurface_t *lightmap_surfaces[MAX_LIGHTMAPS]; - no more lightmap chains, lightmaps are rendered multitextured
 
-	int allocated[BLOCK_WIDTH];
+	// skyline of the current page: the top edge of the allocated area,
+	// as a list of horizontal segments ordered by x
+	gl3skylinenode_t skyline[BLOCK_WIDTH + 1];
+	int numSkylineNodes;
+
+	// part of lightmap_buffers written since the last upload
+	int dirtyMins[2], dirtyMaxs[2];
+
+	// height the textures of current_lightmap_texture are allocated with,
+	// 0 if they have no storage yet
+	int pageHeight;
+
+	gl3model_t *model; // the model lightmaps are built for
 
 	/* the lightmap texture data needs to be kept in
 	   main memory so texsubimage can update properly */
@@ -464,6 +538,7 @@ GL3_BindEBO(GLuint ebo)
 
 extern void GL3_Add3DdrawCmdToBatch(const gl3_3D_vtx_t* verts, int numVerts, GLenum drawMode, gl3drawCmd_t drawCmd);
 extern void GL3_Draw3DBatchesNow(void);
+extern void GL3_DrawStaticBatches(const gl3drawCmd_t* cmds, int numCmds, const GLsizei* counts, const void* const* offsets);
 extern void GL3_SetDrawCmdTransMatrix(gl3drawCmd_t* drawCmd, hmm_mat4 mat);
 
 extern void GL3_RotateUni3DforEntity(entity_t *e);
@@ -548,7 +623,10 @@ extern int r_dlightframecount;
 extern void GL3_MarkSurfaceLights(dlight_t *light, int bit, mnode_t *node,
 	int r_dlightframecount);
 extern void GL3_PushDlights(void);
-extern void GL3_LightPoint(entity_t *currententity, vec3_t p, vec3_t color);
+extern void GL3_InitLightClusters(void);
+extern void GL3_ShutdownLightClusters(void);
+extern void GL3_BuildLightClusters(void);
+extern void GL3_LightPoint(entity_t *currententity, vec3_t p, vec3_t color, qboolean addDlights);
 extern void GL3_BuildLightMap(msurface_t *surf, int offsetInLMbuf, int stride);
 
 // gl3_lightmap.c
@@ -572,9 +650,18 @@ extern void GL3_ClearSkyBox(void);
 extern void GL3_AddSkySurface(msurface_t *fa);
 
 
+// gl3_buffer.c
+extern void GL3_InitStreamBuffer(gl3streambuf_t *sb, GLenum target, GLsizeiptr size);
+extern void GL3_ShutdownStreamBuffer(gl3streambuf_t *sb);
+extern GLintptr GL3_StreamData(gl3streambuf_t *sb, const void *data, GLsizeiptr size);
+
 // gl3_surf.c
 extern void GL3_SurfInit(void);
 extern void GL3_SurfShutdown(void);
+extern void GL3_VertexAttribs3D(GLintptr base);
+extern void GL3_VertexAttribsAlias(GLintptr base);
+extern void GL3_VertexAttribsParticle(GLintptr base);
+extern void GL3_BuildWorldBuffers(void);
 extern void GL3_DrawGLPoly(msurface_t *fa, gl3drawCmd_t drawCmd);
 extern void GL3_DrawGLFlowingPoly(msurface_t *fa, gl3drawCmd_t drawCmd);
 extern void GL3_DrawTriangleOutlines(void);
@@ -587,7 +674,10 @@ extern void GL3_MarkLeaves(void);
 extern void GL3_DrawAliasModel(entity_t *e);
 extern void GL3_ResetShadowAliasModels(void);
 extern void GL3_DrawAliasShadows(void);
+extern void GL3_InitMeshes(void);
 extern void GL3_ShutdownMeshes(void);
+extern void GL3_BuildAliasBuffers(gl3model_t *mod);
+extern void GL3_FreeAliasBuffers(gl3model_t *mod);
 
 // gl3_shaders.c
 
@@ -640,6 +730,8 @@ extern cvar_t *gl3_overbrightbits;
 extern cvar_t *gl3_particle_fade_factor;
 extern cvar_t *gl3_particle_square;
 extern cvar_t *gl3_colorlight;
+extern cvar_t *gl3_clusteredlights;
+extern cvar_t *gl3_staticworld;
 extern cvar_t *gl_polyblend;
 
 extern cvar_t *r_modulate;
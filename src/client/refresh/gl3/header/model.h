@@ -86,6 +86,10 @@ typedef struct msurface_s
 	// I think cached_light is not used/needed anymore
 	//float cached_light[MAXLIGHTMAPS];       /* values currently used in lightmap */
 	byte *samples;                          /* [numstyles*surfsize] */
+
+	/* static world buffer, see GL3_BuildWorldBuffers() */
+	int worldGroup;                         /* -1 if not in the buffer */
+	int worldFirstIndex, worldNumIndices;
 } msurface_t;
 
 /* Whole model */
@@ -156,6 +160,10 @@ typedef struct model_s
 	int extradatasize;
 	void *extradata;
 
+	/* alias models: all frames in a VBO, see GL3_BuildAliasBuffers() */
+	GLuint aliasVBO, aliasEBO;
+	int aliasNumVerts, aliasNumIndices;
+
 	// submodules
 	vec3_t		origin;	// for sounds or lights
 } gl3model_t;
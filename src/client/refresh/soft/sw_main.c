@@ -1951,6 +1951,7 @@ GetRefAPI(refimport_t imp)
 
 	refexport.api_version = API_VERSION;
 	refexport.framework_version = version;
+	refexport.max_dlights = MAX_DLIGHTS;
 
 	refexport.BeginRegistration = RE_BeginRegistration;
 	refexport.RegisterModel = RE_RegisterModel;
@@ -27,7 +27,7 @@
 #ifndef CL_SOUND_LOCAL_H
 #define CL_SOUND_LOCAL_H
 
-#define MAX_CHANNELS 32
+#define MAX_CHANNELS 128
 #define MAX_RAW_SAMPLES 8192
 
 /*
@@ -62,6 +62,10 @@ typedef struct
 	int fade;
 	/* effect volume */
 	short volume;
+	/* streamed sounds: size and rate of
+	   the vorbis file held in data */
+	int streamsize;
+	int streamrate;
 	byte data[1];
 } sfxcache_t;
 
@@ -152,6 +156,25 @@ typedef struct
 	int dataofs; /* chunk starts this many bytes from file start */
 } wavinfo_t;
 
+/*
+ * Statistics of a sample, see
+ * S_LoadSound(). The first five
+ * fields are the lookup key.
+ */
+typedef struct
+{
+	unsigned hash;
+	int length; /* in bytes, 0 marks a free slot */
+	int rate;
+	int width;
+	int channels;
+	double volume;
+	int begin;
+	int end;
+	int attack;
+	int fade;
+} soundstats_t;
+
 /*
  * Type of active sound backend
  */
@@ -178,6 +201,8 @@ extern cvar_t* s_underwater_gain_hf;
 extern cvar_t* s_doppler;
 extern cvar_t* s_occlusion_strength;
 extern cvar_t* s_reverb_preset;
+extern cvar_t *s_streamthreshold;
+extern cvar_t *s_cachesize;
 
 /*
  * Globals
@@ -209,6 +234,15 @@ wavinfo_t GetWavinfo(char *name, byte *wav, int wavlength);
  */
 sfxcache_t *S_LoadSound(sfx_t *s);
 
+/*
+ * Index of sample statistics,
+ * persisted between sessions
+ */
+qboolean S_FindStats(soundstats_t *stats);
+void S_AddStats(const soundstats_t *stats);
+void S_LoadStatsIndex(void);
+void S_WriteStatsIndex(void);
+
 /*
  * Plays one sound sample
  */
@@ -263,6 +297,20 @@ qboolean SDL_Cache(sfx_t *sfx, wavinfo_t *info, byte *data, short volume,
 				 int begin_length, int  end_length,
 				 int attack_length, int fade_length);
 
+/*
+ * Caches a vorbis file which is
+ * decoded while it's played
+ */
+qboolean SDL_CacheStream(sfx_t *sfx, const byte *data, int size,
+		int rate, int frames);
+
+/*
+ * Stops decoding the given sfx,
+ * must be called before its cache
+ * is freed
+ */
+void SDL_StreamRelease(sfx_t *sfx);
+
 /*
  * Performs all sound calculations
  * for the SDL backendend and fills
@@ -45,4 +45,11 @@ void OGG_Stop(void);
 void OGG_Stream(void);
 void OGG_LoadAsWav(char *filename, wavinfo_t *info, void **buffer);
 
+/* Incremental mono decoding for streamed sounds */
+void *OGG_OpenDecoder(const byte *data, int size, int *rate, int *frames);
+int OGG_DecodeMono(void *decoder, short *buffer, int frames);
+void OGG_DecodeAsWav(void *decoder, const char *filename, wavinfo_t *info, void **buffer);
+qboolean OGG_SeekDecoder(void *decoder, int frame);
+void OGG_CloseDecoder(void *decoder);
+
 #endif
@@ -886,24 +886,17 @@ OGG_Shutdown(void)
 	ogg_started = false;
 }
 
+/*
+ * Decodes all of an opened vorbis file (see
+ * OGG_OpenDecoder()) to 16 bit wav data.
+ */
 void
-OGG_LoadAsWav(char *filename, wavinfo_t *info, void **buffer)
+OGG_DecodeAsWav(void *decoder, const char *filename, wavinfo_t *info, void **buffer)
 {
-	void * temp_buffer = NULL;
-	int size = FS_LoadFile(filename, &temp_buffer);
+	stb_vorbis *ogg2wav_file = decoder;
 	short *final_buffer = NULL;
-	stb_vorbis * ogg2wav_file = NULL;
-	int res = 0;
 
-	if (!temp_buffer)
-	{
-		/* no such file */
-		return;
-	}
-
-	/* load vorbis file from memory */
-	ogg2wav_file = stb_vorbis_open_memory(temp_buffer, size, &res, NULL);
-	if (!res && ogg2wav_file->channels > 0)
+	if (ogg2wav_file->channels > 0)
 	{
 		int read_samples = 0;
 
@@ -946,6 +939,28 @@ OGG_LoadAsWav(char *filename, wavinfo_t *info, void **buffer)
 		}
 
 	}
+}
+
+void
+OGG_LoadAsWav(char *filename, wavinfo_t *info, void **buffer)
+{
+	void * temp_buffer = NULL;
+	int size = FS_LoadFile(filename, &temp_buffer);
+	stb_vorbis * ogg2wav_file = NULL;
+	int res = 0;
+
+	if (!temp_buffer)
+	{
+		/* no such file */
+		return;
+	}
+
+	/* load vorbis file from memory */
+	ogg2wav_file = stb_vorbis_open_memory(temp_buffer, size, &res, NULL);
+	if (!res)
+	{
+		OGG_DecodeAsWav(ogg2wav_file, filename, info, buffer);
+	}
 
 	if (ogg2wav_file)
 	{
@@ -954,3 +969,60 @@ OGG_LoadAsWav(char *filename, wavinfo_t *info, void **buffer)
 
 	FS_FreeFile(temp_buffer);
 }
+
+/*
+ * Opens an in-memory vorbis file for incremental
+ * decoding. The data must stay valid until the
+ * decoder is closed. Not tied to the console or
+ * zone allocator, so decoders may be used from
+ * the sound backend's decoding thread.
+ */
+void *
+OGG_OpenDecoder(const byte *data, int size, int *rate, int *frames)
+{
+	stb_vorbis *decoder;
+	int res = 0;
+
+	decoder = stb_vorbis_open_memory(data, size, &res, NULL);
+
+	if (!decoder)
+	{
+		return NULL;
+	}
+
+	if (rate)
+	{
+		*rate = decoder->sample_rate;
+	}
+
+	if (frames)
+	{
+		*frames = stb_vorbis_stream_length_in_samples(decoder);
+	}
+
+	return decoder;
+}
+
+/*
+ * Decodes up to frames samples, downmixed to mono.
+ * Returns the number of samples decoded, 0 at the
+ * end of the file.
+ */
+int
+OGG_DecodeMono(void *decoder, short *buffer, int frames)
+{
+	return stb_vorbis_get_samples_short_interleaved(decoder, 1,
+		buffer, frames);
+}
+
+qboolean
+OGG_SeekDecoder(void *decoder, int frame)
+{
+	return stb_vorbis_seek(decoder, frame) != 0;
+}
+
+void
+OGG_CloseDecoder(void *decoder)
+{
+	stb_vorbis_close(decoder);
+}
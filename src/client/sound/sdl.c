@@ -42,6 +42,11 @@
 
 #include <errno.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2_MIXER
+#include <emmintrin.h>
+#endif
+
 /* Local includes */
 #include "../../client/header/client.h"
 #include "../../client/sound/header/local.h"
@@ -51,13 +56,42 @@
 #define SDL_FULLVOLUME 80
 #define SDL_LOOPATTENUATE 0.003
 
+#ifdef USE_SDL3
+typedef SDL_AtomicInt snd_atomic_t;
+#define SND_AtomicGet SDL_GetAtomicInt
+#define SND_AtomicSet SDL_SetAtomicInt
+#else
+typedef SDL_atomic_t snd_atomic_t;
+#define SND_AtomicGet SDL_AtomicGet
+#define SND_AtomicSet SDL_AtomicSet
+#endif
+
+#ifdef USE_SDL3
+typedef SDL_Mutex snd_mutex_t;
+typedef SDL_Semaphore snd_sem_t;
+#define SND_SemPost SDL_SignalSemaphore
+#define SND_SemWaitTimeout SDL_WaitSemaphoreTimeout
+#else
+typedef SDL_mutex snd_mutex_t;
+typedef SDL_sem snd_sem_t;
+#define SND_SemPost SDL_SemPost
+#define SND_SemWaitTimeout SDL_SemWaitTimeout
+#endif
+
+/* Streamed sounds */
+#define SDL_STREAM_SLOTS 16
+#define SDL_STREAM_RING 16384 /* in samples, must be a power of two */
+#define SDL_STREAM_CHUNK 2048 /* samples decoded in one go */
+
 /* Globals */
 static int *snd_p;
 static sound_t *backend;
 static portable_samplepair_t paintbuffer[SDL_PAINTBUFFER_SIZE];
 static int beginofs;
-static int playpos = 0;
 static int samplesize = 0;
+static int callbackframes = 0;
+static snd_atomic_t readpos; /* the callback's playback position, in samples */
+static snd_atomic_t paintedpos; /* the mixer's paintedtime, set after writing the buffer */
 static int snd_inited = 0;
 static int snd_scaletable[32][256];
 static int snd_vol;
@@ -228,8 +262,23 @@ SDL_TransferPaintBuffer(int endtime)
 			}
 
 			snd_linear_count <<= 1;
+			i = 0;
 
-			for (i = 0; i < snd_linear_count; i += 2)
+#ifdef USE_SSE2_MIXER
+			/* shift and saturate eight values at a time,
+			   packs does the clamping to 16 bit */
+			for ( ; i + 8 <= snd_linear_count; i += 8)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i *)(snd_p + i));
+				__m128i b = _mm_loadu_si128((const __m128i *)(snd_p + i + 4));
+
+				a = _mm_srai_epi32(a, 8);
+				b = _mm_srai_epi32(b, 8);
+				_mm_storeu_si128((__m128i *)(snd_out + i), _mm_packs_epi32(a, b));
+			}
+#endif
+
+			for ( ; i < snd_linear_count; i += 2)
 			{
 				val = snd_p[i] >> 8;
 
@@ -368,24 +417,63 @@ SDL_PaintChannelFrom8(channel_t *ch, sfxcache_t *sc, int count, int offset)
 	ch->pos += count;
 }
 
+#ifdef USE_SSE2_MIXER
+/*
+ * Mixes two samples, given as 16 bit values each
+ * followed by a zero, like (s0, 0, s0, 0, s1, 0, s1, 0),
+ * into two sample pairs of the paintbuffer.
+ */
+static inline void
+SDL_MixSamplePairs(portable_samplepair_t *samp, __m128i data,
+		__m128i volhi, __m128i vollo)
+{
+	__m128i hi = _mm_madd_epi16(data, volhi);
+	__m128i lo = _mm_srai_epi32(_mm_madd_epi16(data, vollo), 8);
+	__m128i out = _mm_loadu_si128((const __m128i *)samp);
+
+	_mm_storeu_si128((__m128i *)samp, _mm_add_epi32(out, _mm_add_epi32(hi, lo)));
+}
+#endif
+
 /*
  * Mixes an 16 bit sample into a channel
  */
 static void
-SDL_PaintChannelFrom16(channel_t *ch, sfxcache_t *sc, int count, int offset)
+SDL_PaintChannelFrom16(channel_t *ch, const signed short *sfx, int count, int offset)
 {
 	int leftvol, rightvol;
-	signed short *sfx;
-	int i;
+	int i = 0;
 	portable_samplepair_t *samp;
 
 	leftvol = ch->leftvol * snd_vol;
 	rightvol = ch->rightvol * snd_vol;
-	sfx = (signed short *)sc->data + ch->pos;
 
 	samp = &paintbuffer[offset];
 
-	for (i = 0; i < count; i++, samp++)
+#ifdef USE_SSE2_MIXER
+	/* (data * vol) >> 8 is the same as data * (vol >> 8) +
+	   ((data * (vol & 255)) >> 8), and with vol split like
+	   that both products fit pmaddwd's 16 bit operands. */
+	if (((leftvol >> 8) <= 0x7fff) && ((rightvol >> 8) <= 0x7fff))
+	{
+		const __m128i volhi = _mm_setr_epi16(leftvol >> 8, 0, rightvol >> 8, 0,
+				leftvol >> 8, 0, rightvol >> 8, 0);
+		const __m128i vollo = _mm_setr_epi16(leftvol & 255, 0, rightvol & 255, 0,
+				leftvol & 255, 0, rightvol & 255, 0);
+
+		for ( ; i + 4 <= count; i += 4, samp += 4)
+		{
+			__m128i data = _mm_loadl_epi64((const __m128i *)(sfx + i));
+
+			data = _mm_unpacklo_epi16(data, _mm_setzero_si128());
+
+			SDL_MixSamplePairs(samp, _mm_unpacklo_epi32(data, data), volhi, vollo);
+			SDL_MixSamplePairs(samp + 2, _mm_unpackhi_epi32(data, data), volhi, vollo);
+		}
+	}
+#endif
+
+	for ( ; i < count; i++, samp++)
 	{
 		int data;
 		int left, right;
@@ -400,6 +488,399 @@ SDL_PaintChannelFrom16(channel_t *ch, sfxcache_t *sc, int count, int offset)
 	ch->pos += count;
 }
 
+/* ------------------------------------------------------------------ */
+
+/*
+ * Big vorbis sounds (see S_StreamVorbis()) are decoded while they're
+ * played. A stream slot holds a ring of decoded and resampled samples
+ * for positions [readpos, end) of one sfx, a channel at any position
+ * inside that window is served from the slot. Channels elsewhere in
+ * the sound take over the least recently used slot, which is seeked
+ * there and gets its first chunk decoded right away. The decoding
+ * thread keeps the rings filled ahead of the mixer, if it falls
+ * behind the samples are skipped (played as silence).
+ *
+ * sfx, lastused and start belong to the main thread, readpos is
+ * written by the mixer and end by whoever decodes. The decoder
+ * state is protected by the slot's lock.
+ */
+typedef struct
+{
+	sfx_t *sfx;
+	int lastused;
+	int start;
+	snd_atomic_t readpos;
+	snd_atomic_t end;
+	snd_mutex_t *lock;
+
+	void *decoder;
+	const sfxcache_t *sc;
+	int step; /* source samples per output sample, 24.8 fixed point */
+	int srcbase; /* source position of src[0] */
+	int srccount;
+	qboolean eof;
+	short src[SDL_STREAM_CHUNK];
+	short ring[SDL_STREAM_RING];
+} sdlstream_t;
+
+static sdlstream_t *streams;
+static SDL_Thread *streamthread;
+static snd_sem_t *streamsem;
+static snd_atomic_t streamquit;
+static int streamunderruns;
+
+/*
+ * Decodes up to count samples at the end of the
+ * stream into the ring, resampled the same way
+ * SDL_Cache() does it. Called with the slot's
+ * lock held, returns the number of samples.
+ */
+static int
+SDL_StreamDecode(sdlstream_t *st, int count)
+{
+	int end = SND_AtomicGet(&st->end);
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		int pos = end + i;
+		int srcsample;
+
+		if (pos >= st->sc->length)
+		{
+			break;
+		}
+
+		srcsample = (int)(((long long)pos * st->step) >> 8);
+
+		while (srcsample >= st->srcbase + st->srccount)
+		{
+			if (st->eof)
+			{
+				break;
+			}
+
+			st->srcbase += st->srccount;
+			st->srccount = OGG_DecodeMono(st->decoder, st->src, SDL_STREAM_CHUNK);
+
+			if (st->srccount <= 0)
+			{
+				st->srccount = 0;
+				st->eof = true;
+			}
+		}
+
+		if ((srcsample < st->srcbase) || (srcsample >= st->srcbase + st->srccount))
+		{
+			break;
+		}
+
+		st->ring[pos & (SDL_STREAM_RING - 1)] = st->src[srcsample - st->srcbase];
+	}
+
+	SND_AtomicSet(&st->end, end + i);
+
+	return i;
+}
+
+/*
+ * Moves a slot to position pos of the given sound
+ * and decodes the first chunk. Called with the
+ * slot's lock held.
+ */
+static void
+SDL_StreamSeek(sdlstream_t *st, sfx_t *sfx, const sfxcache_t *sc, int pos)
+{
+	int srcsample;
+
+	if (st->sc != sc)
+	{
+		if (st->decoder)
+		{
+			OGG_CloseDecoder(st->decoder);
+		}
+
+		st->decoder = OGG_OpenDecoder(sc->data, sc->streamsize, NULL, NULL);
+		st->sc = sc;
+		st->step = (int)((float)sc->streamrate / sound.speed * 256);
+	}
+
+	srcsample = (int)(((long long)pos * st->step) >> 8);
+
+	st->sfx = sfx;
+	st->start = pos;
+	st->srcbase = srcsample;
+	st->srccount = 0;
+	st->eof = !st->decoder || !OGG_SeekDecoder(st->decoder, srcsample);
+
+	SND_AtomicSet(&st->readpos, pos);
+	SND_AtomicSet(&st->end, pos);
+
+	SDL_StreamDecode(st, SDL_STREAM_CHUNK);
+}
+
+/*
+ * Returns the slot holding pos of the given
+ * sound in its ring, or NULL.
+ */
+static sdlstream_t *
+SDL_StreamFind(const sfx_t *sfx, int pos)
+{
+	sdlstream_t *st;
+	int i;
+
+	for (i = 0, st = streams; i < SDL_STREAM_SLOTS; i++, st++)
+	{
+		int readpos;
+
+		if ((st->sfx != sfx) || (pos < st->start))
+		{
+			continue;
+		}
+
+		readpos = SND_AtomicGet(&st->readpos);
+
+		if ((pos >= readpos) && (pos < readpos + SDL_STREAM_RING))
+		{
+			return st;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Returns the decoded samples of a streamed sound
+ * at pos, count is lowered to what's available in
+ * one piece. NULL means the decoder fell behind.
+ */
+static const short *
+SDL_StreamSamples(sfx_t *sfx, const sfxcache_t *sc, int pos, int *count)
+{
+	sdlstream_t *st;
+	int end, i;
+
+	st = SDL_StreamFind(sfx, pos);
+
+	if (!st)
+	{
+		/* take over the least recently used slot */
+		st = streams;
+
+		for (i = 1; i < SDL_STREAM_SLOTS; i++)
+		{
+			if (streams[i].lastused < st->lastused)
+			{
+				st = &streams[i];
+			}
+		}
+
+		SDL_LockMutex(st->lock);
+		SDL_StreamSeek(st, sfx, sc, pos);
+		SDL_UnlockMutex(st->lock);
+	}
+
+	st->lastused = paintedtime;
+	end = SND_AtomicGet(&st->end);
+
+	if (pos >= end)
+	{
+		streamunderruns++;
+		return NULL;
+	}
+
+	/* the decoder may refill everything before pos now */
+	SND_AtomicSet(&st->readpos, pos);
+
+	if (*count > end - pos)
+	{
+		*count = end - pos;
+	}
+
+	if (*count > SDL_STREAM_RING - (pos & (SDL_STREAM_RING - 1)))
+	{
+		*count = SDL_STREAM_RING - (pos & (SDL_STREAM_RING - 1));
+	}
+
+	return &st->ring[pos & (SDL_STREAM_RING - 1)];
+}
+
+/*
+ * Mixes a streamed sound into a channel. count may
+ * be lowered if the ring doesn't hold that much.
+ */
+static void
+SDL_PaintChannelFromStream(channel_t *ch, sfxcache_t *sc, int *count, int offset)
+{
+	const short *samples;
+
+	samples = SDL_StreamSamples(ch->sfx, sc, ch->pos, count);
+
+	if (!samples)
+	{
+		/* skip what the decoder didn't deliver in time */
+		ch->pos += *count;
+		return;
+	}
+
+	SDL_PaintChannelFrom16(ch, samples, *count, offset);
+}
+
+/*
+ * Keeps the rings of all stream slots filled.
+ */
+static int
+SDL_StreamThread(void *data)
+{
+	while (!SND_AtomicGet(&streamquit))
+	{
+		int i;
+
+		for (i = 0; i < SDL_STREAM_SLOTS; i++)
+		{
+			sdlstream_t *st = &streams[i];
+			int decoded;
+
+			do
+			{
+				decoded = 0;
+
+				SDL_LockMutex(st->lock);
+
+				if (st->decoder &&
+					(SND_AtomicGet(&st->end) + SDL_STREAM_CHUNK <=
+					 SND_AtomicGet(&st->readpos) + SDL_STREAM_RING))
+				{
+					decoded = SDL_StreamDecode(st, SDL_STREAM_CHUNK);
+				}
+
+				SDL_UnlockMutex(st->lock);
+			}
+			while (decoded > 0);
+		}
+
+		SND_SemWaitTimeout(streamsem, 10);
+	}
+
+	return 0;
+}
+
+/*
+ * Stops the decoding thread and frees
+ * all stream slots.
+ */
+static void
+SDL_StreamShutdown(void)
+{
+	int i;
+
+	if (streamthread)
+	{
+		SND_AtomicSet(&streamquit, 1);
+		SND_SemPost(streamsem);
+		SDL_WaitThread(streamthread, NULL);
+		streamthread = NULL;
+	}
+
+	if (streamsem)
+	{
+		SDL_DestroySemaphore(streamsem);
+		streamsem = NULL;
+	}
+
+	if (!streams)
+	{
+		return;
+	}
+
+	for (i = 0; i < SDL_STREAM_SLOTS; i++)
+	{
+		if (streams[i].decoder)
+		{
+			OGG_CloseDecoder(streams[i].decoder);
+		}
+
+		if (streams[i].lock)
+		{
+			SDL_DestroyMutex(streams[i].lock);
+		}
+	}
+
+	free(streams);
+	streams = NULL;
+}
+
+/*
+ * Sets the stream slots up and starts
+ * the decoding thread. Without it big
+ * vorbis files are decoded on load.
+ */
+static void
+SDL_StreamInit(void)
+{
+	int i;
+
+	streams = calloc(SDL_STREAM_SLOTS, sizeof(sdlstream_t));
+
+	if (!streams)
+	{
+		return;
+	}
+
+	for (i = 0; i < SDL_STREAM_SLOTS; i++)
+	{
+		streams[i].lock = SDL_CreateMutex();
+	}
+
+	SND_AtomicSet(&streamquit, 0);
+	streamunderruns = 0;
+	streamsem = SDL_CreateSemaphore(0);
+
+	streamthread = SDL_CreateThread(SDL_StreamThread, "sound stream", NULL);
+
+	if (!streamsem || !streamthread)
+	{
+		Com_Printf("Couldn't start sound streaming: %s\n", SDL_GetError());
+		SDL_StreamShutdown();
+	}
+}
+
+void
+SDL_StreamRelease(sfx_t *sfx)
+{
+	int i;
+
+	if (!streams)
+	{
+		return;
+	}
+
+	for (i = 0; i < SDL_STREAM_SLOTS; i++)
+	{
+		sdlstream_t *st = &streams[i];
+
+		if (st->sfx != sfx)
+		{
+			continue;
+		}
+
+		SDL_LockMutex(st->lock);
+
+		if (st->decoder)
+		{
+			OGG_CloseDecoder(st->decoder);
+		}
+
+		st->decoder = NULL;
+		st->sc = NULL;
+		st->sfx = NULL;
+		st->lastused = 0;
+		SND_AtomicSet(&st->end, SND_AtomicGet(&st->readpos));
+
+		SDL_UnlockMutex(st->lock);
+	}
+}
+
 /*
  * Mixes all pending sounds into
  * the available output channels.
@@ -490,13 +971,18 @@ SDL_PaintChannels(int endtime)
 
 				if (count > 0)
 				{
-					if (sc->width == 1)
+					if (sc->streamsize)
+					{
+						SDL_PaintChannelFromStream(ch, sc, &count, ltime - paintedtime);
+					}
+					else if (sc->width == 1)
 					{
 						SDL_PaintChannelFrom8(ch, sc, count, ltime - paintedtime);
 					}
 					else
 					{
-						SDL_PaintChannelFrom16(ch, sc, count, ltime - paintedtime);
+						SDL_PaintChannelFrom16(ch, (signed short *)sc->data + ch->pos,
+							count, ltime - paintedtime);
 					}
 
 					ltime += count;
@@ -845,6 +1331,8 @@ SDL_ClearBuffer(void)
 			*ptr = clear;
 			ptr++;
 		}
+
+		SND_AtomicSet(&paintedpos, paintedtime);
 	}
 
 #ifndef USE_SDL3
@@ -862,6 +1350,7 @@ SDL_UpdateSoundtime(void)
 	static int buffers;
 	static int oldsamplepos;
 	int fullsamples;
+	int playpos = SND_AtomicGet(&readpos);
 
 	fullsamples = sound.samples / sound.channels;
 
@@ -917,6 +1406,55 @@ SDL_UpdateScaletable(void)
 	}
 }
 
+/*
+ * Caches a vorbis file for streaming,
+ * it's decoded to 16 bit mono at the
+ * output rate while played.
+ */
+qboolean
+SDL_CacheStream(sfx_t *sfx, const byte *data, int size, int rate, int frames)
+{
+	sfxcache_t *sc;
+	int len;
+
+	if (!streams)
+	{
+		return false;
+	}
+
+	len = (int)((float)frames * sound.speed / rate);
+
+	if (len <= 0)
+	{
+		return false;
+	}
+
+	sc = sfx->cache = Z_Malloc(size + sizeof(sfxcache_t));
+
+	if (!sc)
+	{
+		return false;
+	}
+
+	sc->length = len;
+	sc->loopstart = -1;
+	sc->speed = sound.speed;
+	sc->width = 2;
+	sc->stereo = 0;
+	/* no statistics, they'd need a full decode */
+	sc->volume = 0;
+	sc->begin = 0;
+	sc->end = 0;
+	sc->attack = 0;
+	sc->fade = 0;
+	sc->streamsize = size;
+	sc->streamrate = rate;
+
+	memcpy(sc->data, data, size);
+
+	return true;
+}
+
 /*
  * Saves a sound sample into cache. If
  * necessary endianess convertions are
@@ -1212,10 +1750,10 @@ SDL_Update(void)
 		return;
 	}
 
-	/* Mix the samples */
-#ifndef USE_SDL3
-	SDL_LockAudio();
-#endif
+	/* Mix the samples. The buffer is a single producer, single
+	   consumer ring: we only write ahead of the callback's read
+	   position, the callback publishes that position and we
+	   publish paintedpos after writing, so no lock is needed. */
 
 	/* Updates SDL time */
 	SDL_UpdateSoundtime();
@@ -1239,15 +1777,26 @@ SDL_Update(void)
 	endtime = (endtime + sound.submission_chunk - 1) & ~(sound.submission_chunk - 1);
 	samps = sound.samples >> (sound.channels - 1);
 
+	/* the callback may be copying out the chunk
+	   at the read position right now, keep off it */
+	samps -= callbackframes;
+
 	if (endtime - soundtime > samps)
 	{
 		endtime = soundtime + samps;
 	}
 
 	SDL_PaintChannels(endtime);
-#ifndef USE_SDL3
-	SDL_UnlockAudio();
-#endif
+
+	/* the atomic store orders the writes to the buffer
+	   before the callback's load of paintedpos */
+	SND_AtomicSet(&paintedpos, paintedtime);
+
+	/* let the decoder catch up with the mixer */
+	if (streamsem)
+	{
+		SND_SemPost(streamsem);
+	}
 }
 
 /* ------------------------------------------------------------------ */
@@ -1266,6 +1815,7 @@ SDL_SoundInfo(void)
 	Com_Printf("%5d submission_chunk\n", sound.submission_chunk);
 	Com_Printf("%5d speed\n", sound.speed);
 	Com_Printf("%p sound buffer\n", sound.buffer);
+	Com_Printf("%5d stream underruns\n", streamunderruns);
 }
 
 /*
@@ -1277,6 +1827,7 @@ SDL_Callback(void *data, Uint8 *stream, int length)
 {
 	int length1;
 	int length2;
+	int playpos = SND_AtomicGet(&readpos);
 	int pos = (playpos * (backend->samplebits / 8));
 
 	if (pos >= samplesize)
@@ -1291,6 +1842,10 @@ SDL_Callback(void *data, Uint8 *stream, int length)
 		return;
 	}
 
+	/* pairs with the store in SDL_Update(), the
+	   samples painted before it are visible now */
+	SND_AtomicGet(&paintedpos);
+
 	int tobufferend = samplesize - pos;
 
 	if (length > tobufferend)
@@ -1321,6 +1876,8 @@ SDL_Callback(void *data, Uint8 *stream, int length)
 	{
 		playpos = 0;
 	}
+
+	SND_AtomicSet(&readpos, playpos);
 }
 
 #ifdef USE_SDL3
@@ -1457,10 +2014,11 @@ SDL_BackendInit(void)
 	/* This points to the frontend */
 	backend = &sound;
 
-	playpos = 0;
+	SND_AtomicSet(&readpos, 0);
 	backend->samplebits = spec.format & 0xFF;
 	backend->channels = spec.channels;
 
+	callbackframes = samples;
 	tmp = (samples * spec.channels) * 10;
 
 	if (tmp & (tmp - 1))
@@ -1489,6 +2047,8 @@ SDL_BackendInit(void)
 
 	Com_Printf("SDL audio initialized.\n");
 
+	SDL_StreamInit();
+
 	soundtime = 0;
 	snd_inited = 1;
 
@@ -1502,12 +2062,14 @@ void
 SDL_BackendShutdown(void)
 {
 	Com_Printf("Closing SDL audio device...\n");
+	SDL_StreamShutdown();
 	SDL_PauseAudioDevice(SDL_GetAudioStreamDevice(stream));
 	SDL_DestroyAudioStream(stream);
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
 	free(backend->buffer);
 	backend->buffer = NULL;
-	playpos = samplesize = 0;
+	SND_AtomicSet(&readpos, 0);
+	samplesize = callbackframes = 0;
 	snd_inited = 0;
 	Com_Printf("SDL audio device shut down.\n");
 }
@@ -1621,10 +2183,11 @@ SDL_BackendInit(void)
 	/* This points to the frontend */
 	backend = &sound;
 
-	playpos = 0;
+	SND_AtomicSet(&readpos, 0);
 	backend->samplebits = spec.format & 0xFF;
 	backend->channels = spec.channels;
 
+	callbackframes = spec.samples;
 	tmp = (spec.samples * spec.channels) * 10;
 
 	if (tmp & (tmp - 1))
@@ -1653,6 +2216,8 @@ SDL_BackendInit(void)
 
 	Com_Printf("SDL audio initialized.\n");
 
+	SDL_StreamInit();
+
 	soundtime = 0;
 	snd_inited = 1;
 
@@ -1666,12 +2231,14 @@ void
 SDL_BackendShutdown(void)
 {
 	Com_Printf("Closing SDL audio device...\n");
+	SDL_StreamShutdown();
 	SDL_PauseAudio(1);
 	SDL_CloseAudio();
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
 	free(backend->buffer);
 	backend->buffer = NULL;
-	playpos = samplesize = 0;
+	SND_AtomicSet(&readpos, 0);
+	samplesize = callbackframes = 0;
 	snd_inited = 0;
 	Com_Printf("SDL audio device shut down.\n");
 }
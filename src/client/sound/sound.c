@@ -38,7 +38,7 @@
    because we don't want to free anything until we are
    sure we won't need it. */
 #define MAX_SFX (MAX_SOUNDS * 2)
-#define MAX_PLAYSOUNDS 128
+#define MAX_PLAYSOUNDS 256
 
 /* Maximum length (seconds) of audio data to test for silence. */
 #define S_MAX_LEN_TO_TEST_FOR_SILENCE_S (2)
@@ -74,6 +74,8 @@ cvar_t* s_underwater_gain_hf;
 cvar_t* s_doppler;
 cvar_t* s_occlusion_strength;
 cvar_t* s_reverb_preset;
+cvar_t *s_streamthreshold;
+cvar_t *s_cachesize;
 static cvar_t* s_ps_sorting;
 static cvar_t* s_feedback_kind;
 
@@ -120,7 +122,7 @@ S_IsShortSilence(const wavinfo_t* info, const void* raw_data)
 		/* Unsigned 8-bit audio data. */
 
 		const unsigned char* samples = (const unsigned char*)raw_data;
-		const int sample_count = info->samples * info->width;
+		const int sample_count = info->samples;
 
 		int i;
 
@@ -139,7 +141,7 @@ S_IsShortSilence(const wavinfo_t* info, const void* raw_data)
 		/* Signed 16-bit audio data. */
 
 		const short* samples = (const short*)raw_data;
-		const int sample_count = info->samples * info->width;
+		const int sample_count = info->samples;
 
 		int i;
 
@@ -163,7 +165,7 @@ S_IsShortSilence(const wavinfo_t* info, const void* raw_data)
 }
 
 static qboolean
-S_IsSilencedMuzzleFlash(const wavinfo_t* info, const void* raw_data, const char* name)
+S_IsSilencedMuzzleFlash(const char* name)
 {
 	/* Skip the prefix. */
 	static const size_t base_sound_string_length = 6; //strlen("sound/");
@@ -195,46 +197,38 @@ S_IsSilencedMuzzleFlash(const wavinfo_t* info, const void* raw_data, const char*
 		false
 	;
 
-	if (!is_name_matched)
-	{
-		return false;
-	}
-
-	/* Now check for silence. */
-	if (!S_IsShortSilence(info, raw_data))
-	{
-		return false;
-	}
-
-	return true;
+	return is_name_matched;
 }
 
-static void
-S_LoadVorbis(const char *path, wavinfo_t *info, void **buffer)
+/*
+ * Builds the name of the vorbis
+ * replacement of a sound file
+ */
+static qboolean
+S_VorbisFileName(const char *path, char *filename, size_t size)
 {
 	const char ogg_ext[] = ".ogg";
-	char filename[MAX_QPATH];
 	const char* ext;
 	int	len;
 
 	if (!path)
 	{
-		return;
+		return false;
 	}
 
 	ext = COM_FileExtension(path);
 	if (!ext[0])
 	{
 		/* file has no extension */
-		return;
+		return false;
 	}
 
 	/* Remove the extension */
 	len = (ext - path) - 1;
-	if ((len < 1) || (len > sizeof(filename) - 5))
+	if ((len < 1) || (len > size - 5))
 	{
 		Com_DPrintf("%s: Bad filename %s\n", __func__, path);
-		return;
+		return false;
 	}
 
 	/* copy base path */
@@ -243,9 +237,78 @@ S_LoadVorbis(const char *path, wavinfo_t *info, void **buffer)
 	/* Add the extension */
 	memcpy(filename + len, ogg_ext, sizeof(ogg_ext));
 
+	return true;
+}
+
+static void
+S_LoadVorbis(const char *path, wavinfo_t *info, void **buffer)
+{
+	char filename[MAX_QPATH];
+
+	if (!S_VorbisFileName(path, filename, sizeof(filename)))
+	{
+		return;
+	}
+
 	OGG_LoadAsWav(filename, info, buffer);
 }
 
+/*
+ * Vorbis files which would take more than
+ * s_streamthreshold KB once decoded aren't
+ * decoded on load, the SDL backend keeps
+ * the compressed file and decodes it while
+ * the sound plays. Smaller ones are decoded
+ * into info and buffer right away, so the
+ * file is read and opened only once.
+ */
+static sfxcache_t *
+S_StreamVorbis(sfx_t *s, const char *path, wavinfo_t *info, void **buffer)
+{
+	char filename[MAX_QPATH];
+	void *decoder;
+	byte *data;
+	int size, rate, frames;
+	qboolean streamed = false;
+
+	if ((s_streamthreshold->value <= 0) ||
+		!S_VorbisFileName(path, filename, sizeof(filename)))
+	{
+		return NULL;
+	}
+
+	size = FS_LoadFile(filename, (void **)&data);
+
+	if (!data)
+	{
+		return NULL;
+	}
+
+	decoder = OGG_OpenDecoder(data, size, &rate, &frames);
+
+	if (decoder)
+	{
+		/* size of the decoded and resampled sound */
+		if ((rate > 0) && (frames > 0) &&
+			((float)frames * sound.speed / rate * sizeof(short) >=
+				s_streamthreshold->value * 1024))
+		{
+			streamed = SDL_CacheStream(s, data, size, rate, frames);
+		}
+
+		if (!streamed)
+		{
+			OGG_DecodeAsWav(decoder, filename, info, buffer);
+		}
+
+		OGG_CloseDecoder(decoder);
+	}
+
+	FS_FreeFile(data);
+
+	return streamed ? s->cache : NULL;
+}
+
 static void
 S_GetVolume(const byte *data, int sound_length, int width, double *sound_volume)
 {
@@ -443,6 +506,7 @@ S_LoadSound(sfx_t *s)
 	char namebuffer[MAX_QPATH];
 	byte *data = NULL;
 	wavinfo_t info;
+	soundstats_t stats;
 	sfxcache_t *sc;
 	double sound_volume = 0;
 	int begin_length = 0;
@@ -484,7 +548,20 @@ S_LoadSound(sfx_t *s)
 		Com_sprintf(namebuffer, sizeof(namebuffer), "sound/%s", name);
 	}
 
-	S_LoadVorbis(namebuffer, &info, (void **)&data);
+	if (sound_started == SS_SDL)
+	{
+		sc = S_StreamVorbis(s, namebuffer, &info, (void **)&data);
+
+		if (sc)
+		{
+			return sc;
+		}
+	}
+
+	if (!data)
+	{
+		S_LoadVorbis(namebuffer, &info, (void **)&data);
+	}
 
 	// can't load ogg file
 	if (!data)
@@ -516,17 +593,38 @@ S_LoadSound(sfx_t *s)
 		return NULL;
 	}
 
-	if (S_IsSilencedMuzzleFlash(&info, data, namebuffer))
+	/* the statistics only depend on the samples,
+	   so they're looked up by their checksum */
+	memset(&stats, 0, sizeof(stats));
+	stats.length = info.samples * info.width;
+	stats.hash = Com_BlockChecksum(data + info.dataofs, stats.length);
+	stats.rate = info.rate;
+	stats.width = info.width;
+	stats.channels = info.channels;
+
+	if (!S_FindStats(&stats))
 	{
-		s->is_silenced_muzzle_flash = true;
+		S_GetVolume(data + info.dataofs, info.samples,
+			info.width, &stats.volume);
+
+		S_GetStatistics(data + info.dataofs, info.samples,
+			info.width, info.channels, stats.volume, &stats.begin, &stats.end,
+			&stats.attack, &stats.fade);
+
+		S_AddStats(&stats);
 	}
 
-	S_GetVolume(data + info.dataofs, info.samples,
-		info.width, &sound_volume);
+	if (S_IsSilencedMuzzleFlash(namebuffer) &&
+		S_IsShortSilence(&info, data + info.dataofs))
+	{
+		s->is_silenced_muzzle_flash = true;
+	}
 
-	S_GetStatistics(data + info.dataofs, info.samples,
-		info.width, info.channels, sound_volume, &begin_length, &end_length,
-		&attack_length, &fade_length);
+	sound_volume = stats.volume;
+	begin_length = stats.begin;
+	end_length = stats.end;
+	attack_length = stats.attack;
+	fade_length = stats.fade;
 
 #if USE_OPENAL
 	if (sound_started == SS_OAL)
@@ -838,6 +936,119 @@ S_HasFreeSpace(void)
 	return (num_sfx + used) < MAX_SFX;
 }
 
+/*
+ * Frees the cached samples of a sound,
+ * the sound itself stays registered
+ */
+static void
+S_FreeCache(sfx_t *sfx)
+{
+	if (!sfx->cache)
+	{
+		return;
+	}
+
+#if USE_OPENAL
+	if (sound_started == SS_OAL)
+	{
+		AL_DeleteSfx(sfx);
+	}
+#endif
+
+	if (sound_started == SS_SDL)
+	{
+		SDL_StreamRelease(sfx);
+	}
+
+	Z_Free(sfx->cache);
+	sfx->cache = NULL;
+}
+
+/*
+ * Frees a sound together with its cached
+ * samples, the slot can be reused
+ */
+static void
+S_ReleaseSfx(sfx_t *sfx)
+{
+	S_FreeCache(sfx);
+
+	if (sfx->truename)
+	{
+		Z_Free(sfx->truename);
+		sfx->truename = NULL;
+	}
+
+	sfx->name[0] = 0;
+}
+
+static int
+S_CacheSize(const sfxcache_t *sc)
+{
+	if (sc->streamsize)
+	{
+		return sc->streamsize;
+	}
+
+	return sc->length * sc->width * (sc->stereo + 1);
+}
+
+/*
+ * Sounds of earlier maps are kept for the next
+ * ones as long as everything cached fits into
+ * s_cachesize MB. The sounds unused for the
+ * most maps are released first.
+ */
+static void
+S_TrimCache(void)
+{
+	int i, total, budget;
+	sfx_t *sfx;
+
+	if (s_cachesize->value <= 0)
+	{
+		return;
+	}
+
+	budget = (int)(Q_min(s_cachesize->value, 2047) * 1024 * 1024);
+	total = 0;
+
+	for (i = 0, sfx = known_sfx; i < num_sfx; i++, sfx++)
+	{
+		if (sfx->name[0] && sfx->cache)
+		{
+			total += S_CacheSize(sfx->cache);
+		}
+	}
+
+	while (total > budget)
+	{
+		sfx_t *oldest = NULL;
+
+		for (i = 0, sfx = known_sfx; i < num_sfx; i++, sfx++)
+		{
+			if (!sfx->name[0] || !sfx->cache ||
+				(sfx->registration_sequence == s_registration_sequence))
+			{
+				continue;
+			}
+
+			if (!oldest || (sfx->registration_sequence < oldest->registration_sequence))
+			{
+				oldest = sfx;
+			}
+		}
+
+		if (!oldest)
+		{
+			break;
+		}
+
+		total -= S_CacheSize(oldest->cache);
+		S_ReleaseSfx(oldest);
+	}
+}
+
 /*
  * Called after registering of
  * sound has ended
@@ -860,27 +1071,19 @@ S_EndRegistration(void)
 
 			if (sfx->registration_sequence != s_registration_sequence)
 			{
-				/* it is possible to have a leftover */
-				if (sfx->cache)
-				{
-					Z_Free(sfx->cache); /* from a server that didn't finish loading */
-				}
-
-				if (sfx->truename)
-				{
-					Z_Free(sfx->truename);
-				}
-
-				sfx->cache = NULL;
-				sfx->name[0] = 0;
+				/* it is possible to have a leftover
+				   from a server that didn't finish loading */
+				S_ReleaseSfx(sfx);
 			}
 		}
 	}
 
-	/* load everything in */
+	/* load everything in, sounds of
+	   earlier maps are already cached */
 	for (i = 0, sfx = known_sfx; i < num_sfx; i++, sfx++)
 	{
-		if (!sfx->name[0])
+		if (!sfx->name[0] ||
+			(sfx->registration_sequence != s_registration_sequence))
 		{
 			continue;
 		}
@@ -888,6 +1091,9 @@ S_EndRegistration(void)
 		S_LoadSound(sfx);
 	}
 
+	S_TrimCache();
+	S_WriteStatsIndex();
+
 	s_registering = false;
 }
 
@@ -1541,11 +1747,12 @@ S_SoundList(void)
 	int i;
 	sfx_t *sfx;
 	sfxcache_t *sc;
-	int size, total, used;
+	int size, total, streamed, used;
 	int numsounds;
 	qboolean freeup;
 
 	total = 0;
+	streamed = 0;
 	used = 0;
 	numsounds = 0;
 
@@ -1563,7 +1770,16 @@ S_SoundList(void)
 
 		sc = sfx->cache;
 
-		if (sc)
+		if (sc && sc->streamsize)
+		{
+			/* only the vorbis file is resident */
+			streamed += sc->streamsize;
+			Com_Printf("S(%2db) %8i(%d ch) %s %.1fs streamed\n",
+					sc->width * 8, sc->streamsize,
+					(sc->stereo + 1), sfx->name,
+					(float)sc->length / sc->speed);
+		}
+		else if (sc)
 		{
 			size = sc->length * sc->width * (sc->stereo + 1);
 			total += size;
@@ -1595,6 +1811,8 @@ S_SoundList(void)
 
 	Com_Printf("Total resident: %i bytes (%.2f MB) in %d sounds\n", total,
 			(float)total / 1024 / 1024, numsounds);
+	Com_Printf("Total streamed: %i bytes (%.2f MB) of vorbis data\n", streamed,
+			(float)streamed / 1024 / 1024);
 	freeup = S_HasFreeSpace();
 	Com_Printf("Used %d of %d sounds%s.\n", used, sound_max, freeup ? ", has free space" : "");
 }
@@ -1673,6 +1891,10 @@ S_Init(void)
 	/* Reverb and occlusion is fully disabled by default */
 	s_reverb_preset = Cvar_Get("s_reverb_preset", "-1", CVAR_ARCHIVE);
 	s_occlusion_strength = Cvar_Get("s_occlusion_strength", "0", CVAR_ARCHIVE);
+	/* Vorbis files bigger than this (in KB, once decoded) are streamed */
+	s_streamthreshold = Cvar_Get("s_streamthreshold", "1024", CVAR_ARCHIVE);
+	/* Memory for sounds kept between maps, in MB */
+	s_cachesize = Cvar_Get("s_cachesize", "64", CVAR_ARCHIVE);
 	/* Feedback kind: 0 - rumble, 1 - haptic */
 	s_feedback_kind = Cvar_Get("s_feedback_kind", "0", CVAR_ARCHIVE);
 
@@ -1707,6 +1929,7 @@ S_Init(void)
 	sound_max = 0;
 	s_active = true;
 
+	S_LoadStatsIndex();
 	OGG_Init();
 
 	Com_Printf("Sound sampling rate: %i\n", sound.speed);
@@ -1741,17 +1964,7 @@ S_Shutdown(void)
 			continue;
 		}
 
-#if USE_OPENAL
-		if (sound_started == SS_OAL)
-		{
-			AL_DeleteSfx(sfx);
-		}
-#endif
-
-		if (sfx->cache)
-		{
-			Z_Free(sfx->cache);
-		}
+		S_FreeCache(sfx);
 
 		if (sfx->truename)
 		{
@@ -1762,6 +1975,8 @@ S_Shutdown(void)
 	memset(known_sfx, 0, sizeof(known_sfx));
 	num_sfx = 0;
 
+	S_WriteStatsIndex();
+
 #if USE_OPENAL
 	if (sound_started == SS_OAL)
 	{
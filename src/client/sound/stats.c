@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ *
+ * =======================================================================
+ *
+ * Index of the statistics S_LoadSound() calculates for each sample
+ * (volume, begin, attack, fade and end). They only depend on
+ * the sample data, so they're keyed by its checksum and kept in a small
+ * file next to the console history. That way they're calculated only
+ * once and not every time a sound is loaded again. The file is written
+ * field by field in little endian, so it doesn't depend on the struct
+ * layout of the build that wrote it.
+ *
+ * =======================================================================
+ */
+
+#include <stdint.h>
+
+#include "../header/client.h"
+#include "header/local.h"
+
+#define STATS_MAGIC (('S' << 24) + ('2' << 16) + ('Q' << 8) + 'Y')
+#define STATS_VERSION 3
+#define STATS_HASHSIZE 4096 /* must be a power of two */
+#define STATS_MAXCOUNT (STATS_HASHSIZE * 3 / 4)
+#define STATS_HEADERSIZE (3 * 4) /* magic, version, count */
+#define STATS_RECORDSIZE (9 * 4 + 8) /* 9 ints and the volume */
+
+static soundstats_t stats_table[STATS_HASHSIZE];
+static int stats_count;
+static qboolean stats_dirty;
+
+static void
+S_StatsPath(char *path, size_t size)
+{
+	if (is_portable)
+	{
+		Com_sprintf(path, size, "%ssound_stats.dat", Sys_GetBinaryDir());
+	}
+	else
+	{
+		Com_sprintf(path, size, "%ssound_stats.dat", Sys_GetHomeDir());
+	}
+}
+
+static soundstats_t *
+S_StatsSlot(const soundstats_t *key)
+{
+	int i;
+
+	i = key->hash & (STATS_HASHSIZE - 1);
+
+	/* there's always a free slot, see S_AddStats() */
+	while (stats_table[i].length)
+	{
+		const soundstats_t *s = &stats_table[i];
+
+		if ((s->hash == key->hash) && (s->length == key->length) &&
+			(s->rate == key->rate) && (s->width == key->width) &&
+			(s->channels == key->channels))
+		{
+			break;
+		}
+
+		i = (i + 1) & (STATS_HASHSIZE - 1);
+	}
+
+	return &stats_table[i];
+}
+
+static byte *
+S_PutInt(byte *p, unsigned v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = (v >> 24) & 0xff;
+
+	return p + 4;
+}
+
+static const byte *
+S_GetInt(const byte *p, unsigned *v)
+{
+	*v = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+
+	return p + 4;
+}
+
+/*
+ * The volume is stored as its IEEE 754 bits
+ */
+static byte *
+S_PutDouble(byte *p, double v)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &v, sizeof(bits));
+	p = S_PutInt(p, (unsigned)(bits & 0xffffffff));
+
+	return S_PutInt(p, (unsigned)(bits >> 32));
+}
+
+static const byte *
+S_GetDouble(const byte *p, double *v)
+{
+	unsigned lo, hi;
+	uint64_t bits;
+
+	p = S_GetInt(p, &lo);
+	p = S_GetInt(p, &hi);
+	bits = ((uint64_t)hi << 32) | lo;
+	memcpy(v, &bits, sizeof(*v));
+
+	return p;
+}
+
+static void
+S_PackStats(byte *p, const soundstats_t *s)
+{
+	p = S_PutInt(p, s->hash);
+	p = S_PutInt(p, s->length);
+	p = S_PutInt(p, s->rate);
+	p = S_PutInt(p, s->width);
+	p = S_PutInt(p, s->channels);
+	p = S_PutDouble(p, s->volume);
+	p = S_PutInt(p, s->begin);
+	p = S_PutInt(p, s->end);
+	p = S_PutInt(p, s->attack);
+	S_PutInt(p, s->fade);
+}
+
+static void
+S_UnpackStats(const byte *p, soundstats_t *s)
+{
+	unsigned v[9];
+
+	p = S_GetInt(p, &v[0]);
+	p = S_GetInt(p, &v[1]);
+	p = S_GetInt(p, &v[2]);
+	p = S_GetInt(p, &v[3]);
+	p = S_GetInt(p, &v[4]);
+	p = S_GetDouble(p, &s->volume);
+	p = S_GetInt(p, &v[5]);
+	p = S_GetInt(p, &v[6]);
+	p = S_GetInt(p, &v[7]);
+	S_GetInt(p, &v[8]);
+
+	s->hash = v[0];
+	s->length = (int)v[1];
+	s->rate = (int)v[2];
+	s->width = (int)v[3];
+	s->channels = (int)v[4];
+	s->begin = (int)v[5];
+	s->end = (int)v[6];
+	s->attack = (int)v[7];
+	s->fade = (int)v[8];
+}
+
+/*
+ * Looks the statistics of a sample up. The
+ * key fields of stats must be set, the others
+ * are filled in if true is returned.
+ */
+qboolean
+S_FindStats(soundstats_t *stats)
+{
+	const soundstats_t *s;
+
+	if (stats->length <= 0)
+	{
+		return false;
+	}
+
+	s = S_StatsSlot(stats);
+
+	if (!s->length)
+	{
+		return false;
+	}
+
+	*stats = *s;
+
+	return true;
+}
+
+void
+S_AddStats(const soundstats_t *stats)
+{
+	soundstats_t *s;
+
+	if (stats->length <= 0)
+	{
+		return;
+	}
+
+	if (stats_count >= STATS_MAXCOUNT)
+	{
+		/* lots of mods played, just start over */
+		memset(stats_table, 0, sizeof(stats_table));
+		stats_count = 0;
+	}
+
+	s = S_StatsSlot(stats);
+
+	if (!s->length)
+	{
+		stats_count++;
+	}
+
+	*s = *stats;
+	stats_dirty = true;
+}
+
+/*
+ * Reads the index written by a
+ * previous session, if any.
+ */
+void
+S_LoadStatsIndex(void)
+{
+	char path[MAX_OSPATH];
+	byte buffer[STATS_RECORDSIZE];
+	unsigned magic, version, count;
+	soundstats_t stats;
+	FILE *f;
+	unsigned i;
+
+	memset(stats_table, 0, sizeof(stats_table));
+	stats_count = 0;
+	stats_dirty = false;
+
+	S_StatsPath(path, sizeof(path));
+
+	f = Q_fopen(path, "rb");
+
+	if (!f)
+	{
+		return;
+	}
+
+	if (fread(buffer, STATS_HEADERSIZE, 1, f) != 1)
+	{
+		fclose(f);
+		return;
+	}
+
+	S_GetInt(S_GetInt(S_GetInt(buffer, &magic), &version), &count);
+
+	if ((magic != STATS_MAGIC) || (version != STATS_VERSION))
+	{
+		Com_DPrintf("%s: ignoring outdated %s\n", __func__, path);
+		fclose(f);
+		return;
+	}
+
+	for (i = 0; i < count && i < STATS_MAXCOUNT; i++)
+	{
+		if (fread(buffer, STATS_RECORDSIZE, 1, f) != 1)
+		{
+			break;
+		}
+
+		S_UnpackStats(buffer, &stats);
+		S_AddStats(&stats);
+	}
+
+	fclose(f);
+	stats_dirty = false;
+}
+
+/*
+ * Writes the index if new statistics
+ * were added since it was read.
+ */
+void
+S_WriteStatsIndex(void)
+{
+	char path[MAX_OSPATH];
+	byte buffer[STATS_RECORDSIZE];
+	FILE *f;
+	int i;
+
+	if (!stats_dirty)
+	{
+		return;
+	}
+
+	S_StatsPath(path, sizeof(path));
+
+	f = Q_fopen(path, "wb");
+
+	if (!f)
+	{
+		Com_DPrintf("%s: couldn't write %s\n", __func__, path);
+		return;
+	}
+
+	S_PutInt(S_PutInt(S_PutInt(buffer, STATS_MAGIC), STATS_VERSION), stats_count);
+	fwrite(buffer, STATS_HEADERSIZE, 1, f);
+
+	for (i = 0; i < STATS_HASHSIZE; i++)
+	{
+		if (stats_table[i].length)
+		{
+			S_PackStats(buffer, &stats_table[i]);
+			fwrite(buffer, STATS_RECORDSIZE, 1, f);
+		}
+	}
+
+	fclose(f);
+	stats_dirty = false;
+}
@@ -109,7 +109,7 @@ typedef struct {
 	int			num_entities;
 	entity_t	*entities;
 
-	int			num_dlights; // <= 32 (MAX_DLIGHTS)
+	int			num_dlights; // <= refexport_t.max_dlights
 	dlight_t	*dlights;
 
 	int			num_particles;
@@ -124,7 +124,7 @@ typedef enum {
 	RESTART_PARTIAL
 } ref_restart_t;
 
-#define	API_VERSION		8
+#define	API_VERSION		9
 #define EXPORT
 #define IMPORT
 
@@ -141,6 +141,10 @@ typedef struct
 	// mixed.
 	int		framework_version;
 
+	// the most dynamic lights RenderFrame() can handle,
+	// the client passes only the most relevant ones
+	int		max_dlights;
+
 	// called when the library is loaded
 	qboolean (EXPORT *Init) (void);
 
@@ -255,12 +255,12 @@ CM_WriteAreaBits(byte *buffer, int area)
 }
 
 /*
- * Writes the portal state to a savegame file
+ * Writes the portal state to a savegame buffer
  */
 void
-CM_WritePortalState(FILE *f)
+CM_WritePortalState(sizebuf_t *sb)
 {
-	fwrite(portalopen, sizeof(portalopen), 1, f);
+	SZ_Write(sb, portalopen, sizeof(portalopen));
 }
 
 /*
@@ -663,7 +663,7 @@ qboolean CM_AreasConnected(int area1, int area2);
 int CM_WriteAreaBits(byte *buffer, int area);
 qboolean CM_HeadnodeVisible(int headnode, const byte *visbits);
 
-void CM_WritePortalState(FILE *f);
+void CM_WritePortalState(sizebuf_t *sb);
 
 /* PLAYER MOVEMENT CODE */
 
@@ -835,6 +835,7 @@ void SCR_BeginLoadingPlaque(void);
 void SV_Init(void);
 void SV_Shutdown(char *finalmsg, qboolean reconnect);
 void SV_Frame(int usec);
+int SV_FlushSaveFiles(void);
 
 /* ======================================================================= */
 
@@ -860,6 +861,17 @@ void Sys_UnloadGame(void);
 void Sys_GetWorkDir(char *buffer, size_t len);
 qboolean Sys_SetWorkDir(char *path);
 qboolean Sys_Realpath(const char *in, char *out, size_t size);
+qboolean Sys_CopyFile(const char *from, const char *to);
+
+/* Threads for background work. The
+   thread functions must not call
+   into the rest of the engine. */
+void *Sys_CreateThread(void (*func)(void *), void *arg);
+void Sys_WaitThread(void *thread);
+void *Sys_CreateMutex(void);
+void Sys_DestroyMutex(void *mutex);
+void Sys_LockMutex(void *mutex);
+void Sys_UnlockMutex(void *mutex);
 
 // Windows only (system.c)
 #ifdef _WIN32
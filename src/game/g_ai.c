@@ -33,6 +33,36 @@ static qboolean enemy_infront;
 static int enemy_range;
 static float enemy_yaw;
 
+/*
+ * The results of visible() are cached for the current frame,
+ * monsters check the same client several times per frame
+ * (FindTarget(), ai_checkattack(), their own checkattack...).
+ * Entries are keyed by both entities and their eye points
+ * (in network precision), so anybody who moved traces again.
+ * Eye points not in each others PVS are rejected without
+ * a trace.
+ */
+#define SIGHT_CACHE_SIZE 1024 /* must be a power of two */
+
+typedef struct
+{
+	int framenum; /* level.framenum + 1, 0 is empty */
+	int self;
+	int other;
+	int spot1[3];
+	int spot2[3];
+	qboolean visible;
+} sightcache_t;
+
+static sightcache_t sight_cache[SIGHT_CACHE_SIZE];
+static int sight_checks, sight_cached, sight_culled;
+
+void
+AI_ResetSightCache(void)
+{
+	memset(sight_cache, 0, sizeof(sight_cache));
+}
+
 /*
  * Called once each frame to set level.sight_client
  * to the player to be checked for in findtarget.
@@ -47,6 +77,14 @@ AI_SetSightClient(void)
 	edict_t *ent;
 	int start, check;
 
+	if (g_showsight->value)
+	{
+		gi.dprintf("%4i sight checks  %4i cached  %4i pvs culled\n",
+				sight_checks, sight_cached, sight_culled);
+	}
+
+	sight_checks = sight_cached = sight_culled = 0;
+
 	if (level.sight_client == NULL)
 	{
 		start = 1;
@@ -338,6 +376,10 @@ visible(const edict_t *self, const edict_t *other)
 	vec3_t spot1;
 	vec3_t spot2;
 	trace_t trace;
+	sightcache_t *sc;
+	int key1[3], key2[3];
+	unsigned h;
+	int i;
 
 	if (!self || !other)
 	{
@@ -348,14 +390,47 @@ visible(const edict_t *self, const edict_t *other)
 	spot1[2] += self->viewheight;
 	VectorCopy(other->s.origin, spot2);
 	spot2[2] += other->viewheight;
-	trace = gi.trace(spot1, vec3_origin, vec3_origin, spot2, self, MASK_OPAQUE);
 
-	if (trace.fraction == 1.0)
+	sight_checks++;
+
+	h = (unsigned)(self - g_edicts) * 31 + (unsigned)(other - g_edicts);
+
+	for (i = 0; i < 3; i++)
 	{
-		return true;
+		key1[i] = (int)(spot1[i] * 8);
+		key2[i] = (int)(spot2[i] * 8);
+		h = h * 31 + (unsigned)key1[i];
+		h = h * 31 + (unsigned)key2[i];
 	}
 
-	return false;
+	h ^= h >> 16;
+	sc = &sight_cache[h & (SIGHT_CACHE_SIZE - 1)];
+
+	if ((sc->framenum == level.framenum + 1) &&
+		(sc->self == self - g_edicts) && (sc->other == other - g_edicts) &&
+		!memcmp(sc->spot1, key1, sizeof(key1)) && !memcmp(sc->spot2, key2, sizeof(key2)))
+	{
+		sight_cached++;
+		return sc->visible;
+	}
+
+	sc->framenum = level.framenum + 1;
+	sc->self = self - g_edicts;
+	sc->other = other - g_edicts;
+	VectorCopy(key1, sc->spot1);
+	VectorCopy(key2, sc->spot2);
+
+	if (!gi.inPVS(spot1, spot2))
+	{
+		sight_culled++;
+		sc->visible = false;
+		return false;
+	}
+
+	trace = gi.trace(spot1, vec3_origin, vec3_origin, spot2, self, MASK_OPAQUE);
+	sc->visible = (trace.fraction == 1.0);
+
+	return sc->visible;
 }
 
 /*
@@ -483,6 +558,7 @@ FoundTarget(edict_t *self)
 
 	/* clear the targetname, that point is ours! */
 	combatpoint->targetname = NULL;
+	G_UpdateFindIndex(combatpoint);
 	self->goalentity = self->movetarget = combatpoint;
 
 	/* run for it */
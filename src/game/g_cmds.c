@@ -359,6 +359,7 @@ Cmd_Give_f(edict_t *ent)
 		{
 			it_ent = G_Spawn();
 			it_ent->classname = it->classname;
+			G_UpdateFindIndex(it_ent);
 			SpawnItem(it_ent, it);
 			Touch_Item(it_ent, ent, NULL, NULL);
 
@@ -433,6 +434,7 @@ Cmd_Give_f(edict_t *ent)
 	{
 		it_ent = G_Spawn();
 		it_ent->classname = it->classname;
+		G_UpdateFindIndex(it_ent);
 		SpawnItem(it_ent, it);
 		Touch_Item(it_ent, ent, NULL, NULL);
 
@@ -1416,6 +1418,7 @@ Cmd_SpawnEntity_f(edict_t *ent)
 	}
 
 	ent->classname = G_CopyString(gi.argv(1));
+	G_UpdateFindIndex(ent);
 
 	ED_CallSpawn(ent);
 }
@@ -1431,6 +1434,7 @@ Cmd_SpawnOnStartByClass(const char *classname, const vec3_t origin)
 	opponent->s.origin[2] = origin[2];
 	// and class
 	opponent->classname = G_CopyString(classname);
+	G_UpdateFindIndex(opponent);
 
 	ED_CallSpawn(opponent);
 
@@ -540,6 +540,9 @@ T_Damage(edict_t *targ, edict_t *inflictor, edict_t *attacker, vec3_t dir,
 		return;
 	}
 
+	/* pain and die may change anything */
+	G_WakeEntity(targ);
+
 	/* friendly fire avoidance if enabled you
 	   can't hurt teammates (but you can hurt
 	   yourself) knockback still occurs */
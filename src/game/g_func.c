@@ -2139,6 +2139,7 @@ SP_func_water(edict_t *self)
 	}
 
 	self->classname = "func_door";
+	G_UpdateFindIndex(self);
 
 	gi.linkentity(self);
 }
@@ -3009,6 +3010,7 @@ SP_func_door_secret(edict_t *ent)
 	}
 
 	ent->classname = "func_door";
+	G_UpdateFindIndex(ent);
 
 	gi.linkentity(ent);
 }
@@ -1304,6 +1304,7 @@ Drop_Item(edict_t *ent, const gitem_t *item)
 	dropped = G_Spawn();
 
 	dropped->classname = item->classname;
+	G_UpdateFindIndex(dropped);
 	dropped->item = item;
 	dropped->spawnflags = DROPPED_ITEM;
 	dropped->s.effects = item->world_model_flags;
@@ -58,6 +58,8 @@ cvar_t *g_footsteps;
 cvar_t *g_monsterfootsteps;
 cvar_t *g_fix_triggered;
 cvar_t *g_commanderbody_nogod;
+cvar_t *g_sleepentities;
+cvar_t *g_showsight;
 
 cvar_t *filterban;
 
@@ -212,6 +214,7 @@ CreateTargetChangeLevel(char *map)
 
 	ent = G_Spawn();
 	ent->classname = "target_changelevel";
+	G_UpdateFindIndex(ent);
 	Com_sprintf(level.nextmap, sizeof(level.nextmap), "%s", map);
 	ent->map = level.nextmap;
 	return ent;
@@ -411,6 +414,222 @@ ExitLevel(void)
 	gibsthisframe = 0;
 }
 
+/*
+ * Sleeping entities. Lots of entities (path_corners,
+ * triggers, targets, info_*) don't move and think
+ * only seldom or never. Running them every frame does
+ * nothing but pull them into the cache, so they're
+ * put to sleep instead. G_RunFrame() skips sleepers
+ * without looking at them, pending thinks are kept in
+ * a min-heap and wake the entity when they're due.
+ * Entities are still run in entity number order, so
+ * the order of thinks doesn't change.
+ *
+ * Most changes to a sleeper come through one of its
+ * callbacks (use, touch, pain, die, blocked), those
+ * call G_WakeEntity() on it. So do G_InitEdict() and
+ * G_FreeEdict(). Changes to nextthink not made through
+ * a callback are caught when an older heap entry of
+ * the entity is due.
+ */
+typedef struct
+{
+	float time;
+	int num;
+} thinkevent_t;
+
+static byte *think_asleep;
+static thinkevent_t *think_heap;
+static int think_numheap;
+static int think_maxheap;
+
+/*
+ * Allocates the queue, called
+ * whenever g_edicts is allocated.
+ */
+void
+G_InitThinkQueue(void)
+{
+	think_maxheap = game.maxentities * 2;
+	think_heap = gi.TagMalloc(think_maxheap * sizeof(thinkevent_t), TAG_GAME);
+	think_asleep = gi.TagMalloc(game.maxentities, TAG_GAME);
+
+	G_ResetThinkQueue();
+}
+
+/*
+ * Wakes all entities, called after
+ * entities were spawned or loaded.
+ */
+void
+G_ResetThinkQueue(void)
+{
+	if (!think_asleep)
+	{
+		return;
+	}
+
+	memset(think_asleep, 0, game.maxentities);
+	think_numheap = 0;
+}
+
+void
+G_WakeEntity(const edict_t *ent)
+{
+	if (!think_asleep || !ent)
+	{
+		return;
+	}
+
+	think_asleep[ent - g_edicts] = false;
+}
+
+static void
+G_PushThink(float time, int num)
+{
+	int i;
+
+	i = think_numheap++;
+
+	while (i > 0)
+	{
+		int parent = (i - 1) / 2;
+
+		if (think_heap[parent].time <= time)
+		{
+			break;
+		}
+
+		think_heap[i] = think_heap[parent];
+		i = parent;
+	}
+
+	think_heap[i].time = time;
+	think_heap[i].num = num;
+}
+
+static void
+G_PopThink(void)
+{
+	thinkevent_t last;
+	int i, child;
+
+	last = think_heap[--think_numheap];
+	i = 0;
+
+	while ((child = i * 2 + 1) < think_numheap)
+	{
+		if ((child + 1 < think_numheap) &&
+			(think_heap[child + 1].time < think_heap[child].time))
+		{
+			child++;
+		}
+
+		if (last.time <= think_heap[child].time)
+		{
+			break;
+		}
+
+		think_heap[i] = think_heap[child];
+		i = child;
+	}
+
+	think_heap[i] = last;
+}
+
+/*
+ * Heap entries of entities woken in the meantime
+ * pile up, throw them away if the heap gets full.
+ */
+static void
+G_RebuildThinkQueue(void)
+{
+	int i;
+
+	think_numheap = 0;
+
+	for (i = 0; i < globals.num_edicts; i++)
+	{
+		if (think_asleep[i] && (g_edicts[i].nextthink > 0))
+		{
+			G_PushThink(g_edicts[i].nextthink, i);
+		}
+	}
+}
+
+/*
+ * Called after an entity was run, puts
+ * it to sleep if that's a no-op for now.
+ */
+static void
+G_CheckSleep(edict_t *ent)
+{
+	int num = ent - g_edicts;
+
+	if (!think_asleep || !g_sleepentities->value)
+	{
+		return;
+	}
+
+	/* freed entities sleep until G_Spawn() reuses them */
+	if (!ent->inuse)
+	{
+		think_asleep[num] = (num > maxclients->value);
+		return;
+	}
+
+	if ((num <= maxclients->value) ||
+		(ent->movetype != MOVETYPE_NONE) ||
+		ent->prethink || ent->groundentity ||
+		(ent->s.renderfx & RF_BEAM) ||
+		!VectorCompare(ent->s.origin, ent->s.old_origin))
+	{
+		return;
+	}
+
+	if (ent->nextthink > 0)
+	{
+		if (think_numheap == think_maxheap)
+		{
+			G_RebuildThinkQueue();
+
+			if (think_numheap == think_maxheap)
+			{
+				return;
+			}
+		}
+
+		G_PushThink(ent->nextthink, num);
+	}
+
+	think_asleep[num] = true;
+}
+
+/*
+ * Wakes the entities whose think is due this frame.
+ */
+static void
+G_WakeThinkers(void)
+{
+	if (!think_asleep)
+	{
+		return;
+	}
+
+	if (!g_sleepentities->value)
+	{
+		G_ResetThinkQueue();
+		return;
+	}
+
+	/* same check as in SV_RunThink() */
+	while (think_numheap && (think_heap[0].time <= level.time + 0.001))
+	{
+		think_asleep[think_heap[0].num] = false;
+		G_PopThink();
+	}
+}
+
 /*
  * Advances the world by 0.1 seconds
  */
@@ -426,6 +645,8 @@ G_RunFrame(void)
 	gibsthisframe = 0;
 	debristhisframe = 0;
 
+	G_WakeThinkers();
+
 	/* choose a client for monsters to target this frame */
 	AI_SetSightClient();
 
@@ -443,8 +664,14 @@ G_RunFrame(void)
 
 	for (i = 0; i < globals.num_edicts; i++, ent++)
 	{
+		if (think_asleep && think_asleep[i])
+		{
+			continue;
+		}
+
 		if (!ent->inuse)
 		{
+			G_CheckSleep(ent);
 			continue;
 		}
 
@@ -472,6 +699,7 @@ G_RunFrame(void)
 		}
 
 		G_RunEntity(ent);
+		G_CheckSleep(ent);
 	}
 
 	/* see if it is time to end a deathmatch */
@@ -276,6 +276,7 @@ ThrowHead(edict_t *self, const char *gibname, int damage, gibtype_t type)
 	self->svflags &= ~SVF_MONSTER;
 	self->takedamage = DAMAGE_YES;
 	self->targetname = NULL;
+	G_UpdateFindIndex(self);
 	self->die = gib_die;
 
 	// The entity still has the monsters clipmaks.
@@ -419,6 +420,7 @@ ThrowDebris(edict_t *self, char *modelname, float speed, vec3_t origin)
 	chunk->s.frame = 0;
 	chunk->flags = 0;
 	chunk->classname = "debris";
+	G_UpdateFindIndex(chunk);
 	chunk->takedamage = DAMAGE_YES;
 	chunk->die = debris_die;
 	chunk->health = 250;
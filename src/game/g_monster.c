@@ -504,6 +504,14 @@ M_SetEffects(edict_t *ent)
 	}
 }
 
+/*
+ * Advances a monster through its current mmove_t. The
+ * animation state stays in the edict: the monster code
+ * reads and writes monsterinfo.currentmove, nextframe
+ * and s.frame everywhere, the savegame tables serialize
+ * them from there, and the think has to run in the
+ * entity order of G_RunFrame() like everything else.
+ */
 void
 M_MoveFrame(edict_t *self)
 {
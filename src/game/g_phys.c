@@ -154,11 +154,13 @@ SV_Impact(edict_t *e1, trace_t *trace)
 
 	if (e1->touch && (e1->solid != SOLID_NOT))
 	{
+		G_WakeEntity(e1);
 		e1->touch(e1, e2, &trace->plane, trace->surface);
 	}
 
 	if (e2->touch && (e2->solid != SOLID_NOT))
 	{
+		G_WakeEntity(e2);
 		e2->touch(e2, e1, NULL, NULL);
 	}
 }
@@ -867,6 +869,7 @@ SV_Physics_Pusher(edict_t *ent)
 
 		if (part->blocked)
 		{
+			G_WakeEntity(part);
 			part->blocked(part, obstacle);
 		}
 	}
@@ -1292,6 +1295,13 @@ SV_Physics_Step(edict_t *ent)
 
 /* ================================================================== */
 
+/*
+ * Runs physics and think of one entity. The entities are
+ * run strictly one after another: moving one calls touch,
+ * blocked and think functions, relinks it into the area
+ * tree the traces of the next ones read, and may spawn or
+ * free entities, write network messages or call random().
+ */
 void
 G_RunEntity(edict_t *ent)
 {
@@ -37,6 +37,92 @@ static spawn_t spawns[] = {
 #include "savegame/tables/spawnfunc_list.h"
 };
 
+/*
+ * Items and spawn functions sorted by classname,
+ * so ED_CallSpawn() can do a binary search. Built
+ * on first use.
+ */
+typedef struct
+{
+	const char *name;
+	void (*spawn)(edict_t *ent);
+	gitem_t *item;
+	int order; /* the first one of the same name wins */
+} spawnindex_t;
+
+static spawnindex_t spawnindex[MAX_ITEMS + ARRLEN(spawns)];
+static int spawnindex_len;
+
+static int
+ED_SpawnIndexCmp(const void *a, const void *b)
+{
+	const spawnindex_t *sa = a;
+	const spawnindex_t *sb = b;
+	int r;
+
+	r = strcmp(sa->name, sb->name);
+
+	if (r)
+	{
+		return r;
+	}
+
+	return sa->order - sb->order;
+}
+
+static void
+ED_BuildSpawnIndex(void)
+{
+	const spawn_t *s;
+	int i, num;
+
+	num = 0;
+
+	/* items come first, like they always did */
+	for (i = 0; i < itemlist_len && i < MAX_ITEMS; i++)
+	{
+		if (itemlist[i].classname)
+		{
+			spawnindex[num].name = itemlist[i].classname;
+			spawnindex[num].spawn = NULL;
+			spawnindex[num].item = &itemlist[i];
+			spawnindex[num].order = num;
+			num++;
+		}
+	}
+
+	for (s = spawns; s->name; s++)
+	{
+		spawnindex[num].name = s->name;
+		spawnindex[num].spawn = s->spawn;
+		spawnindex[num].item = NULL;
+		spawnindex[num].order = num;
+		num++;
+	}
+
+	qsort(spawnindex, num, sizeof(spawnindex[0]), ED_SpawnIndexCmp);
+
+	/* drop shadowed duplicates */
+	spawnindex_len = 0;
+
+	for (i = 0; i < num; i++)
+	{
+		if (spawnindex_len &&
+			!strcmp(spawnindex[spawnindex_len - 1].name, spawnindex[i].name))
+		{
+			continue;
+		}
+
+		spawnindex[spawnindex_len++] = spawnindex[i];
+	}
+}
+
+static int
+ED_SpawnSearchCmp(const void *key, const void *entry)
+{
+	return strcmp(key, ((const spawnindex_t *)entry)->name);
+}
+
 /*
  * Finds the spawn function for
  * the entity and calls it
@@ -44,9 +130,7 @@ static spawn_t spawns[] = {
 void
 ED_CallSpawn(edict_t *ent)
 {
-	const spawn_t *s;
-	gitem_t *item;
-	int i;
+	const spawnindex_t *s;
 
 	if (!ent)
 	{
@@ -60,56 +144,53 @@ ED_CallSpawn(edict_t *ent)
 		return;
 	}
 
-	/* check item spawn functions */
-	for (i = 0, item = itemlist; i < itemlist_len; i++, item++)
+	if (!spawnindex_len)
 	{
-		if (!item->classname)
-		{
-			continue;
-		}
-
-		if (!strcmp(item->classname, ent->classname))
-		{
-			/* found it */
-			SpawnItem(ent, item);
-			return;
-		}
+		ED_BuildSpawnIndex();
 	}
 
-	/* check normal spawn functions */
-	for (s = spawns; s->name; s++)
+	s = bsearch(ent->classname, spawnindex, spawnindex_len,
+			sizeof(spawnindex[0]), ED_SpawnSearchCmp);
+
+	if (s)
 	{
-		if (!strcmp(s->name, ent->classname))
+		if (s->item)
+		{
+			SpawnItem(ent, s->item);
+		}
+		else
 		{
-			/* found it */
 			s->spawn(ent);
-			return;
 		}
+
+		return;
 	}
 
 	gi.dprintf("%s doesn't have a spawn function\n", ent->classname);
 }
 
-char *
-ED_NewString(const char *string)
+/*
+ * Copies the first len chars of string to
+ * level memory, resolving \n escapes.
+ */
+static char *
+ED_NewString(const char *string, size_t len)
 {
 	char *newb, *new_p;
-	size_t i, l;
+	size_t i;
 
 	if (!string)
 	{
 		return NULL;
 	}
 
-	l = strlen(string) + 1;
-
-	newb = gi.TagMalloc(l, TAG_LEVEL);
+	newb = gi.TagMalloc(len + 1, TAG_LEVEL);
 
 	new_p = newb;
 
-	for (i = 0; i < l; i++)
+	for (i = 0; i < len; i++)
 	{
-		if ((string[i] == '\\') && (i < l - 1))
+		if ((string[i] == '\\') && (i < len - 1))
 		{
 			i++;
 
@@ -128,47 +209,170 @@ ED_NewString(const char *string)
 		}
 	}
 
+	*new_p = 0;
+
 	return newb;
 }
 
+/*
+ * A token of the entity string. It points into
+ * the string and is not 0 terminated, so the
+ * map's entities are parsed without copying
+ * each key and value around.
+ */
+typedef struct
+{
+	const char *s;
+	size_t len;
+	qboolean quoted;
+} edtoken_t;
+
+/*
+ * Same rules as COM_Parse(). Returns false
+ * when the end of the string was reached.
+ */
+static qboolean
+ED_ParseToken(const char **data_p, edtoken_t *token)
+{
+	const char *data = *data_p;
+	int c;
+
+	token->s = "";
+	token->len = 0;
+	token->quoted = false;
+
+	if (!data)
+	{
+		return false;
+	}
+
+skipwhite:
+
+	while ((c = *data) <= ' ')
+	{
+		if (c == 0)
+		{
+			*data_p = NULL;
+			return false;
+		}
+
+		data++;
+	}
+
+	/* skip // comments */
+	if ((c == '/') && (data[1] == '/'))
+	{
+		while (*data && *data != '\n')
+		{
+			data++;
+		}
+
+		goto skipwhite;
+	}
+
+	if (c == '\"')
+	{
+		/* quoted string, the closing quote ends it */
+		token->s = ++data;
+		token->quoted = true;
+
+		while (*data && (*data != '\"'))
+		{
+			data++;
+		}
+
+		token->len = data - token->s;
+
+		if (*data)
+		{
+			data++;
+		}
+	}
+	else
+	{
+		/* regular word */
+		token->s = data;
+
+		while (*data > ' ')
+		{
+			data++;
+		}
+
+		token->len = data - token->s;
+	}
+
+	/* COM_Parse() drops overlong tokens */
+	if (token->len >= MAX_TOKEN_CHARS)
+	{
+		token->s = "";
+		token->len = 0;
+	}
+
+	*data_p = data;
+	return true;
+}
+
 /*
  * Takes a key/value pair and sets
  * the binary values in an edict
  */
 static void
-ED_ParseField(const char *key, const char *value, edict_t *ent)
+ED_ParseField(const edtoken_t *key, const edtoken_t *valuetok, edict_t *ent)
 {
+	char buf[MAX_TOKEN_CHARS];
+	const char *value;
 	const field_t *f;
 	void *b;
 	vec_t *vec;
 
-	if (!ent || !value || !key)
+	if (!ent || !valuetok || !key)
 	{
 		return;
 	}
 
-	f = FindSpawntempField(key);
+	f = FindSpawntempField(key->s, key->len);
 	if (f)
 	{
 		b = (byte *)&st + f->ofs;
 	}
 	else
 	{
-		f = FindSpawnfield(key);
+		f = FindSpawnfield(key->s, key->len);
 		if (!f)
 		{
-			gi.dprintf("'%s' is not a field. Value is '%s'\n", key, value);
+			gi.dprintf("'%.*s' is not a field. Value is '%.*s'\n",
+				(int)key->len, key->s, (int)valuetok->len, valuetok->s);
 			return;
 		}
 
 		b = (byte *)ent + f->ofs;
 	}
 
+	if (f->type == F_LSTRING)
+	{
+		*(char **)b = ED_NewString(valuetok->s, valuetok->len);
+
+		if ((b == &ent->classname) || (b == &ent->targetname))
+		{
+			G_UpdateFindIndex(ent);
+		}
+
+		return;
+	}
+
+	/* the closing quote stops the number parsers,
+	   only unquoted values need to be terminated */
+	value = valuetok->s;
+
+	if (!valuetok->quoted)
+	{
+		memcpy(buf, valuetok->s, valuetok->len);
+		buf[valuetok->len] = 0;
+		value = buf;
+	}
+
 	switch (f->type)
 	{
-		case F_LSTRING:
-			*(char **)b = ED_NewString(value);
-			break;
 		case F_VECTOR:
 			vec = b;
 			if (sscanf(value, "%f %f %f", &vec[0], &vec[1], &vec[2]) != 3)
@@ -202,8 +406,8 @@ ED_ParseField(const char *key, const char *value, edict_t *ent)
  * returning the new position. ed should be
  * a properly initialized empty edict.
  */
-static char *
-ED_ParseEdict(char *data, edict_t *ent)
+static const char *
+ED_ParseEdict(const char *data, edict_t *ent)
 {
 	qboolean init;
 
@@ -218,13 +422,12 @@ ED_ParseEdict(char *data, edict_t *ent)
 	/* go through all the dictionary pairs */
 	while (1)
 	{
-		const char *com_token;
-		char keyname[256];
+		edtoken_t key, value;
 
 		/* parse key */
-		com_token = COM_Parse(&data);
+		ED_ParseToken(&data, &key);
 
-		if (com_token[0] == '}')
+		if (key.len && (key.s[0] == '}'))
 		{
 			break;
 		}
@@ -235,10 +438,14 @@ ED_ParseEdict(char *data, edict_t *ent)
 			break;
 		}
 
-		Q_strlcpy(keyname, com_token, sizeof(keyname));
+		/* keys were always cut to 255 chars */
+		if (key.len > 255)
+		{
+			key.len = 255;
+		}
 
 		/* parse value */
-		com_token = COM_Parse(&data);
+		ED_ParseToken(&data, &value);
 
 		if (!data)
 		{
@@ -246,7 +453,7 @@ ED_ParseEdict(char *data, edict_t *ent)
 			break;
 		}
 
-		if (com_token[0] == '}')
+		if (value.len && (value.s[0] == '}'))
 		{
 			gi.error("%s: closing brace without data", __func__);
 			break;
@@ -257,12 +464,12 @@ ED_ParseEdict(char *data, edict_t *ent)
 		/* keynames with a leading underscore are
 		   used for utility comments, and are
 		   immediately discarded by quake */
-		if (keyname[0] == '_')
+		if (key.len && (key.s[0] == '_'))
 		{
 			continue;
 		}
 
-		ED_ParseField(keyname, com_token, ent);
+		ED_ParseField(&key, &value, ent);
 	}
 
 	if (!init)
@@ -351,7 +558,8 @@ SpawnEntities(const char *mapname, char *entities, const char *spawnpoint)
 {
 	edict_t *ent;
 	int inhibit;
-	const char *com_token;
+	edtoken_t token;
+	const char *data;
 	int i;
 	float skill_level;
 
@@ -383,6 +591,9 @@ SpawnEntities(const char *mapname, char *entities, const char *spawnpoint)
 
 	memset(&level, 0, sizeof(level));
 	memset(g_edicts, 0, game.maxentities * sizeof(g_edicts[0]));
+	G_ResetFindIndex();
+	G_ResetThinkQueue();
+	AI_ResetSightCache();
 
 	Q_strlcpy(level.mapname, mapname, sizeof(level.mapname));
 	Q_strlcpy(game.spawnpoint, spawnpoint, sizeof(game.spawnpoint));
@@ -395,21 +606,21 @@ SpawnEntities(const char *mapname, char *entities, const char *spawnpoint)
 
 	ent = NULL;
 	inhibit = 0;
+	data = entities;
 
 	/* parse ents */
 	while (1)
 	{
 		/* parse the opening brace */
-		com_token = COM_Parse(&entities);
-
-		if (!entities)
+		if (!ED_ParseToken(&data, &token))
 		{
 			break;
 		}
 
-		if (com_token[0] != '{')
+		if (!token.len || (token.s[0] != '{'))
 		{
-			gi.error("%s: found %s when expecting {", __func__, com_token);
+			gi.error("%s: found %.*s when expecting {", __func__,
+				(int)token.len, token.s);
 			break;
 		}
 
@@ -422,7 +633,7 @@ SpawnEntities(const char *mapname, char *entities, const char *spawnpoint)
 			ent = G_Spawn();
 		}
 
-		entities = ED_ParseEdict(entities, ent);
+		data = ED_ParseEdict(data, ent);
 
 		/* yet another map hack */
 		if (!Q_stricmp(level.mapname, "command") &&
@@ -642,6 +853,7 @@ SP_worldspawn(edict_t *ent)
 	ent->solid = SOLID_BSP;
 	ent->inuse = true; /* since the world doesn't use G_Spawn() */
 	ent->s.modelindex = 1; /* world model is always index 1 */
+	G_UpdateFindIndex(ent);
 
 	/* --------------- */
 
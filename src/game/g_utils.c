@@ -39,24 +39,238 @@ G_ProjectSource(const vec3_t point, const vec3_t distance, const vec3_t forward,
 }
 
 /*
- * Searches all active entities for the next
- * one that holds the matching string at fieldofs
- * (use the FOFS() macro) in the structure.
+ * Hash indexes for G_Find(). Lookups by classname and
+ * targetname are the common case, so each of those two
+ * fields gets an index mapping the (case insensitive)
+ * string to a chain of the in-use entities holding it.
+ * Chains are sorted by entity number, that way G_Find()
+ * keeps its "next entity after from" semantics.
  *
- * Searches beginning at the edict after from, or
- * the beginning. If NULL, NULL will be returned
- * if the end of the list is reached.
+ * Every place assigning classname or targetname calls
+ * G_UpdateFindIndex() afterwards, G_InitEdict() and
+ * G_FreeEdict() do it, too. The index remembers the
+ * pointer each entity was hashed under, so updating
+ * an entity whose keys didn't change is cheap. A bucket
+ * entry is always checked against the current string,
+ * so a stale entry can't produce a wrong match.
  */
-edict_t *
-G_Find(edict_t *from, int fieldofs, const char *match)
+#define FIND_HASHSIZE 1024 /* must be a power of two */
+
+typedef struct
 {
-	char *s;
+	int fieldofs;
+	int heads[FIND_HASHSIZE];
+	int *next;           /* -1 ends the chain */
+	int *prev;           /* -1 is the head */
+	const char **keys;   /* pointer the entity is hashed under */
+	unsigned short *buckets;
+} findindex_t;
+
+static findindex_t find_indexes[2];
+static int find_size;
+
+static unsigned
+G_FindHash(const char *s)
+{
+	unsigned hash = 0;
 
-	if (!match)
+	while (*s)
+	{
+		int c = *s++;
+
+		/* case insensitive, like Q_stricmp() */
+		if ((c >= 'A') && (c <= 'Z'))
+		{
+			c += ('a' - 'A');
+		}
+
+		hash = hash * 31 + c;
+	}
+
+	return (hash ^ (hash >> 10)) & (FIND_HASHSIZE - 1);
+}
+
+static findindex_t *
+G_FindIndexFor(int fieldofs)
+{
+	int i;
+
+	if (!find_size)
 	{
 		return NULL;
 	}
 
+	for (i = 0; i < ARRLEN(find_indexes); i++)
+	{
+		if (find_indexes[i].fieldofs == fieldofs)
+		{
+			return &find_indexes[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void
+G_FindUnlink(findindex_t *index, int e)
+{
+	int prev = index->prev[e];
+	int next = index->next[e];
+
+	if (prev >= 0)
+	{
+		index->next[prev] = next;
+	}
+	else
+	{
+		/* the string may be gone already, don't rehash it */
+		index->heads[index->buckets[e]] = next;
+	}
+
+	if (next >= 0)
+	{
+		index->prev[next] = prev;
+	}
+
+	index->keys[e] = NULL;
+}
+
+static void
+G_FindLink(findindex_t *index, int e, const char *key)
+{
+	int *link;
+	int prev = -1;
+
+	index->buckets[e] = G_FindHash(key);
+	link = &index->heads[index->buckets[e]];
+
+	while (*link >= 0 && *link < e)
+	{
+		prev = *link;
+		link = &index->next[*link];
+	}
+
+	index->next[e] = *link;
+	index->prev[e] = prev;
+
+	if (*link >= 0)
+	{
+		index->prev[*link] = e;
+	}
+
+	*link = e;
+	index->keys[e] = key;
+}
+
+static void
+G_FindUpdate(int e)
+{
+	const edict_t *ent = &g_edicts[e];
+	int i;
+
+	for (i = 0; i < ARRLEN(find_indexes); i++)
+	{
+		findindex_t *index = &find_indexes[i];
+		const char *key = NULL;
+
+		if (ent->inuse && e < globals.num_edicts)
+		{
+			key = *(char **)((byte *)ent + index->fieldofs);
+		}
+
+		if (key == index->keys[e])
+		{
+			continue;
+		}
+
+		if (index->keys[e])
+		{
+			G_FindUnlink(index, e);
+		}
+
+		if (key)
+		{
+			G_FindLink(index, e, key);
+		}
+	}
+}
+
+/*
+ * Allocates the indexes, called
+ * whenever g_edicts is allocated.
+ */
+void
+G_InitFindIndex(void)
+{
+	int i;
+
+	find_size = game.maxentities;
+
+	find_indexes[0].fieldofs = FOFS(classname);
+	find_indexes[1].fieldofs = FOFS(targetname);
+
+	for (i = 0; i < ARRLEN(find_indexes); i++)
+	{
+		findindex_t *index = &find_indexes[i];
+
+		index->next = gi.TagMalloc(find_size * sizeof(int), TAG_GAME);
+		index->prev = gi.TagMalloc(find_size * sizeof(int), TAG_GAME);
+		index->keys = gi.TagMalloc(find_size * sizeof(char *), TAG_GAME);
+		index->buckets = gi.TagMalloc(find_size * sizeof(unsigned short), TAG_GAME);
+	}
+
+	G_ResetFindIndex();
+}
+
+/*
+ * Rebuilds the indexes from scratch, called
+ * after entities were spawned or loaded.
+ */
+void
+G_ResetFindIndex(void)
+{
+	int i, e;
+
+	if (!find_size)
+	{
+		return;
+	}
+
+	for (i = 0; i < ARRLEN(find_indexes); i++)
+	{
+		findindex_t *index = &find_indexes[i];
+
+		memset(index->heads, -1, sizeof(index->heads));
+		memset(index->keys, 0, find_size * sizeof(char *));
+	}
+
+	/* walking backwards appends to the chain heads */
+	for (e = globals.num_edicts - 1; e >= 0; e--)
+	{
+		G_FindUpdate(e);
+	}
+}
+
+/*
+ * Rehashes the entity if its keys changed. Call
+ * this after changing the classname or targetname.
+ */
+void
+G_UpdateFindIndex(const edict_t *ent)
+{
+	if (!find_size || !ent)
+	{
+		return;
+	}
+
+	G_FindUpdate(ent - g_edicts);
+}
+
+static edict_t *
+G_FindLinear(edict_t *from, int fieldofs, const char *match)
+{
+	char *s;
+
 	if (!from)
 	{
 		from = g_edicts;
@@ -90,48 +304,136 @@ G_Find(edict_t *from, int fieldofs, const char *match)
 }
 
 /*
- * Returns entities that have origins
- * within a spherical area
+ * Searches all active entities for the next
+ * one that holds the matching string at fieldofs
+ * (use the FOFS() macro) in the structure.
+ *
+ * Searches beginning at the edict after from, or
+ * the beginning. If NULL, NULL will be returned
+ * if the end of the list is reached.
  */
 edict_t *
-findradius(edict_t *from, const vec3_t org, float rad)
+G_Find(edict_t *from, int fieldofs, const char *match)
 {
-	vec3_t eorg;
-	int j;
+	findindex_t *index;
+	const char *s;
+	int first, e;
 
-	if (!from)
+	if (!match)
 	{
-		from = g_edicts;
+		return NULL;
+	}
+
+	index = G_FindIndexFor(fieldofs);
+
+	if (!index)
+	{
+		return G_FindLinear(from, fieldofs, match);
+	}
+
+	first = from ? (from - g_edicts) + 1 : 0;
+
+	/* when iterating, continue in the chain of from */
+	s = from ? *(char **)((byte *)from + fieldofs) : NULL;
+
+	if (s && (s == index->keys[first - 1]) && !Q_stricmp(s, match))
+	{
+		e = index->next[first - 1];
 	}
 	else
 	{
-		from++;
+		e = index->heads[G_FindHash(match)];
 	}
 
-	for ( ; from < &g_edicts[globals.num_edicts]; from++)
+	for ( ; e >= 0; e = index->next[e])
 	{
-		if (!from->inuse)
+		const edict_t *ent = &g_edicts[e];
+
+		if (e < first || !ent->inuse)
 		{
 			continue;
 		}
 
-		if (from->solid == SOLID_NOT)
+		s = *(char **)((byte *)ent + fieldofs);
+
+		if (s && !Q_stricmp(s, match))
 		{
-			continue;
+			return &g_edicts[e];
+		}
+	}
+
+	return NULL;
+}
+
+static qboolean
+G_InRadius(const edict_t *ent, const vec3_t org, float rad)
+{
+	vec3_t eorg;
+	int j;
+
+	for (j = 0; j < 3; j++)
+	{
+		eorg[j] = org[j] - (ent->s.origin[j] +
+				   (ent->mins[j] + ent->maxs[j]) * 0.5);
+	}
+
+	return VectorLength(eorg) <= rad;
+}
+
+/*
+ * Returns entities that have origins
+ * within a spherical area. Only entities
+ * linked into the world are found, see
+ * RadiusEdicts in game_import_t.
+ */
+edict_t *
+findradius(edict_t *from, const vec3_t org, float rad)
+{
+	static edict_t *list[MAX_EDICTS];
+	static int count;
+	static vec3_t list_org;
+	static float list_rad;
+	int i, first;
+
+	/* the server's area tree gives the candidates, sorted by
+	   number. A search is continued in the cached list, unless
+	   a nested search for another sphere replaced it. */
+	if (!from || !VectorCompare(org, list_org) || (rad != list_rad))
+	{
+		count = gi.RadiusEdicts(org, rad, list, MAX_EDICTS);
+		VectorCopy(org, list_org);
+		list_rad = rad;
+	}
+
+	if (!from)
+	{
+		/* the world isn't linked into the area tree */
+		if (g_edicts->inuse && (g_edicts->solid != SOLID_NOT) &&
+			G_InRadius(g_edicts, org, rad))
+		{
+			return g_edicts;
 		}
+	}
+
+	first = from ? (from - g_edicts) + 1 : 0;
 
-		for (j = 0; j < 3; j++)
+	for (i = 0; i < count; i++)
+	{
+		edict_t *e = list[i];
+
+		if ((e - g_edicts) < first)
 		{
-			eorg[j] = org[j] - (from->s.origin[j] +
-					   (from->mins[j] + from->maxs[j]) * 0.5);
+			continue;
 		}
 
-		if (VectorLength(eorg) > rad)
+		/* may have been freed or moved while iterating */
+		if (!e->inuse || (e->solid == SOLID_NOT) ||
+			!G_InRadius(e, org, rad))
 		{
 			continue;
 		}
 
-		return from;
+		return e;
 	}
 
 	return NULL;
@@ -227,6 +529,7 @@ G_UseTargets(edict_t *ent, edict_t *activator)
 		/* create a temp object to fire at a later time */
 		t = G_Spawn();
 		t->classname = "DelayedUse";
+		G_UpdateFindIndex(t);
 		t->nextthink = level.time + ent->delay;
 		t->think = Think_Delay;
 		t->activator = activator;
@@ -315,6 +618,7 @@ G_UseTargets(edict_t *ent, edict_t *activator)
 			{
 				if (t->use)
 				{
+					G_WakeEntity(t);
 					t->use(t, ent, activator);
 				}
 			}
@@ -507,6 +811,9 @@ G_InitEdict(edict_t *e)
 	e->classname = "noclass";
 	e->gravity = 1.0;
 	e->s.number = e - g_edicts;
+
+	G_UpdateFindIndex(e);
+	G_WakeEntity(e);
 }
 
 /*
@@ -607,6 +914,9 @@ G_FreeEdict(edict_t *ed)
 	ed->classname = "freed";
 	ed->freetime = level.time;
 	ed->inuse = false;
+
+	G_UpdateFindIndex(ed);
+	G_WakeEntity(ed);
 }
 
 void
@@ -645,6 +955,7 @@ G_TouchTriggers(edict_t *ent)
 			continue;
 		}
 
+		G_WakeEntity(hit);
 		hit->touch(hit, ent, NULL, NULL);
 	}
 }
@@ -682,6 +993,7 @@ G_TouchSolids(edict_t *ent)
 
 		if (ent->touch)
 		{
+			G_WakeEntity(hit);
 			ent->touch(hit, ent, NULL, NULL);
 		}
 
@@ -485,6 +485,7 @@ fire_blaster(edict_t *self, vec3_t start, vec3_t dir, int damage,
 	bolt->think = G_FreeEdict;
 	bolt->dmg = damage;
 	bolt->classname = "bolt";
+	G_UpdateFindIndex(bolt);
 
 	if (hyper)
 	{
@@ -503,6 +504,7 @@ fire_blaster(edict_t *self, vec3_t start, vec3_t dir, int damage,
 	if (tr.fraction < 1.0)
 	{
 		VectorMA(bolt->s.origin, -10, dir, bolt->s.origin);
+		G_WakeEntity(tr.ent);
 		bolt->touch(bolt, tr.ent, NULL, NULL);
 	}
 }
@@ -679,6 +681,7 @@ fire_grenade(edict_t *self, vec3_t start, vec3_t aimdir, int damage, int speed,
 	grenade->dmg = damage;
 	grenade->dmg_radius = damage_radius;
 	grenade->classname = "grenade";
+	G_UpdateFindIndex(grenade);
 
 	gi.linkentity(grenade);
 }
@@ -719,6 +722,7 @@ fire_grenade2(edict_t *self, vec3_t start, vec3_t aimdir, int damage,
 	grenade->dmg = damage;
 	grenade->dmg_radius = damage_radius;
 	grenade->classname = "hgrenade";
+	G_UpdateFindIndex(grenade);
 
 	if (held)
 	{
@@ -858,6 +862,7 @@ fire_rocket(edict_t *self, vec3_t start, vec3_t dir, int damage,
 	rocket->dmg_radius = damage_radius;
 	rocket->s.sound = gi.soundindex("weapons/rockfly.wav");
 	rocket->classname = "rocket";
+	G_UpdateFindIndex(rocket);
 
 	if (self->client)
 	{
@@ -1215,6 +1220,7 @@ fire_bfg(edict_t *self, vec3_t start, vec3_t dir, int damage,
 	bfg->radius_dmg = damage;
 	bfg->dmg_radius = damage_radius;
 	bfg->classname = "bfg blast";
+	G_UpdateFindIndex(bfg);
 	bfg->s.sound = gi.soundindex("weapons/bfg__l1a.wav");
 
 	bfg->think = bfg_think;
@@ -34,7 +34,11 @@
  * !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
  */
 
-#define GAME_API_VERSION 3
+/* Version 4 appended RadiusEdicts and WriteSaveFile to game_import_t.
+   The server still loads version 3 games, they never look past the
+   original imports. A version 4 game is refused by older servers. */
+#define GAME_API_VERSION 4
+#define GAME_API_VERSION_ORIGINAL 3
 
 #define SVF_NOCLIENT 0x00000001 /* don't send entity to clients, even if it has effects */
 #define SVF_DEADMONSTER 0x00000002 /* treat as CONTENTS_DEADMONSTER for collision */
@@ -181,6 +185,21 @@ typedef struct
 	void (*AddCommandString)(const char *text);
 
 	void (*DebugGraph)(float value, int color);
+
+	/* everything from here on is GAME_API_VERSION 4 */
+
+	/* solid and trigger edicts whose bbox center is within radius
+	   of origin, sorted by edict number. Only edicts linked with
+	   linkentity() are found, tested at their bounds of the last
+	   linkentity() call. Unlike a scan over all edicts this misses
+	   unlinked ones and edicts moved without relinking. */
+	int (*RadiusEdicts)(const vec3_t origin, float radius, edict_t **list,
+			int maxcount);
+
+	/* hands a savegame file to the server, which writes it in
+	   the background. name is relative to the working directory,
+	   data is copied. Returns false if the file can't be written. */
+	qboolean (*WriteSaveFile)(const char *name, const void *data, size_t size);
 } game_import_t;
 
 /* functions exported by the game subsystem */
@@ -529,6 +529,8 @@ extern cvar_t *g_footsteps;
 extern cvar_t *g_monsterfootsteps;
 extern cvar_t *g_fix_triggered;
 extern cvar_t *g_commanderbody_nogod;
+extern cvar_t *g_sleepentities;
+extern cvar_t *g_showsight;
 
 extern cvar_t *filterban;
 
@@ -598,8 +600,8 @@ typedef struct
 	short save_ver;
 } field_t;
 
-const field_t *FindSpawnfield(const char *key);
-const field_t *FindSpawntempField(const char *key);
+const field_t *FindSpawnfield(const char *key, size_t len);
+const field_t *FindSpawntempField(const char *key, size_t len);
 
 extern gitem_t itemlist[];
 extern const int itemlist_len;
@@ -642,6 +644,9 @@ qboolean KillBox(edict_t *ent);
 void G_ProjectSource(const vec3_t point, const vec3_t distance, const vec3_t forward,
 		const vec3_t right, vec3_t result);
 edict_t *G_Find(edict_t *from, int fieldofs, const char *match);
+void G_InitFindIndex(void);
+void G_ResetFindIndex(void);
+void G_UpdateFindIndex(const edict_t *ent);
 edict_t *findradius(edict_t *from, const vec3_t org, float rad);
 edict_t *G_PickTarget(char *targetname);
 void G_UseTargets(edict_t *ent, edict_t *activator);
@@ -729,6 +734,7 @@ void BecomeExplosion1(edict_t *self);
 
 /* g_ai.c */
 void AI_SetSightClient(void);
+void AI_ResetSightCache(void);
 
 void ai_stand(edict_t *self, float dist);
 void ai_move(edict_t *self, float dist);
@@ -831,6 +837,9 @@ void G_RunEntity(edict_t *ent);
 
 /* g_main.c */
 void SaveClientData(void);
+void G_InitThinkQueue(void);
+void G_ResetThinkQueue(void);
+void G_WakeEntity(const edict_t *ent);
 
 /* g_chase.c */
 void UpdateChaseCam(edict_t *ent);
@@ -1262,6 +1262,7 @@ MakronToss(edict_t *self)
 
 	ent = G_Spawn();
 	ent->classname = "monster_makron";
+	G_UpdateFindIndex(ent);
 	ent->nextthink = level.time + 0.8;
 	ent->think = MakronSpawn;
 	ent->target = self->target;
@@ -829,6 +829,7 @@ SP_monster_flyer(edict_t *self)
 	if (!Q_stricmp(level.mapname, "jail5") && (self->s.origin[2] == -104))
 	{
 		self->targetname = self->target;
+		G_UpdateFindIndex(self);
 		self->target = NULL;
 	}
 
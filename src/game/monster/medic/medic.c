@@ -874,6 +874,7 @@ medic_cable_attack(edict_t *self)
 		self->enemy->monsterinfo.aiflags = 0;
 		self->enemy->target = NULL;
 		self->enemy->targetname = NULL;
+		G_UpdateFindIndex(self->enemy);
 		self->enemy->combattarget = NULL;
 		self->enemy->deathtarget = NULL;
 		self->enemy->owner = self;
@@ -74,6 +74,7 @@ SP_FixCoopSpots(edict_t *self)
 			if ((!self->targetname) || (Q_stricmp(self->targetname, spot->targetname) != 0))
 			{
 				self->targetname = spot->targetname;
+				G_UpdateFindIndex(self);
 			}
 
 			return;
@@ -105,6 +106,7 @@ SP_CreateCoopSpots(edict_t *self)
 		spot->s.origin[1] = -164;
 		spot->s.origin[2] = 80;
 		spot->targetname = "jail3";
+		G_UpdateFindIndex(spot);
 		spot->s.angles[1] = 90;
 
 		spot = G_Spawn();
@@ -113,6 +115,7 @@ SP_CreateCoopSpots(edict_t *self)
 		spot->s.origin[1] = -164;
 		spot->s.origin[2] = 80;
 		spot->targetname = "jail3";
+		G_UpdateFindIndex(spot);
 		spot->s.angles[1] = 90;
 
 		spot = G_Spawn();
@@ -121,6 +124,7 @@ SP_CreateCoopSpots(edict_t *self)
 		spot->s.origin[1] = -164;
 		spot->s.origin[2] = 80;
 		spot->targetname = "jail3";
+		G_UpdateFindIndex(spot);
 		spot->s.angles[1] = 90;
 
 		return;
@@ -159,6 +163,7 @@ CreateUnnamedSpawnpoint(const edict_t *self, const char *mapname, const char *sp
 	}
 
 	spot->classname = "info_player_start";
+	G_UpdateFindIndex(spot);
 
 	VectorCopy(self->s.origin, spot->s.origin);
 	spot->s.angles[1] = self->s.angles[1];
@@ -1315,6 +1320,7 @@ InitBodyQue(void)
 		{
 			ent = G_Spawn();
 			ent->classname = "bodyque";
+			G_UpdateFindIndex(ent);
 		}
 	}
 }
@@ -1364,6 +1370,7 @@ CopyToBodyQue(edict_t *ent)
 
 	gi.unlinkentity(ent);
 	gi.unlinkentity(body);
+	G_WakeEntity(body);
 	body->s = ent->s;
 	body->s.number = body - g_edicts;
 
@@ -1611,6 +1618,7 @@ PutClientInServer(edict_t *ent)
 	ent->viewheight = 22;
 	ent->inuse = true;
 	ent->classname = "player";
+	G_UpdateFindIndex(ent);
 	ent->mass = 200;
 	ent->solid = SOLID_BBOX;
 	ent->deadflag = DEAD_NO;
@@ -1795,6 +1803,7 @@ ClientBegin(edict_t *ent)
 		   ClientConnect() time */
 		G_InitEdict(ent);
 		ent->classname = "player";
+		G_UpdateFindIndex(ent);
 		InitClientResp(ent->client);
 		PutClientInServer(ent);
 	}
@@ -2033,6 +2042,7 @@ ClientDisconnect(edict_t *ent)
 	ent->solid = SOLID_NOT;
 	ent->inuse = false;
 	ent->classname = "disconnected";
+	G_UpdateFindIndex(ent);
 	ent->client->pers.connected = false;
 
 	playernum = ent - g_edicts - 1;
@@ -2260,6 +2270,7 @@ ClientThink(edict_t *ent, usercmd_t *ucmd)
 				continue;
 			}
 
+			G_WakeEntity(other);
 			other->touch(other, ent, NULL, NULL);
 		}
 	}
@@ -58,6 +58,7 @@ PlayerTrail_Init(void)
 	{
 		trail[n] = G_Spawn();
 		trail[n]->classname = "player_trail";
+		G_UpdateFindIndex(trail[n]);
 	}
 
 	trail_head = 0;
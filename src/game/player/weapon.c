@@ -111,6 +111,7 @@ PlayerNoise_Spawn(edict_t *who, int type)
 	}
 
 	noise->classname = "player_noise";
+	G_UpdateFindIndex(noise);
 	noise->spawnflags = type;
 	VectorSet (noise->mins, -8, -8, -8);
 	VectorSet (noise->maxs, 8, 8, 8);
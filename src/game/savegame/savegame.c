@@ -239,58 +239,291 @@ static const structdef_t sd_game =
 
 /* ========================================================= */
 
+/*
+ * Savegames are serialized to and parsed from memory.
+ * The file is read in one go when it's opened and
+ * handed to the server when it's closed, which writes
+ * it in the background. That's instead of doing a
+ * tiny fread() / fwrite() for every field.
+ */
+typedef struct
+{
+	char name[MAX_OSPATH];
+	qboolean writing;
+	byte *data;
+	size_t size;    /* bytes written / in the file */
+	size_t maxsize; /* bytes allocated */
+	size_t pos;     /* read position */
+} sgfile_t;
+
+#define SG_BUFFER_SIZE (256 * 1024)
+
+static sgfile_t *
+sg_fopen(const char *filename, const char *mode)
+{
+	sgfile_t *f;
+	FILE *file = NULL;
+	long len;
+
+	f = calloc(1, sizeof(*f));
+
+	if (!f)
+	{
+		return NULL;
+	}
+
+	Q_strlcpy(f->name, filename, sizeof(f->name));
+	f->writing = (mode[0] == 'w');
+
+	if (f->writing)
+	{
+		f->maxsize = SG_BUFFER_SIZE;
+	}
+	else
+	{
+		file = Q_fopen(filename, mode);
+
+		if (!file)
+		{
+			free(f);
+			return NULL;
+		}
+
+		fseek(file, 0, SEEK_END);
+		len = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		f->maxsize = (len > 0) ? len : 1;
+	}
+
+	f->data = malloc(f->maxsize);
+
+	if (!f->data)
+	{
+		if (file)
+		{
+			fclose(file);
+		}
+
+		free(f);
+		return NULL;
+	}
+
+	if (file)
+	{
+		f->size = fread(f->data, 1, f->maxsize, file);
+		fclose(file);
+	}
+
+	return f;
+}
+
+/*
+ * Hands the data to the server if the file
+ * was opened for writing and frees everything.
+ */
+static void
+sg_fclose(sgfile_t *f)
+{
+	char name[MAX_OSPATH];
+	qboolean failed = false;
+
+	if (f->writing)
+	{
+		Q_strlcpy(name, f->name, sizeof(name));
+		failed = !gi.WriteSaveFile(f->name, f->data, f->size);
+	}
+
+	free(f->data);
+	free(f);
+
+	if (failed)
+	{
+		gi.error("Couldn't write %s", name);
+	}
+}
+
 static void
-sg_fread(void *dest, size_t n, FILE *f)
+sg_fread(void *dest, size_t n, sgfile_t *f)
 {
-	if (fread(dest, n, 1, f) != 1)
+	if (n > f->size - f->pos)
 	{
-		fclose(f);
+		sg_fclose(f);
 		gi.error("Error reading " YQ2_COM_PRIdS " bytes from save file", n);
 	}
+
+	memcpy(dest, f->data + f->pos, n);
+	f->pos += n;
 }
 
 static void
-sg_fwrite(const void *src, size_t n, FILE *f)
+sg_fwrite(const void *src, size_t n, sgfile_t *f)
+{
+	if (n > f->maxsize - f->size)
+	{
+		size_t maxsize = f->maxsize;
+		byte *data;
+
+		while (n > maxsize - f->size)
+		{
+			maxsize *= 2;
+		}
+
+		data = realloc(f->data, maxsize);
+
+		if (!data)
+		{
+			/* don't leave a truncated save behind */
+			f->writing = false;
+			sg_fclose(f);
+			gi.error("Error writing " YQ2_COM_PRIdS " bytes to save file", n);
+		}
+
+		f->data = data;
+		f->maxsize = maxsize;
+	}
+
+	memcpy(f->data + f->size, src, n);
+	f->size += n;
+}
+
+/*
+ * The spawn fields sorted by name, for a binary
+ * search instead of scanning the tables for each
+ * key in the entity string. Built on first use.
+ */
+static const field_t *stfields_sorted[ARRLEN(stfields)];
+static int stfields_numsorted;
+static const field_t *entfields_sorted[ARRLEN(entfields)];
+static int entfields_numsorted;
+
+/*
+ * Case insensitive like Q_strcasecmp(), but
+ * ordered and key doesn't need to be 0 terminated.
+ */
+static int
+FieldNameCmp(const char *key, size_t len, const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		int c1 = key[i];
+		int c2 = name[i];
+
+		if ((c1 >= 'A') && (c1 <= 'Z'))
+		{
+			c1 += ('a' - 'A');
+		}
+
+		if ((c2 >= 'A') && (c2 <= 'Z'))
+		{
+			c2 += ('a' - 'A');
+		}
+
+		if (c1 != c2)
+		{
+			return c1 - c2;
+		}
+	}
+
+	return name[len] ? -1 : 0;
+}
+
+static int
+FieldSortCmp(const void *a, const void *b)
 {
-	if (fwrite(src, n, 1, f) != 1)
+	const field_t *fa = *(const field_t **)a;
+	const field_t *fb = *(const field_t **)b;
+	int r;
+
+	r = FieldNameCmp(fa->name, strlen(fa->name), fb->name);
+
+	if (r)
 	{
-		fclose(f);
-		gi.error("Error writing " YQ2_COM_PRIdS " bytes to save file", n);
+		return r;
 	}
+
+	/* duplicates keep their order, the first one wins */
+	return (fa < fb) ? -1 : (fa > fb);
 }
 
-const field_t *
-FindSpawntempField(const char *key)
+static int
+SortFields(const field_t **sorted, const field_t *fields,
+		const field_t *end, int skipflags)
 {
 	const field_t *f;
+	int num = 0;
 
-	for (f = stfields; f < ARREND(stfields); f++)
+	for (f = fields; f < end; f++)
 	{
-		if (!Q_strcasecmp(f->name, key))
+		if (f->name && !(f->flags & skipflags))
 		{
-			return f;
+			sorted[num++] = f;
 		}
 	}
 
-	return NULL;
+	qsort(sorted, num, sizeof(sorted[0]), FieldSortCmp);
+
+	return num;
 }
 
-const field_t *
-FindSpawnfield(const char *key)
+static const field_t *
+SearchField(const field_t **sorted, int num, const char *key, size_t len)
 {
-	const field_t *f;
+	int lo = 0, hi = num;
 
-	for (f = entfields; f < ARREND(entfields); f++)
+	/* find the first entry not less than key */
+	while (lo < hi)
 	{
-		if (!(f->flags & FFL_NOSPAWN) && !Q_strcasecmp(f->name, key))
+		int mid = (lo + hi) / 2;
+
+		if (FieldNameCmp(key, len, sorted[mid]->name) > 0)
+		{
+			lo = mid + 1;
+		}
+		else
 		{
-			return f;
+			hi = mid;
 		}
 	}
 
+	if ((lo < num) && !FieldNameCmp(key, len, sorted[lo]->name))
+	{
+		return sorted[lo];
+	}
+
 	return NULL;
 }
 
+/*
+ * key is len chars long and
+ * doesn't need to be 0 terminated.
+ */
+const field_t *
+FindSpawntempField(const char *key, size_t len)
+{
+	if (!stfields_numsorted)
+	{
+		stfields_numsorted = SortFields(stfields_sorted, stfields,
+				ARREND(stfields), 0);
+	}
+
+	return SearchField(stfields_sorted, stfields_numsorted, key, len);
+}
+
+const field_t *
+FindSpawnfield(const char *key, size_t len)
+{
+	if (!entfields_numsorted)
+	{
+		entfields_numsorted = SortFields(entfields_sorted, entfields,
+				ARREND(entfields), FFL_NOSPAWN);
+	}
+
+	return SearchField(entfields_sorted, entfields_numsorted, key, len);
+}
+
 static void
 InitAllocations(void)
 {
@@ -318,6 +551,9 @@ InitAllocations(void)
 
 	game.clients = gi.TagMalloc (num_c * sizeof(game.clients[0]), TAG_GAME);
 	game.maxclients = num_c;
+
+	G_InitFindIndex();
+	G_InitThinkQueue();
 }
 
 /*
@@ -358,6 +594,8 @@ InitGame(void)
 	g_monsterfootsteps = gi.cvar("g_monsterfootsteps", "0", CVAR_ARCHIVE);
 	g_fix_triggered = gi.cvar ("g_fix_triggered", "0", 0);
 	g_commanderbody_nogod = gi.cvar("g_commanderbody_nogod", "0", CVAR_ARCHIVE);
+	g_sleepentities = gi.cvar("g_sleepentities", "1", 0);
+	g_showsight = gi.cvar("g_showsight", "0", 0);
 
 	/* change anytime vars */
 	dmflags = gi.cvar("dmflags", "0", CVAR_SERVERINFO);
@@ -419,6 +657,153 @@ GetFunctionList(int field_ofs, const fptrList_t *fpl)
 	return NULL;
 }
 
+/*
+ * Function pointers and mmove_t pointers are
+ * mapped to their names and back through hash
+ * tables, instead of scanning the lists in
+ * tables/ for every field of every edict. The
+ * tables are built on first use, duplicates
+ * keep the first entry like the scans did.
+ */
+#define SG_HASHSIZE 4096 /* must be a power of two */
+
+typedef struct
+{
+	const functionList_t *fnl;
+	const fnlist_entry_t *fne;
+} fnhash_t;
+
+static fnhash_t fnhash_addr[SG_HASHSIZE];
+static fnhash_t fnhash_name[SG_HASHSIZE];
+static const mmoveList_t *mmhash_addr[SG_HASHSIZE];
+static const mmoveList_t *mmhash_name[SG_HASHSIZE];
+static qboolean sg_hashed;
+
+static unsigned
+HashPointer(const void *list, const void *ptr)
+{
+	size_t h = (size_t)ptr ^ ((size_t)list * 31);
+
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+
+	return (unsigned)h & (SG_HASHSIZE - 1);
+}
+
+static unsigned
+HashName(const void *list, const char *name)
+{
+	unsigned h = (unsigned)(size_t)list;
+
+	while (*name)
+	{
+		h = h * 33 + (unsigned char)*name++;
+	}
+
+	h ^= h >> 16;
+
+	return h & (SG_HASHSIZE - 1);
+}
+
+static void
+BuildPointerHashes(void)
+{
+	const fplist_entry_t *fpe;
+	const fnlist_entry_t *fne;
+	const mmoveList_t *mml;
+	unsigned h;
+	int num = 0;
+
+	memset(fnhash_addr, 0, sizeof(fnhash_addr));
+	memset(fnhash_name, 0, sizeof(fnhash_name));
+	memset(mmhash_addr, 0, sizeof(mmhash_addr));
+	memset(mmhash_name, 0, sizeof(mmhash_name));
+
+	for (fpe = fplist_ent.start; fpe < fplist_ent.end; fpe++)
+	{
+		const functionList_t *fnl = fpe->fnlist;
+
+		for (fne = fnl->start; fne < fnl->end; fne++)
+		{
+			if (++num >= SG_HASHSIZE)
+			{
+				gi.error("%s: SG_HASHSIZE too small", __func__);
+			}
+
+			for (h = HashPointer(fnl, fne->funcPtr); fnhash_addr[h].fne;
+				 h = (h + 1) & (SG_HASHSIZE - 1))
+			{
+				if ((fnhash_addr[h].fnl == fnl) &&
+					(fnhash_addr[h].fne->funcPtr == fne->funcPtr))
+				{
+					break;
+				}
+			}
+
+			if (!fnhash_addr[h].fne)
+			{
+				fnhash_addr[h].fnl = fnl;
+				fnhash_addr[h].fne = fne;
+			}
+
+			for (h = HashName(fnl, fne->funcStr); fnhash_name[h].fne;
+				 h = (h + 1) & (SG_HASHSIZE - 1))
+			{
+				if ((fnhash_name[h].fnl == fnl) &&
+					!strcmp(fnhash_name[h].fne->funcStr, fne->funcStr))
+				{
+					break;
+				}
+			}
+
+			if (!fnhash_name[h].fne)
+			{
+				fnhash_name[h].fnl = fnl;
+				fnhash_name[h].fne = fne;
+			}
+		}
+	}
+
+	if (ARRLEN(mmoveList) >= SG_HASHSIZE)
+	{
+		gi.error("%s: SG_HASHSIZE too small", __func__);
+	}
+
+	for (mml = mmoveList; mml < ARREND(mmoveList); mml++)
+	{
+		for (h = HashPointer(NULL, mml->mmovePtr); mmhash_addr[h];
+			 h = (h + 1) & (SG_HASHSIZE - 1))
+		{
+			if (mmhash_addr[h]->mmovePtr == mml->mmovePtr)
+			{
+				break;
+			}
+		}
+
+		if (!mmhash_addr[h])
+		{
+			mmhash_addr[h] = mml;
+		}
+
+		for (h = HashName(NULL, mml->mmoveStr); mmhash_name[h];
+			 h = (h + 1) & (SG_HASHSIZE - 1))
+		{
+			if (!strcmp(mmhash_name[h]->mmoveStr, mml->mmoveStr))
+			{
+				break;
+			}
+		}
+
+		if (!mmhash_name[h])
+		{
+			mmhash_name[h] = mml;
+		}
+	}
+
+	sg_hashed = true;
+}
+
 /*
  * Helper function to get
  * the human readable function
@@ -429,18 +814,24 @@ GetFunctionList(int field_ofs, const fptrList_t *fpl)
 static const fnlist_entry_t *
 GetFunctionByAddress(const byte *adr, const functionList_t *fnl)
 {
-	const fnlist_entry_t *fne;
+	unsigned h;
 
 	if (!fnl)
 	{
 		return NULL;
 	}
 
-	for (fne = fnl->start; fne < fnl->end; fne++)
+	if (!sg_hashed)
+	{
+		BuildPointerHashes();
+	}
+
+	for (h = HashPointer(fnl, adr); fnhash_addr[h].fne;
+		 h = (h + 1) & (SG_HASHSIZE - 1))
 	{
-		if (fne->funcPtr == adr)
+		if ((fnhash_addr[h].fnl == fnl) && (fnhash_addr[h].fne->funcPtr == adr))
 		{
-			return fne;
+			return fnhash_addr[h].fne;
 		}
 	}
 
@@ -457,18 +848,24 @@ GetFunctionByAddress(const byte *adr, const functionList_t *fnl)
 static byte *
 FindFunctionByName(const char *name, const functionList_t *fnl)
 {
-	const fnlist_entry_t *fne;
+	unsigned h;
 
 	if (!fnl)
 	{
 		return NULL;
 	}
 
-	for (fne = fnl->start; fne < fnl->end; fne++)
+	if (!sg_hashed)
+	{
+		BuildPointerHashes();
+	}
+
+	for (h = HashName(fnl, name); fnhash_name[h].fne;
+		 h = (h + 1) & (SG_HASHSIZE - 1))
 	{
-		if (!strcmp(name, fne->funcStr))
+		if ((fnhash_name[h].fnl == fnl) && !strcmp(fnhash_name[h].fne->funcStr, name))
 		{
-			return fne->funcPtr;
+			return fnhash_name[h].fne->funcPtr;
 		}
 	}
 
@@ -483,13 +880,19 @@ FindFunctionByName(const char *name, const functionList_t *fnl)
 static const mmoveList_t *
 GetMmoveByAddress(const mmove_t *adr)
 {
-	const mmoveList_t *mml;
+	unsigned h;
 
-	for (mml = mmoveList; mml < ARREND(mmoveList); mml++)
+	if (!sg_hashed)
+	{
+		BuildPointerHashes();
+	}
+
+	for (h = HashPointer(NULL, adr); mmhash_addr[h];
+		 h = (h + 1) & (SG_HASHSIZE - 1))
 	{
-		if (mml->mmovePtr == adr)
+		if (mmhash_addr[h]->mmovePtr == adr)
 		{
-			return mml;
+			return mmhash_addr[h];
 		}
 	}
 
@@ -504,13 +907,19 @@ GetMmoveByAddress(const mmove_t *adr)
 static mmove_t *
 FindMmoveByName(const char *name)
 {
-	const mmoveList_t *mml;
+	unsigned h;
 
-	for (mml = mmoveList; mml < ARREND(mmoveList); mml++)
+	if (!sg_hashed)
+	{
+		BuildPointerHashes();
+	}
+
+	for (h = HashName(NULL, name); mmhash_name[h];
+		 h = (h + 1) & (SG_HASHSIZE - 1))
 	{
-		if (!strcmp(name, mml->mmoveStr))
+		if (!strcmp(mmhash_name[h]->mmoveStr, name))
 		{
-			return mml->mmovePtr;
+			return mmhash_name[h]->mmovePtr;
 		}
 	}
 
@@ -572,7 +981,7 @@ GetMmoveLength(const mmove_t *mm)
  * below this block into files.
  */
 static void
-WriteField1(FILE *f, const field_t *field, void *base, const fptrList_t *fpl)
+WriteField1(sgfile_t *f, const field_t *field, void *base, const fptrList_t *fpl)
 {
 	void *p;
 	size_t len;
@@ -635,13 +1044,13 @@ WriteField1(FILE *f, const field_t *field, void *base, const fptrList_t *fpl)
 			*(int *)p = GetMmoveLength(*(mmove_t **)p);
 			break;
 		default:
-			fclose(f);
+			sg_fclose(f);
 			gi.error("%s: unknown field type", __func__);
 	}
 }
 
 static void
-WriteFunction(FILE *f, const byte *fn, const functionList_t *fnl)
+WriteFunction(sgfile_t *f, const byte *fn, const functionList_t *fnl)
 {
 	const fnlist_entry_t *fne;
 
@@ -660,7 +1069,7 @@ WriteFunction(FILE *f, const byte *fn, const functionList_t *fnl)
 }
 
 static void
-WriteMmove(FILE *f, const mmove_t *mm)
+WriteMmove(sgfile_t *f, const mmove_t *mm)
 {
 	const mmoveList_t *mmove;
 
@@ -679,7 +1088,7 @@ WriteMmove(FILE *f, const mmove_t *mm)
 }
 
 static void
-WriteField2(FILE *f, const field_t *field, const void *base, const fptrList_t *fpl)
+WriteField2(sgfile_t *f, const field_t *field, const void *base, const fptrList_t *fpl)
 {
 	const void *p;
 
@@ -708,7 +1117,7 @@ WriteField2(FILE *f, const field_t *field, const void *base, const fptrList_t *f
 }
 
 static void
-WriteStruct(FILE *f, const void *base, void *temp, const structdef_t *sd)
+WriteStruct(sgfile_t *f, const void *base, void *temp, const structdef_t *sd)
 {
 	const field_t *field;
 
@@ -731,7 +1140,7 @@ WriteStruct(FILE *f, const void *base, void *temp, const structdef_t *sd)
 
 /* int because that is how it's stored in the file */
 static void
-ReadStringToBuf(FILE *f, int len, char *out, size_t out_sz)
+ReadStringToBuf(sgfile_t *f, int len, char *out, size_t out_sz)
 {
 	*out = 0;
 
@@ -742,14 +1151,14 @@ ReadStringToBuf(FILE *f, int len, char *out, size_t out_sz)
 
 	if (len < 0)
 	{
-		fclose(f);
+		sg_fclose(f);
 		gi.error("%s: string length < 0", __func__);
 		return;
 	}
 
 	if (len >= (int)out_sz)
 	{
-		fclose(f);
+		sg_fclose(f);
 		gi.error("%s: string is too long for buffer: %i > %i ",
 				__func__, len, (int)out_sz);
 		return;
@@ -761,7 +1170,7 @@ ReadStringToBuf(FILE *f, int len, char *out, size_t out_sz)
 
 /* int because that is how it's stored in the file */
 static char *
-ReadString(FILE *f, int len, int tag)
+ReadString(sgfile_t *f, int len, int tag)
 {
 	char *s;
 
@@ -772,7 +1181,7 @@ ReadString(FILE *f, int len, int tag)
 
 	if (len < 0)
 	{
-		fclose(f);
+		sg_fclose(f);
 		gi.error("%s: string length < 0", __func__);
 		return NULL;
 	}
@@ -780,7 +1189,7 @@ ReadString(FILE *f, int len, int tag)
 	s = gi.TagMalloc(len + 1, tag);
 	if (!s)
 	{
-		fclose(f);
+		sg_fclose(f);
 		gi.error("%s: can't allocate memory for string", __func__);
 		return NULL;
 	}
@@ -792,7 +1201,7 @@ ReadString(FILE *f, int len, int tag)
 }
 
 static byte *
-ReadFunction(FILE *f, int len, const functionList_t *fnl)
+ReadFunction(sgfile_t *f, int len, const functionList_t *fnl)
 {
 	char funcStr[128];
 	byte *fn;
@@ -815,7 +1224,7 @@ ReadFunction(FILE *f, int len, const functionList_t *fnl)
 }
 
 static mmove_t *
-ReadMmove(FILE *f, int len)
+ReadMmove(sgfile_t *f, int len)
 {
 	char mmoveStr[128];
 	mmove_t *mm;
@@ -845,7 +1254,7 @@ ReadMmove(FILE *f, int len)
  * below
  */
 static void
-ReadField(FILE *f, const field_t *field, void *base, const fptrList_t *fpl)
+ReadField(sgfile_t *f, const field_t *field, void *base, const fptrList_t *fpl)
 {
 	void *p;
 	int len;
@@ -890,13 +1299,13 @@ ReadField(FILE *f, const field_t *field, void *base, const fptrList_t *fpl)
 			*(mmove_t **)p = ReadMmove(f, *(int *)p);
 			break;
 		default:
-			fclose(f);
+			sg_fclose(f);
 			gi.error("%s: unknown field type", __func__);
 	}
 }
 
 static void
-ReadStruct(FILE *f, void *base, const structdef_t *sd, short save_ver)
+ReadStruct(sgfile_t *f, void *base, const structdef_t *sd, short save_ver)
 {
 	const field_t *field;
 
@@ -917,7 +1326,7 @@ ReadStruct(FILE *f, void *base, const structdef_t *sd, short save_ver)
  * Write the client struct into a file.
  */
 static void
-WriteClient(FILE *f, const gclient_t *client)
+WriteClient(sgfile_t *f, const gclient_t *client)
 {
 	gclient_t temp;
 
@@ -949,7 +1358,7 @@ SanitizeClientStruct(gclient_t *cl)
 }
 
 static void
-ReadClient(FILE *f, gclient_t *client, short save_ver)
+ReadClient(sgfile_t *f, gclient_t *client, short save_ver)
 {
 	ReadStruct(f, client, &sd_client, save_ver);
 	SanitizeClientStruct(client);
@@ -973,7 +1382,7 @@ ReadClient(FILE *f, gclient_t *client, short save_ver)
  * - help computer info
  */
 static void
-WriteSaveHeader(FILE *f)
+WriteSaveHeader(sgfile_t *f)
 {
 	savegameHeader_t sv;
 
@@ -988,7 +1397,7 @@ WriteSaveHeader(FILE *f)
 }
 
 static void
-WriteGameLocals(FILE *f, qboolean autosave)
+WriteGameLocals(sgfile_t *f, qboolean autosave)
 {
 	game_locals_t temp;
 
@@ -1006,7 +1415,7 @@ WriteGameLocals(FILE *f, qboolean autosave)
 void
 WriteGame(const char *filename, qboolean autosave)
 {
-	FILE *f;
+	sgfile_t *f;
 	int i;
 
 	if (!autosave)
@@ -1014,7 +1423,7 @@ WriteGame(const char *filename, qboolean autosave)
 		SaveClientData();
 	}
 
-	f = Q_fopen(filename, "wb");
+	f = sg_fopen(filename, "wb");
 
 	if (!f)
 	{
@@ -1030,7 +1439,7 @@ WriteGame(const char *filename, qboolean autosave)
 		WriteClient(f, &game.clients[i]);
 	}
 
-	fclose(f);
+	sg_fclose(f);
 }
 
 /*
@@ -1149,14 +1558,14 @@ void
 ReadGame(const char *filename)
 {
 	savegameHeader_t sv;
-	FILE *f;
+	sgfile_t *f;
 	int i;
 	const char *errmsg;
 	short save_ver;
 
 	gi.FreeTags(TAG_GAME);
 
-	f = Q_fopen(filename, "rb");
+	f = sg_fopen(filename, "rb");
 
 	if (!f)
 	{
@@ -1175,7 +1584,7 @@ ReadGame(const char *filename)
 	errmsg = CheckSaveCompatibility(&sv, save_ver);
 	if (errmsg)
 	{
-		fclose(f);
+		sg_fclose(f);
 		gi.error("%s", errmsg);
 		return;
 	}
@@ -1191,7 +1600,7 @@ ReadGame(const char *filename)
 		ReadClient(f, &game.clients[i], save_ver);
 	}
 
-	fclose(f);
+	sg_fclose(f);
 }
 
 /* ========================================================== */
@@ -1202,7 +1611,7 @@ ReadGame(const char *filename)
  * WriteLevel.
  */
 static void
-WriteEdict(FILE *f, const edict_t *ent)
+WriteEdict(sgfile_t *f, const edict_t *ent)
 {
 	edict_t temp;
 
@@ -1219,7 +1628,7 @@ WriteEdict(FILE *f, const edict_t *ent)
  * Called by WriteLevel.
  */
 static void
-WriteLevelLocals(FILE *f)
+WriteLevelLocals(sgfile_t *f)
 {
 	level_locals_t temp;
 
@@ -1237,9 +1646,9 @@ void
 WriteLevel(const char *filename)
 {
 	int i;
-	FILE *f;
+	sgfile_t *f;
 
-	f = Q_fopen(filename, "wb");
+	f = sg_fopen(filename, "wb");
 
 	if (!f)
 	{
@@ -1273,7 +1682,7 @@ WriteLevel(const char *filename)
 	i = -1;
 	sg_fwrite(&i, sizeof(i), f);
 
-	fclose(f);
+	sg_fclose(f);
 }
 
 /* ========================================================== */
@@ -1298,7 +1707,7 @@ SanitizeLevelStruct(void)
 }
 
 static void
-ReadLevelLocals(FILE *f)
+ReadLevelLocals(sgfile_t *f)
 {
 	ReadStruct(f, &level, &sd_level, 0);
 	SanitizeLevelStruct();
@@ -1317,11 +1726,11 @@ void
 ReadLevel(const char *filename)
 {
 	int entnum;
-	FILE *f;
+	sgfile_t *f;
 	int i;
 	edict_t *ent;
 
-	f = Q_fopen(filename, "rb");
+	f = sg_fopen(filename, "rb");
 
 	if (!f)
 	{
@@ -1342,7 +1751,7 @@ ReadLevel(const char *filename)
 
 	if (i != sizeof(edict_t))
 	{
-		fclose(f);
+		sg_fclose(f);
 		gi.error("%s: mismatched edict size", __func__);
 		return;
 	}
@@ -1357,7 +1766,7 @@ ReadLevel(const char *filename)
 
 		if ((entnum < -1) || (entnum >= game.maxentities))
 		{
-			fclose(f);
+			sg_fclose(f);
 			gi.error("%s: entnum out of bounds: %d", __func__, entnum);
 		}
 
@@ -1389,7 +1798,7 @@ ReadLevel(const char *filename)
 		gi.linkentity(ent);
 	}
 
-	fclose(f);
+	sg_fclose(f);
 
 	/* mark all clients as unconnected */
 	for (i = 0; i < maxclients->value; i++)
@@ -1399,6 +1808,10 @@ ReadLevel(const char *filename)
 		ent->client->pers.connected = false;
 	}
 
+	G_ResetFindIndex();
+	G_ResetThinkQueue();
+	AI_ResetSightCache();
+
 	/* do any load time things at this point */
 	for (i = 0; i < globals.num_edicts; i++)
 	{
@@ -261,6 +261,7 @@ void SV_ReadLevelFile(void);
 void SV_WriteFrameToClient(client_t *client, sizebuf_t *msg);
 void SV_RecordDemoMessage(void);
 void SV_BuildClientFrame(client_t *client);
+void SV_ResetCullEntities(void);
 
 extern game_export_t *ge;
 
@@ -273,6 +274,8 @@ void SV_WipeSavegame(char *savename);
 void SV_CopySaveGame(char *src, char *dst);
 void SV_WriteLevelFile(void);
 void SV_WriteServerFile(qboolean autosave);
+qboolean SV_WriteSaveFile(const char *name, const void *data, size_t size);
+void SV_WaitForSaveFile(const char *path);
 void SV_Loadgame_f(void);
 void SV_Savegame_f(void);
 
@@ -292,6 +295,8 @@ void SV_LinkEdict(edict_t *ent);
    the entity is not solid */
 int SV_AreaEdicts(const vec3_t mins, const vec3_t maxs, edict_t **list,
 		int maxcount, int areatype);
+int SV_RadiusEdicts(const vec3_t origin, float radius, edict_t **list,
+		int maxcount);
 
 int SV_PointContents(const vec3_t p);
 
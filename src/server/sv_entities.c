@@ -501,6 +501,91 @@ SV_FatPVS(vec3_t org)
 	}
 }
 
+/*
+ * The fields SV_BuildClientFrame() culls by, gathered once per
+ * SV_SendClientMessages() for the entities that could be sent at
+ * all. The edicts are ge->edict_size bytes apart (about 1 KB for
+ * baseq2), walking all of them for each client misses the cache on
+ * every entity. The only game code that can run while the client
+ * frames are built is ge->ClientDisconnect() when a client is
+ * dropped, SV_DropClient() resets the copies then.
+ */
+typedef struct
+{
+	int number;
+	int areanum, areanum2;
+	int num_clusters; /* if -1, use headnode instead */
+	int headnode;
+	int clusternums[MAX_ENT_CLUSTERS];
+	qboolean beam;
+	qboolean sound; /* no model, only sound or effects */
+} cullent_t;
+
+static cullent_t cullents[MAX_EDICTS];
+static int numcullents;
+static qboolean cullents_valid;
+
+/*
+ * Called before the client frames are built and
+ * whenever the game may have changed the entities.
+ */
+void
+SV_ResetCullEntities(void)
+{
+	cullents_valid = false;
+}
+
+static void
+SV_GatherCullEntities(void)
+{
+	cullent_t *c;
+	edict_t *ent;
+	int e;
+
+	numcullents = 0;
+
+	for (e = 1; e < ge->num_edicts; e++)
+	{
+		ent = EDICT_NUM(e);
+
+		/* ignore ents without visible models */
+		if (ent->svflags & SVF_NOCLIENT)
+		{
+			continue;
+		}
+
+		/* ignore ents without visible models unless they have an effect */
+		if (!ent->s.modelindex && !ent->s.effects &&
+			!ent->s.sound && !ent->s.event)
+		{
+			continue;
+		}
+
+		c = &cullents[numcullents++];
+		c->number = e;
+		c->areanum = ent->areanum;
+		c->areanum2 = ent->areanum2;
+		c->num_clusters = ent->num_clusters;
+		c->headnode = ent->headnode;
+
+		if (ent->num_clusters > 0)
+		{
+			memcpy(c->clusternums, ent->clusternums,
+					ent->num_clusters * sizeof(ent->clusternums[0]));
+		}
+		else
+		{
+			/* beams check the first one */
+			c->clusternums[0] = ent->clusternums[0];
+		}
+
+		c->beam = (ent->s.renderfx & RF_BEAM) ? true : false;
+		c->sound = !ent->s.modelindex;
+	}
+
+	cullents_valid = true;
+}
+
 /*
  * Decides which entities are going to be visible to the client, and
  * copies off the playerstat and areabits.
@@ -514,6 +599,7 @@ SV_BuildClientFrame(client_t *client)
 	edict_t *clent;
 	client_frame_t *frame;
 	entity_state_t *state;
+	const cullent_t *c;
 	int l;
 	int clientarea, clientcluster;
 	int leafnum;
@@ -556,42 +642,35 @@ SV_BuildClientFrame(client_t *client)
 	frame->num_entities = 0;
 	frame->first_entity = svs.next_client_entities;
 
-	for (e = 1; e < ge->num_edicts; e++)
+	if (!cullents_valid)
 	{
-		ent = EDICT_NUM(e);
-
-		/* ignore ents without visible models */
-		if (ent->svflags & SVF_NOCLIENT)
-		{
-			continue;
-		}
+		SV_GatherCullEntities();
+	}
 
-		/* ignore ents without visible models unless they have an effect */
-		if (!ent->s.modelindex && !ent->s.effects &&
-			!ent->s.sound && !ent->s.event)
-		{
-			continue;
-		}
+	for (c = cullents; c < cullents + numcullents; c++)
+	{
+		e = c->number;
+		ent = EDICT_NUM(e); /* just the address, not touched until sent */
 
 		/* ignore if not touching a PV leaf */
 		if (ent != clent)
 		{
 			/* check area */
-			if (!CM_AreasConnected(clientarea, ent->areanum))
+			if (!CM_AreasConnected(clientarea, c->areanum))
 			{
 				/* doors can legally straddle two areas,
 				   so we may need to check another one */
-				if (!ent->areanum2 ||
-					!CM_AreasConnected(clientarea, ent->areanum2))
+				if (!c->areanum2 ||
+					!CM_AreasConnected(clientarea, c->areanum2))
 				{
 					continue; /* blocked by a door */
 				}
 			}
 
 			/* beams just check one point for PHS */
-			if (ent->s.renderfx & RF_BEAM)
+			if (c->beam)
 			{
-				l = ent->clusternums[0];
+				l = c->clusternums[0];
 
 				if (!(clientphs[l >> 3] & (1 << (l & 7))))
 				{
@@ -602,10 +681,10 @@ SV_BuildClientFrame(client_t *client)
 			{
 				bitvector = fatpvs;
 
-				if (ent->num_clusters == -1)
+				if (c->num_clusters == -1)
 				{
 					/* too many leafs for individual check, go by headnode */
-					if (!CM_HeadnodeVisible(ent->headnode, bitvector))
+					if (!CM_HeadnodeVisible(c->headnode, bitvector))
 					{
 						continue;
 					}
@@ -613,9 +692,9 @@ SV_BuildClientFrame(client_t *client)
 				else
 				{
 					/* check individual leafs */
-					for (i = 0; i < ent->num_clusters; i++)
+					for (i = 0; i < c->num_clusters; i++)
 					{
-						l = ent->clusternums[i];
+						l = c->clusternums[i];
 
 						if (bitvector[l >> 3] & (1 << (l & 7)))
 						{
@@ -623,13 +702,13 @@ SV_BuildClientFrame(client_t *client)
 						}
 					}
 
-					if (i == ent->num_clusters)
+					if (i == c->num_clusters)
 					{
 						continue; /* not visible */
 					}
 				}
 
-				if (!ent->s.modelindex)
+				if (c->sound)
 				{
 					/* don't send sounds if they
 					   will be attenuated away */
@@ -471,6 +471,8 @@ SV_InitGameProgs(void)
 	import.linkentity = SV_LinkEdict;
 	import.unlinkentity = SV_UnlinkEdict;
 	import.BoxEdicts = SV_AreaEdicts;
+	import.RadiusEdicts = SV_RadiusEdicts;
+	import.WriteSaveFile = SV_WriteSaveFile;
 	import.trace = SV_Trace;
 	import.pointcontents = SV_PointContents;
 	import.setmodel = PF_setmodel;
@@ -523,7 +525,8 @@ SV_InitGameProgs(void)
 		Com_Error(ERR_DROP, "failed to load game DLL");
 	}
 
-	if (ge->apiversion != GAME_API_VERSION)
+	if ((ge->apiversion != GAME_API_VERSION) &&
+		(ge->apiversion != GAME_API_VERSION_ORIGINAL))
 	{
 		Com_Error(ERR_DROP, "game is version %i, not %i", ge->apiversion,
 				GAME_API_VERSION);
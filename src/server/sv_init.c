@@ -205,6 +205,10 @@ SV_CheckForSavegame(qboolean isautosave)
 
 	Com_sprintf(name, sizeof(name), "%s/save/current/%s.sav",
 			FS_Gamedir(), sv.name);
+
+	/* the level may still be queued for writing */
+	SV_WaitForSaveFile(name);
+
 	f = Q_fopen(name, "rb");
 
 	if (!f)
@@ -73,6 +73,10 @@ SV_DropClient(client_t *drop)
 		/* call the prog function for removing a client
 		   this will remove the body, among other things */
 		ge->ClientDisconnect(CL_EDICT(drop));
+
+		/* the body may be gone, don't
+		   cull by the old entity fields */
+		SV_ResetCullEntities();
 	}
 
 	if (drop->download)
@@ -718,6 +722,8 @@ SV_ClearBaselines(void)
 void
 SV_Shutdown(char *finalmsg, qboolean reconnect)
 {
+	SV_FlushSaveFiles();
+
 	if (svs.clients)
 	{
 		SV_FinalMessage(finalmsg, reconnect);
@@ -28,6 +28,352 @@
 
 void CM_ReadPortalState(fileHandle_t f);
 
+/*
+ * Savegames are written in the background. The files are
+ * serialized to memory on the main thread and queued, together
+ * with the copies between save directories, as jobs for a
+ * writer thread. The jobs are processed in order, so a copy
+ * always sees the files queued before it. Everything reading
+ * or deleting savegames calls SV_FlushSaveFiles() first.
+ * Files are written to a .tmp file that's renamed into place
+ * once complete, so an interrupted write never leaves a
+ * truncated savegame behind.
+ */
+typedef struct savejob_s
+{
+	struct savejob_s *next;
+	char path[MAX_OSPATH];
+	char src[MAX_OSPATH]; /* copies only */
+	byte *data;           /* writes only */
+	size_t size;
+} savejob_t;
+
+static savejob_t *savejobs_head;
+static savejob_t *savejobs_tail;
+static void *savejobs_mutex;
+static void *savejobs_thread;
+static qboolean savejobs_running;
+static int savejobs_failed;
+
+static void
+SV_SaveWriterThread(void *unused)
+{
+	savejob_t *job;
+
+	while (1)
+	{
+		Sys_LockMutex(savejobs_mutex);
+		job = savejobs_head;
+
+		if (!job)
+		{
+			savejobs_running = false;
+			Sys_UnlockMutex(savejobs_mutex);
+			return;
+		}
+
+		Sys_UnlockMutex(savejobs_mutex);
+
+		if (job->data)
+		{
+			char tmp[MAX_OSPATH];
+			qboolean ok;
+			FILE *f;
+
+			Com_sprintf(tmp, sizeof(tmp), "%s.tmp", job->path);
+			f = Q_fopen(tmp, "wb");
+
+			ok = f && (!job->size || (fwrite(job->data, job->size, 1, f) == 1));
+
+			if (f && fclose(f))
+			{
+				ok = false;
+			}
+
+			if (ok && Sys_Rename(tmp, job->path))
+			{
+				/* Windows doesn't rename over existing files */
+				Sys_Remove(job->path);
+				ok = !Sys_Rename(tmp, job->path);
+			}
+
+			if (!ok)
+			{
+				savejobs_failed++;
+			}
+		}
+		else if (!Sys_CopyFile(job->src, job->path))
+		{
+			savejobs_failed++;
+		}
+
+		/* the job stays in the list until it's
+		   done, see SV_SaveJobsPending() */
+		Sys_LockMutex(savejobs_mutex);
+		savejobs_head = job->next;
+
+		if (!savejobs_head)
+		{
+			savejobs_tail = NULL;
+		}
+
+		Sys_UnlockMutex(savejobs_mutex);
+
+		free(job->data);
+		free(job);
+	}
+}
+
+static void
+SV_QueueSaveJob(savejob_t *job)
+{
+	qboolean start;
+
+	if (!savejobs_mutex)
+	{
+		savejobs_mutex = Sys_CreateMutex();
+	}
+
+	Sys_LockMutex(savejobs_mutex);
+
+	if (savejobs_tail)
+	{
+		savejobs_tail->next = job;
+	}
+	else
+	{
+		savejobs_head = job;
+	}
+
+	savejobs_tail = job;
+
+	start = !savejobs_running;
+	savejobs_running = true;
+
+	Sys_UnlockMutex(savejobs_mutex);
+
+	if (!start)
+	{
+		return;
+	}
+
+	/* the last thread ran out of work and is done */
+	if (savejobs_thread)
+	{
+		Sys_WaitThread(savejobs_thread);
+	}
+
+	savejobs_thread = Sys_CreateThread(SV_SaveWriterThread, NULL);
+
+	if (!savejobs_thread)
+	{
+		SV_SaveWriterThread(NULL);
+	}
+}
+
+/*
+ * Queues a write of data to path, data must
+ * be malloc()ed and is freed after. Returns
+ * false if path can't be written at all.
+ */
+static qboolean
+SV_QueueSaveData(const char *path, byte *data, size_t size)
+{
+	char tmp[MAX_OSPATH];
+	savejob_t *job;
+	FILE *f;
+
+	/* check right away, so the caller can report it. Only the
+	   .tmp file is probed, the savegame itself is never left
+	   empty. Appending doesn't truncate a write in progress. */
+	Com_sprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	f = Q_fopen(tmp, "ab");
+
+	if (!f)
+	{
+		free(data);
+		return false;
+	}
+
+	fclose(f);
+
+	job = calloc(1, sizeof(*job));
+
+	if (!job)
+	{
+		Com_Error(ERR_FATAL, "%s: out of memory", __func__);
+	}
+
+	Q_strlcpy(job->path, path, sizeof(job->path));
+	job->data = data;
+	job->size = size;
+
+	SV_QueueSaveJob(job);
+
+	return true;
+}
+
+static void
+SV_QueueSaveCopy(const char *src, const char *dst)
+{
+	savejob_t *job = calloc(1, sizeof(*job));
+
+	if (!job)
+	{
+		Com_Error(ERR_FATAL, "%s: out of memory", __func__);
+	}
+
+	Com_DPrintf("CopyFile (%s, %s)\n", src, dst);
+
+	Q_strlcpy(job->src, src, sizeof(job->src));
+	Q_strlcpy(job->path, dst, sizeof(job->path));
+
+	SV_QueueSaveJob(job);
+}
+
+/*
+ * Returns true if a queued job writes to or
+ * reads from the directory (or file) dir.
+ */
+static qboolean
+SV_SaveJobsPending(const char *dir)
+{
+	size_t len = strlen(dir);
+	const savejob_t *job;
+	qboolean pending = false;
+
+	if (!savejobs_mutex)
+	{
+		return false;
+	}
+
+	Sys_LockMutex(savejobs_mutex);
+
+	for (job = savejobs_head; job; job = job->next)
+	{
+		if (!strncmp(job->path, dir, len) ||
+			(job->src[0] && !strncmp(job->src, dir, len)))
+		{
+			pending = true;
+			break;
+		}
+	}
+
+	Sys_UnlockMutex(savejobs_mutex);
+
+	return pending;
+}
+
+/*
+ * Collects the levels queued for writing to dir,
+ * they're copied even if they aren't on disk yet.
+ */
+static int
+SV_PendingLevels(const char *dir, char (*paths)[MAX_OSPATH], int maxpaths)
+{
+	size_t len = strlen(dir);
+	const savejob_t *job;
+	int num = 0;
+
+	if (!savejobs_mutex)
+	{
+		return 0;
+	}
+
+	Sys_LockMutex(savejobs_mutex);
+
+	for (job = savejobs_head; job && num < maxpaths; job = job->next)
+	{
+		size_t l = strlen(job->path);
+
+		if (job->data && !strncmp(job->path, dir, len) &&
+			(l > len + 4) && !strcmp(job->path + l - 4, ".sav"))
+		{
+			Q_strlcpy(paths[num++], job->path, MAX_OSPATH);
+		}
+	}
+
+	Sys_UnlockMutex(savejobs_mutex);
+
+	return num;
+}
+
+/*
+ * Waits until all queued savegame files are
+ * written to disk. Returns the number of
+ * files that couldn't be written or copied.
+ */
+int
+SV_FlushSaveFiles(void)
+{
+	int failed;
+
+	if (savejobs_thread)
+	{
+		Sys_WaitThread(savejobs_thread);
+		savejobs_thread = NULL;
+	}
+
+	failed = savejobs_failed;
+	savejobs_failed = 0;
+
+	if (failed)
+	{
+		Com_Printf("WARNING: Couldn't write %i savegame file(s), "
+				"the savegame is incomplete!\n", failed);
+	}
+
+	return failed;
+}
+
+/*
+ * Waits for the queued jobs if
+ * one of them touches path.
+ */
+void
+SV_WaitForSaveFile(const char *path)
+{
+	if (SV_SaveJobsPending(path))
+	{
+		SV_FlushSaveFiles();
+	}
+}
+
+/*
+ * Called by the game for each of its files.
+ * Returns false if the file can't be written.
+ */
+qboolean
+SV_WriteSaveFile(const char *name, const void *data, size_t size)
+{
+	char path[MAX_OSPATH];
+	byte *copy;
+
+	if ((name[0] == '/') || (name[0] == '\\') || (name[0] && name[1] == ':'))
+	{
+		Q_strlcpy(path, name, sizeof(path));
+	}
+	else
+	{
+		/* the game is called in the savegame directory */
+		char workdir[MAX_OSPATH];
+
+		Sys_GetWorkDir(workdir, sizeof(workdir));
+		Com_sprintf(path, sizeof(path), "%s/%s", workdir, name);
+	}
+
+	copy = malloc(size ? size : 1);
+
+	if (!copy)
+	{
+		Com_Error(ERR_FATAL, "%s: out of memory", __func__);
+	}
+
+	memcpy(copy, data, size);
+
+	return SV_QueueSaveData(path, copy, size);
+}
+
 /*
  * Delete save/<XXX>/
  */
@@ -39,6 +385,14 @@ SV_WipeSavegame(char *savename)
 
 	Com_DPrintf("SV_WipeSaveGame(%s)\n", savename);
 
+	/* don't let queued files come back */
+	Com_sprintf(name, sizeof(name), "%s/save/%s/", FS_Gamedir(), savename);
+
+	if (SV_SaveJobsPending(name))
+	{
+		SV_FlushSaveFiles();
+	}
+
 	Com_sprintf(name, sizeof(name), "%s/save/%s/server.ssv",
 				FS_Gamedir(), savename);
 
@@ -71,51 +425,35 @@ SV_WipeSavegame(char *savename)
 	Sys_FindClose();
 }
 
+/*
+ * Queues the copy of a level, name is
+ * the .sav file relative to both dirs.
+ */
 static void
-CopyFile(char *src, char *dst)
+SV_CopyLevel(const char *src, const char *dst, const char *name)
 {
-	FILE *f1, *f2;
+	char from[MAX_OSPATH], to[MAX_OSPATH];
 	size_t l;
-	byte buffer[65536];
-
-	Com_DPrintf("CopyFile (%s, %s)\n", src, dst);
-
-	f1 = Q_fopen(src, "rb");
-
-	if (!f1)
-	{
-		return;
-	}
-
-	f2 = Q_fopen(dst, "wb");
-
-	if (!f2)
-	{
-		fclose(f1);
-		return;
-	}
-
-	while (1)
-	{
-		l = fread(buffer, 1, sizeof(buffer), f1);
-
-		if (!l)
-		{
-			break;
-		}
 
-		fwrite(buffer, 1, l, f2);
-	}
+	Com_sprintf(from, sizeof(from), "%s/save/%s/%s", FS_Gamedir(), src, name);
+	Com_sprintf(to, sizeof(to), "%s/save/%s/%s", FS_Gamedir(), dst, name);
+	SV_QueueSaveCopy(from, to);
 
-	fclose(f1);
-	fclose(f2);
+	/* change sav to sv2 */
+	l = strlen(from);
+	strcpy(from + l - 3, "sv2");
+	l = strlen(to);
+	strcpy(to + l - 3, "sv2");
+	SV_QueueSaveCopy(from, to);
 }
 
 void
 SV_CopySaveGame(char *src, char *dst)
 {
 	char name[MAX_OSPATH], name2[MAX_OSPATH];
-	size_t l, len;
+	char pending[16][MAX_OSPATH];
+	int i, numpending;
+	size_t len;
 	char *found;
 
 	Com_DPrintf("SV_CopySaveGame(%s, %s)\n", src, dst);
@@ -126,31 +464,46 @@ SV_CopySaveGame(char *src, char *dst)
 	Com_sprintf(name, sizeof(name), "%s/save/%s/server.ssv", FS_Gamedir(), src);
 	Com_sprintf(name2, sizeof(name2), "%s/save/%s/server.ssv", FS_Gamedir(), dst);
 	FS_CreatePath(name2);
-	CopyFile(name, name2);
+	SV_QueueSaveCopy(name, name2);
 
 	Com_sprintf(name, sizeof(name), "%s/save/%s/game.ssv", FS_Gamedir(), src);
 	Com_sprintf(name2, sizeof(name2), "%s/save/%s/game.ssv", FS_Gamedir(), dst);
-	CopyFile(name, name2);
+	SV_QueueSaveCopy(name, name2);
 
+	/* the levels still queued for writing and the ones on disk */
 	Com_sprintf(name, sizeof(name), "%s/save/%s/", FS_Gamedir(), src);
 	len = strlen(name);
+	numpending = SV_PendingLevels(name, pending, ARRLEN(pending));
+
+	if (numpending == ARRLEN(pending))
+	{
+		/* too many to keep track of, just wait */
+		SV_FlushSaveFiles();
+		numpending = 0;
+	}
+
+	for (i = 0; i < numpending; i++)
+	{
+		SV_CopyLevel(src, dst, pending[i] + len);
+	}
+
 	Com_sprintf(name, sizeof(name), "%s/save/%s/*.sav", FS_Gamedir(), src);
 	found = Sys_FindFirst(name, 0, 0);
 
 	while (found)
 	{
-		strcpy(name + len, found + len);
-
-		Com_sprintf(name2, sizeof(name2), "%s/save/%s/%s",
-					FS_Gamedir(), dst, found + len);
-		CopyFile(name, name2);
+		for (i = 0; i < numpending; i++)
+		{
+			if (!strcmp(pending[i] + len, found + len))
+			{
+				break;
+			}
+		}
 
-		/* change sav to sv2 */
-		l = strlen(name);
-		strcpy(name + l - 3, "sv2");
-		l = strlen(name2);
-		strcpy(name2 + l - 3, "sv2");
-		CopyFile(name, name2);
+		if (i == numpending)
+		{
+			SV_CopyLevel(src, dst, found + len);
+		}
 
 		found = Sys_FindNext(0, 0);
 	}
@@ -163,27 +516,38 @@ SV_WriteLevelFile(void)
 {
 	char name[MAX_OSPATH];
 	char workdir[MAX_OSPATH];
-	FILE *f;
+	sizebuf_t sb;
+	byte *data;
+	int size;
 
 	Com_DPrintf("SV_WriteLevelFile()\n");
 
+	Com_sprintf(name, sizeof(name), "%s/save/current", FS_Gamedir());
+	Sys_Mkdir(name);
+
+	size = sizeof(sv.configstrings) + MAX_MAP_AREAPORTALS * sizeof(qboolean);
+	data = malloc(size);
+
+	if (!data)
+	{
+		Com_Error(ERR_FATAL, "%s: out of memory", __func__);
+	}
+
+	SZ_Init(&sb, data, size);
+	SZ_Write(&sb, sv.configstrings, sizeof(sv.configstrings));
+	CM_WritePortalState(&sb);
+
 	Com_sprintf(name, sizeof(name), "%s/save/current/%s.sv2",
 				FS_Gamedir(), sv.name);
-	f = Q_fopen(name, "wb");
 
-	if (!f)
+	if (!SV_QueueSaveData(name, data, sb.cursize))
 	{
 		Com_Printf("Failed to open %s\n", name);
 		return;
 	}
 
-	fwrite(sv.configstrings, sizeof(sv.configstrings), 1, f);
-	CM_WritePortalState(f);
-	fclose(f);
-
 	Com_sprintf(name, sizeof(name), "%s/save/current", FS_Gamedir());
 	Sys_GetWorkDir(workdir, sizeof(workdir));
-	Sys_Mkdir(name);
 
 	if (!Sys_SetWorkDir(name))
 	{
@@ -225,6 +589,8 @@ SV_ReadLevelFile(void)
 
 	Com_DPrintf("SV_ReadLevelFile()\n");
 
+	SV_FlushSaveFiles();
+
 	Com_sprintf(name, sizeof(name), "save/current/%s.sv2", sv.name);
 	FS_FOpenFile(name, &f, true);
 
@@ -257,25 +623,37 @@ SV_ReadLevelFile(void)
 void
 SV_WriteServerFile(qboolean autosave)
 {
-	FILE *f;
 	cvar_t *var;
 	char name[MAX_OSPATH], string[128];
 	char workdir[MAX_OSPATH];
 	char comment[32];
 	time_t aclock;
 	struct tm *newtime;
+	sizebuf_t sb;
+	byte *data;
+	int size;
 
 	Com_DPrintf("SV_WriteServerFile(%s)\n", autosave ? "true" : "false");
 
-	Com_sprintf(name, sizeof(name), "%s/save/current/server.ssv", FS_Gamedir());
-	f = Q_fopen(name, "wb");
+	size = sizeof(comment) + sizeof(svs.mapcmd);
 
-	if (!f)
+	for (var = cvar_vars; var; var = var->next)
 	{
-		Com_Printf("Couldn't write %s\n", name);
-		return;
+		if (var->flags & CVAR_LATCH)
+		{
+			size += LATCH_CVAR_SAVELENGTH + sizeof(string);
+		}
 	}
 
+	data = malloc(size);
+
+	if (!data)
+	{
+		Com_Error(ERR_FATAL, "%s: out of memory", __func__);
+	}
+
+	SZ_Init(&sb, data, size);
+
 	/* write the comment field */
 	memset(comment, 0, sizeof(comment));
 
@@ -296,10 +674,10 @@ SV_WriteServerFile(qboolean autosave)
 				sv.configstrings[CS_NAME]);
 	}
 
-	fwrite(comment, 1, sizeof(comment), f);
+	SZ_Write(&sb, comment, sizeof(comment));
 
 	/* write the mapcmd */
-	fwrite(svs.mapcmd, 1, sizeof(svs.mapcmd), f);
+	SZ_Write(&sb, svs.mapcmd, sizeof(svs.mapcmd));
 
 	/* write all CVAR_LATCH cvars
 	   these will be things like coop,
@@ -322,16 +700,24 @@ SV_WriteServerFile(qboolean autosave)
 		memset(string, 0, sizeof(string));
 		strcpy(cvarname, var->name);
 		strcpy(string, var->string);
-		fwrite(cvarname, 1, sizeof(cvarname), f);
-		fwrite(string, 1, sizeof(string), f);
+		SZ_Write(&sb, cvarname, sizeof(cvarname));
+		SZ_Write(&sb, string, sizeof(string));
 	}
 
-	fclose(f);
+	Com_sprintf(name, sizeof(name), "%s/save/current", FS_Gamedir());
+	Sys_Mkdir(name);
+
+	Com_sprintf(name, sizeof(name), "%s/save/current/server.ssv", FS_Gamedir());
+
+	if (!SV_QueueSaveData(name, data, sb.cursize))
+	{
+		Com_Printf("Couldn't write %s\n", name);
+		return;
+	}
 
 	/* write game state */
 	Com_sprintf(name, sizeof(name), "%s/save/current", FS_Gamedir());
 	Sys_GetWorkDir(workdir, sizeof(workdir));
-	Sys_Mkdir(name);
 
 	if (!Sys_SetWorkDir(name))
 	{
@@ -356,6 +742,8 @@ SV_ReadServerFile(void)
 
 	Com_DPrintf("SV_ReadServerFile()\n");
 
+	SV_FlushSaveFiles();
+
 	Com_sprintf(name, sizeof(name), "save/current/server.ssv");
 	FS_FOpenFile(name, &f, true);
 
@@ -433,6 +821,8 @@ SV_Loadgame_f(void)
 		Com_Printf("Bad savedir.\n");
 	}
 
+	SV_FlushSaveFiles();
+
 	/* make sure the server.ssv file exists */
 	Com_sprintf(name, sizeof(name), "%s/save/%s/server.ssv",
 				FS_Gamedir(), Cmd_Argv(1));
@@ -523,6 +913,13 @@ SV_Savegame_f(void)
 	/* copy it off */
 	SV_CopySaveGame("current", dir);
 
+	/* the player wants to know it worked */
+	if (SV_FlushSaveFiles())
+	{
+		Com_Printf("Saving failed.\n");
+		return;
+	}
+
 	Com_Printf("Done.\n");
 }
 
@@ -609,6 +609,9 @@ SV_SendClientMessages(void)
 		msglen = 0;
 	}
 
+	/* the game may have changed anything since the last time */
+	SV_ResetCullEntities();
+
 	/* send a message to each spawned client */
 	for (i = 0, c = svs.clients; i < maxclients->value; i++, c++)
 	{
@@ -491,6 +491,71 @@ SV_AreaEdicts(const vec3_t mins, const vec3_t maxs, edict_t **list,
 	return area_count;
 }
 
+static int
+SV_EdictNumCmp(const void *a, const void *b)
+{
+	return NUM_FOR_EDICT(*(edict_t **)a) - NUM_FOR_EDICT(*(edict_t **)b);
+}
+
+/*
+ * Fills in a list of all solid and trigger edicts
+ * whose bounding box center is within radius of
+ * origin, sorted by edict number. Only linked edicts
+ * at their last linked position are found, the world
+ * isn't linked and thus never part of the list.
+ */
+int
+SV_RadiusEdicts(const vec3_t origin, float radius, edict_t **list,
+		int maxcount)
+{
+	vec3_t mins, maxs, eorg;
+	int i, j, num, count;
+
+	if (radius < 0)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		mins[i] = origin[i] - radius;
+		maxs[i] = origin[i] + radius;
+	}
+
+	num = SV_AreaEdicts(mins, maxs, list, maxcount, AREA_SOLID);
+
+	if (num < maxcount)
+	{
+		num += SV_AreaEdicts(mins, maxs, list + num, maxcount - num,
+				AREA_TRIGGERS);
+	}
+
+	/* the box is just the broad phase */
+	count = 0;
+
+	for (i = 0; i < num; i++)
+	{
+		edict_t *check = list[i];
+
+		for (j = 0; j < 3; j++)
+		{
+			eorg[j] = origin[j] - (check->s.origin[j] +
+					   (check->mins[j] + check->maxs[j]) * 0.5f);
+		}
+
+		if (DotProduct(eorg, eorg) > radius * radius)
+		{
+			continue;
+		}
+
+		list[count++] = check;
+	}
+
+	qsort(list, count, sizeof(list[0]), SV_EdictNumCmp);
+
+	return count;
+}
+
 int
 SV_PointContents(const vec3_t p)
 {